@@ -0,0 +1,66 @@
+#!/bin/sh
+# ===========================================================
+#  TR3XM LAN sample - GCC/Clang build script (Linux / POSIX)
+#  Usage: ./build_gcc.sh [debug|release|clean]
+#  * build_msvc.bat と同じ構成
+#      src/*.cpp            → build/tr3xm_lan
+#      tools/<name>.cpp     → build/<name>（src のうち main.cpp 以外とリンク）
+# ===========================================================
+set -eu
+
+# ---- 1) Absolute project paths (based on this script location) ----
+ROOT=$(cd "$(dirname "$0")" && pwd)
+SRC_DIR="$ROOT/src"
+INC_DIR="$ROOT/include"
+TOOLS_DIR="$ROOT/tools"
+OUT_DIR="$ROOT/build"
+OBJ_DIR="$OUT_DIR/obj"
+TARGET=tr3xm_lan
+CXX=${CXX:-g++}
+
+# ---- 2) Args ----
+CONFIG=${1:-debug}
+if [ "$CONFIG" = "clean" ]; then
+  echo "[CLEAN] removing build outputs..."
+  rm -f "$OUT_DIR/$TARGET"
+  for t in "$TOOLS_DIR"/*.cpp; do
+    [ -e "$t" ] && rm -f "$OUT_DIR/$(basename "$t" .cpp)"
+  done
+  rm -rf "$OBJ_DIR"
+  echo "[CLEAN] done"
+  exit 0
+fi
+
+mkdir -p "$OUT_DIR" "$OBJ_DIR"
+
+# ---- 3) Flags ----
+COMMON_CFLAGS="-std=c++17 -Wall -Wextra -I$INC_DIR -I$INC_DIR/tr3"
+if [ "$CONFIG" = "release" ]; then
+  OPTCFLAGS="-O2 -DNDEBUG"
+else
+  OPTCFLAGS="-g -O0"
+fi
+LDFLAGS="-pthread"
+
+echo "[BUILD] CONFIG=$CONFIG"
+echo "[CFLAGS] $COMMON_CFLAGS $OPTCFLAGS"
+
+# ---- 4) Compile all sources in src ----
+LIB_OBJS=""
+for f in "$SRC_DIR"/*.cpp; do
+  name=$(basename "$f" .cpp)
+  $CXX $COMMON_CFLAGS $OPTCFLAGS -c "$f" -o "$OBJ_DIR/$name.o"
+  [ "$name" = "main" ] || LIB_OBJS="$LIB_OBJS $OBJ_DIR/$name.o"
+done
+
+# ---- 5) Link main tool ----
+$CXX "$OBJ_DIR/main.o" $LIB_OBJS -o "$OUT_DIR/$TARGET" $LDFLAGS
+echo "[BUILD] done: \"$OUT_DIR/$TARGET\""
+
+# ---- 6) Tools (simulator etc.) ----
+for t in "$TOOLS_DIR"/*.cpp; do
+  [ -e "$t" ] || continue
+  name=$(basename "$t" .cpp)
+  $CXX $COMMON_CFLAGS $OPTCFLAGS "$t" $LIB_OBJS -o "$OUT_DIR/$name" $LDFLAGS
+  echo "[BUILD] done: \"$OUT_DIR/$name\""
+done
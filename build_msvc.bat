@@ -1,9 +1,11 @@
 @echo off
-setlocal ENABLEEXTENSIONS
+setlocal ENABLEEXTENSIONS ENABLEDELAYEDEXPANSION
 
 :: ===========================================================
 ::  TR3XM LAN sample - MSVC build script (absolute paths)
 ::  Usage: build_msvc.bat [debug|release|clean]
+::    src\*.cpp         -> build\tr3xm_lan.exe
+::    tools\<name>.cpp  -> build\<name>.exe (linked with src objs except main)
 :: ===========================================================
 
 :: ---- 1) Initialize Visual Studio (MSVC) environment ----
@@ -30,7 +32,9 @@ if errorlevel 1 (
 set "ROOT=%~dp0"
 set "SRC_DIR=%ROOT%src"
 set "INC_DIR=%ROOT%include"
+set "TOOLS_DIR=%ROOT%tools"
 set "OUT_DIR=%ROOT%build"
+set "OBJ_DIR=%OUT_DIR%\obj"
 set "TARGET=tr3xm_lan"
 
 :: ---- 3) Args ----
@@ -39,10 +43,11 @@ set "CONFIG=%~1"
 if "%CONFIG%"=="" set "CONFIG=debug"
 
 if not exist "%OUT_DIR%" mkdir "%OUT_DIR%"
+if not exist "%OBJ_DIR%" mkdir "%OBJ_DIR%"
 
 :: ---- 4) Flags (absolute /I; outputs go to build) ----
 set "COMMON_CFLAGS=/nologo /std:c++17 /EHsc /W4 /utf-8 /I "%INC_DIR%" /I "%INC_DIR%\tr3" /D_CRT_SECURE_NO_WARNINGS"
-set "LINK_BASE=/link Ws2_32.lib /OUT:"%OUT_DIR%\%TARGET%.exe""
+set "LINK_BASE=/link Ws2_32.lib"
 
 if /I "%CONFIG%"=="release" (
   set "OPTCFLAGS=/O2 /DNDEBUG"
@@ -56,27 +61,51 @@ echo [BUILD] CONFIG=%CONFIG%
 echo [CFLAGS] %COMMON_CFLAGS% %OPTCFLAGS%
 echo [LFLAGS] %LINK_BASE% %LINKEXTRA%
 
-:: ---- 5) Compile & link all sources in src ----
+:: ---- 5) Compile all sources in src ----
 pushd "%SRC_DIR%"
-cl %COMMON_CFLAGS% %OPTCFLAGS% ^
-  /Fo"%OUT_DIR%\\" ^
+cl %COMMON_CFLAGS% %OPTCFLAGS% /c ^
+  /Fo"%OBJ_DIR%\\" ^
   /Fd"%OUT_DIR%\%TARGET%.pdb" ^
-  *.cpp /Fe:"%OUT_DIR%\%TARGET%.exe" %LINK_BASE% %LINKEXTRA%
+  *.cpp
 set "ERR=%ERRORLEVEL%"
 popd
+if not "%ERR%"=="0" goto :FAILED
 
-if not "%ERR%"=="0" (
-  echo [BUILD] failed (ERRORLEVEL=%ERR%)
-  exit /b %ERR%
+set "LIB_OBJS="
+for %%F in ("%OBJ_DIR%\*.obj") do (
+  if /I not "%%~nF"=="main" set LIB_OBJS=!LIB_OBJS! "%%~fF"
 )
 
+:: ---- 6) Link main tool ----
+cl /nologo "%OBJ_DIR%\main.obj" !LIB_OBJS! /Fe:"%OUT_DIR%\%TARGET%.exe" %LINK_BASE% %LINKEXTRA%
+set "ERR=%ERRORLEVEL%"
+if not "%ERR%"=="0" goto :FAILED
 echo [BUILD] done: "%OUT_DIR%\%TARGET%.exe"
+
+:: ---- 7) Tools (simulator etc.) ----
+if not exist "%OBJ_DIR%\tools" mkdir "%OBJ_DIR%\tools"
+for %%T in ("%TOOLS_DIR%\*.cpp") do (
+  cl %COMMON_CFLAGS% %OPTCFLAGS% "%%~fT" !LIB_OBJS! ^
+    /Fo"%OBJ_DIR%\tools\\" /Fd"%OUT_DIR%\%%~nT.pdb" ^
+    /Fe:"%OUT_DIR%\%%~nT.exe" %LINK_BASE% %LINKEXTRA%
+  if errorlevel 1 (
+    set "ERR=1"
+    goto :FAILED
+  )
+  echo [BUILD] done: "%OUT_DIR%\%%~nT.exe"
+)
 exit /b 0
 
-:: ---- 6) Clean ----
+:FAILED
+echo [BUILD] failed (ERRORLEVEL=%ERR%)
+exit /b %ERR%
+
+:: ---- 8) Clean ----
 :CLEAN
 echo [CLEAN] removing build outputs...
 if exist "%OUT_DIR%\%TARGET%.exe" del /q "%OUT_DIR%\%TARGET%.exe" 2>nul
+for %%T in ("%TOOLS_DIR%\*.cpp") do if exist "%OUT_DIR%\%%~nT.exe" del /q "%OUT_DIR%\%%~nT.exe" 2>nul
+if exist "%OBJ_DIR%"              rmdir /s /q "%OBJ_DIR%"        2>nul
 if exist "%OUT_DIR%\*.obj"        del /q "%OUT_DIR%\*.obj"        2>nul
 if exist "%OUT_DIR%\*.pdb"        del /q "%OUT_DIR%\*.pdb"        2>nul
 if exist "%OUT_DIR%\*.ilk"        del /q "%OUT_DIR%\*.ilk"        2>nul
@@ -0,0 +1,115 @@
+// =============================================
+// include/tr3/antenna_scheduler.hpp
+// TR3シリーズ - アンテナ巡回スケジューラ
+// =============================================
+//
+// 「ANT#0 → ANT#1 → … を1回ずつ」の固定巡回の代わりに、次にどのアンテナで
+// 何回 Inventory2 を打つかを決める（通信はしない。Client / AsyncClient の呼び出し側が使う）。
+//
+//  - 重み付きラウンドロビン：weight の比で選ぶ（smooth WRR。同じアンテナが
+//    連続しにくいよう分散させる）。1巡 = 有効アンテナの weight の合計回の選択
+//  - 滞在（dwell）          ：1回選ばれたら Inventory2 を dwell 回続けて打つ
+//                            （アンテナ切替の往復を減らす）
+//  - 休止（skip）           ：idle_after 回続けてタグなしのアンテナは、
+//                            自分の番を 1, 2, 4, … 回（上限 max_skip）飛ばす。タグが読めたら元に戻る
+//  - ブザー                 ：毎回／タグがあったときだけ／鳴らさない を選べる
+//
+//   AntennaScheduler sch(SchedulerConfig::uniform(4));
+//   for (;;) {
+//       auto s = sch.next();
+//       if (s.switch_needed) cli.transact(cmd::switch_antenna(fb, s.antenna));
+//       for (int i = 0; i < s.dwell; ++i) { ... Inventory2 ... ; sch.report(s.antenna, tags); }
+//   }
+//
+// 単一スレッド用（リーダ1台につき1つ持つ）。
+// =============================================
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tr3 {
+
+// アンテナ1本ぶんの設定
+struct AntennaConfig {
+    uint8_t port    = 0;      // アンテナ番号（switch_antenna に渡す値）
+    int     weight  = 1;      // 選ばれる比率（0 で使わない）
+    int     dwell   = 1;      // 1回選ばれたときの連続 Inventory2 回数
+};
+
+enum class BuzzerMode : uint8_t {
+    OFF,        // 鳴らさない
+    EACH,       // Inventory2 ごとに鳴らす（従来の main.cpp と同じ）
+    ON_TAG,     // タグが1件以上読めたときだけ鳴らす
+};
+
+struct SchedulerConfig {
+    std::vector<AntennaConfig> antennas;
+    int        idle_after = 3;      // 連続してタグなしがこの回数で休止対象（0 = 休止しない）
+    int        max_skip   = 8;      // 休止で飛ばす番の上限
+    BuzzerMode buzzer     = BuzzerMode::OFF;
+
+    // ANT#0 〜 ANT#(n-1) を均等（weight 1、dwell 1）に巡回する設定
+    static SchedulerConfig uniform(int n);
+};
+
+class AntennaScheduler {
+public:
+    // 次に実行する1区切り
+    struct Slot {
+        uint8_t antenna       = 0;
+        int     dwell         = 1;       // 連続 Inventory2 回数
+        bool    switch_needed = true;    // 直前と別のアンテナ（切替コマンドが必要）
+    };
+
+    // アンテナ別の統計
+    struct AntennaStats {
+        uint64_t inventories = 0;   // Inventory2 回数
+        uint64_t tags        = 0;   // 読めたタグ数（延べ）
+        uint64_t skipped     = 0;   // 休止で飛ばした番の数
+        int      empty_run   = 0;   // 連続タグなし回数
+        int      skip_left   = 0;   // 残りの休止番数
+    };
+
+    explicit AntennaScheduler(SchedulerConfig cfg);
+
+    // ------------------------------------------------------------
+    // 関数名 : next
+    // 概要   : 次に Inventory2 を打つアンテナと回数を決める
+    // 備考   : 全アンテナが休止中でも1本は必ず返す
+    // ------------------------------------------------------------
+    Slot next();
+
+    // ------------------------------------------------------------
+    // 関数名 : report
+    // 概要   : Inventory2 1回ぶんの結果（読めたタグ数）を反映する
+    // ------------------------------------------------------------
+    void report(uint8_t antenna, int tags);
+
+    // Inventory2 の後にブザーを鳴らすべきか（BuzzerMode に従う）
+    bool want_buzzer(int tags) const {
+        return cfg_.buzzer == BuzzerMode::EACH || (cfg_.buzzer == BuzzerMode::ON_TAG && tags > 0);
+    }
+
+    // 1巡ぶんの next() 回数（有効アンテナの weight の合計）
+    int round_length() const { return total_weight_; }
+
+    // 次の next() で必ず切替コマンドを出させる（再接続後など）
+    void invalidate_current() { current_ = -1; }
+
+    const SchedulerConfig& config() const { return cfg_; }
+    // index は config().antennas の添字
+    const AntennaStats& stats(size_t index) const { return st_[index]; }
+
+private:
+    int find(uint8_t antenna) const;
+
+    SchedulerConfig           cfg_;
+    std::vector<AntennaStats> st_;
+    std::vector<int>          cur_;          // smooth WRR の現在値
+    std::vector<int>          backoff_;      // 次に休止するときの番数（1, 2, 4, …）
+    int                       total_weight_ = 0;
+    int                       current_      = -1;   // 直前に選んだ添字
+};
+
+} // namespace tr3
@@ -0,0 +1,198 @@
+// =============================================
+// include/tr3/async_client.hpp
+// TR3シリーズ - 非同期（パイプライン）クライアント
+// =============================================
+//
+// Client::transact は「1コマンド送信 → 応答待ち」の逐次処理のため、
+// 1サイクル（アンテナ切替 → Inventory2 → タグ受信 → ブザー）ごとに
+// 往復時間（RTT）が積み上がる。AsyncClient はコマンドをキューに積み、
+// 応答を待たずに最大 window 個まで先行送信する。
+//
+// 応答の対応付け：
+//  - TR3 は受信した順にコマンドを処理し、順に応答を返す
+//  - ACK(0x30)/NACK(0x31) などの応答 → 送信済みキューの先頭に対応
+//  - Inventory2(0x78) の ACK が「F0 NN」なら、続く NN 件のタグ応答(0x49)を
+//    同じ要求の tags に集めてから完了とする
+//  - 送信済み要求に対応しないタグ応答は on_unsolicited に渡す
+//
+// 駆動方法：
+//  - run_once() / run_until_idle() で poll → 送受信 → コールバック呼び出し
+//  - 複数接続を外部のイベントループで回す場合は handle() / wants_write() /
+//    on_readable() / on_writable() / check_timeouts() を使う
+//  - 単一スレッド用（コールバックも run_once() を呼んだスレッドで実行）
+// =============================================
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <exception>
+
+#include "tr3/capture.hpp"
+#include "tr3/net.hpp"
+#include "tr3/client.hpp"       // Client::Reply
+#include "tr3/protocol.hpp"
+#include "tr3/ring_buffer.hpp"
+
+namespace tr3 {
+
+class AsyncClient {
+public:
+    using Reply = Client::Reply;
+    using clock = std::chrono::steady_clock;
+
+    // 要求1件の結果
+    struct Result {
+        uint8_t            cmd{};   // 送信したコマンドコード
+        Reply              reply;   // 応答フレーム（ACK/NACK 等）
+        std::vector<Reply> tags;    // 後続のタグ応答（Inventory2 のみ）
+        std::exception_ptr error;   // 失敗時（タイムアウト/切断）。成功時は nullptr
+    };
+    using Callback = std::function<void(Result&&)>;
+
+    AsyncClient();
+    ~AsyncClient();
+    AsyncClient(const AsyncClient&) = delete;
+    AsyncClient& operator=(const AsyncClient&) = delete;
+
+    // ------------------------------------------------------------
+    // 関数名 : connect / close
+    // 概要   : 接続の確立／終了。close() は未完了の要求をすべて NetError で失敗させる
+    // 引数   : timeout_ms - 接続タイムアウト兼、要求ごとの応答タイムアウト
+    // ------------------------------------------------------------
+    void connect(const std::string& ip, uint16_t port, int timeout_ms = 5000);
+    void close();
+    bool connected() const { return sock_ != net::INVALID_SOCK && !connecting_; }
+
+    // ------------------------------------------------------------
+    // 関数名 : connect_async
+    // 概要   : 接続を開始だけして戻る（外部イベントループ用）
+    // 備考   : 接続完了前に submit した要求は、接続完了後に送信される。
+    //          失敗/タイムアウト時は未完了の要求がすべて失敗する
+    // ------------------------------------------------------------
+    void connect_async(const std::string& ip, uint16_t port, int timeout_ms = 5000);
+    bool connecting() const { return connecting_; }
+
+    // 先行送信する最大要求数（1 で Client::transact と同じ逐次動作）
+    void set_window(size_t n) { window_ = n ? n : 1; }
+    // 送信済み要求に対応しないタグ応答の受け取り先
+    void on_unsolicited(std::function<void(Reply&&)> cb) { unsolicited_ = std::move(cb); }
+
+    // 受信側 Parser の統計（捨てたバイト数・SUM 不一致など）
+    const Parser::Stats& parser_stats() const { return parser_.stats(); }
+
+    // 送受信フレームを cap へ記録する（nullptr で停止）
+    void set_capture(CaptureWriter* cap, uint16_t reader_id = 0) { capture_ = cap; capture_id_ = reader_id; }
+
+    // ------------------------------------------------------------
+    // 関数名 : submit
+    // 概要   : コマンドフレームをキューに積む（可能ならすぐ送信）
+    // 引数   : frame - 送信フレーム（cmd::xxx() / cmd::frames::XXX。内部の固定長バッファへ複写）
+    //          cb    - 完了時コールバック（run_once() 内で呼ばれる）
+    // 戻り値 : future 版は Result を返す（失敗時は例外を格納）
+    // ------------------------------------------------------------
+    void submit(ByteView frame, Callback cb);
+    std::future<Result> submit(ByteView frame);
+
+    // ------------------------------------------------------------
+    // 関数名 : run_once
+    // 概要   : 最大 timeout_ms だけ poll し、送受信とコールバック呼び出しを行う
+    // 戻り値 : 未完了の要求数
+    // ------------------------------------------------------------
+    size_t run_once(int timeout_ms);
+    // 未完了の要求がなくなるまで run_once() を繰り返す
+    void run_until_idle();
+
+    size_t pending() const { return inflight_.size() + queued_.size(); }
+
+    // ---- 外部イベントループ用 ----
+    net::socket_t handle() const { return sock_; }
+    bool wants_write() const { return connecting_ || tx_off_ < tx_.size(); }
+    void on_readable();                         // 受信 → 解析 → 応答の対応付け
+    void on_writable();                         // 送信バッファを書き出す
+    void check_timeouts(clock::time_point now); // 応答タイムアウトの判定
+    // 最も近い応答期限までのミリ秒（要求なしは -1）
+    int next_timeout_ms(clock::time_point now) const;
+
+private:
+    struct Request {
+        FrameBuffer          frame;             // 送信までの保持（ヒープを使わない）
+        uint8_t              cmd{};
+        Callback             cb;
+        Result               result;
+        int                  tags_left = -1;    // Inventory2: 残りタグ数（-1 = ACK 待ち）
+        clock::time_point    deadline{};
+    };
+
+    // 要求のキュー（リング。容量は増やすだけなので、定常状態ではヒープ確保しない）
+    // std::deque は Request が大きいため要素ごとにノードを確保・解放してしまう
+    class RequestQueue {
+    public:
+        bool   empty() const { return size_ == 0; }
+        size_t size()  const { return size_; }
+        Request&       front()       { return buf_[head_]; }
+        const Request& front() const { return buf_[head_]; }
+        void push_back(Request&& r) {
+            if (size_ == buf_.size()) grow();
+            buf_[(head_ + size_) % buf_.size()] = std::move(r);
+            ++size_;
+        }
+        Request pop_front() {
+            Request r = std::move(buf_[head_]);
+            head_ = (head_ + 1) % buf_.size();
+            --size_;
+            return r;
+        }
+        void swap(RequestQueue& o) noexcept {
+            buf_.swap(o.buf_);
+            std::swap(head_, o.head_);
+            std::swap(size_, o.size_);
+        }
+    private:
+        void grow() {
+            std::vector<Request> next(buf_.empty() ? 8 : buf_.size() * 2);
+            for (size_t i = 0; i < size_; ++i) next[i] = std::move(buf_[(head_ + i) % buf_.size()]);
+            buf_.swap(next);
+            head_ = 0;
+        }
+        std::vector<Request> buf_;
+        size_t head_ = 0;
+        size_t size_ = 0;
+    };
+
+    bool finish_connect();                      // 接続中 → 接続完了（失敗時 false）
+    void pump_queue();                          // window の空きぶん送信バッファへ
+    void dispatch(const FrameView& fv);         // 受信フレーム → 要求へ対応付け
+    void complete_front();
+    void fail_all(const std::exception_ptr& e, bool include_queued);
+
+    net::socket_t sock_ = net::INVALID_SOCK;
+    bool   connecting_ = false;
+    clock::time_point connect_deadline_{};
+    int    timeout_ms_ = 5000;
+    size_t window_     = 4;
+
+    RequestQueue queued_;             // 未送信
+    RequestQueue inflight_;           // 送信済み・応答待ち（送信順）
+    // コールバックが持っていかなかった Result::tags（容量ごと次の要求で使い回す）
+    std::vector<std::vector<Reply>> spare_tags_;
+
+    std::vector<uint8_t> tx_;         // 送信バッファ（連結したフレーム）
+    size_t               tx_off_ = 0; // 送信済み位置
+
+    // 応答タイムアウト後、遅れて届く応答を読み捨てる期限（この間は送信しない）
+    clock::time_point quiet_until_{};
+
+    RingBuffer<4096> rx_;
+    Parser           parser_;
+    std::shared_ptr<FramePool> pool_ = FramePool::create();   // Reply の実体（使い回す）
+
+    std::function<void(Reply&&)> unsolicited_;
+
+    CaptureWriter* capture_ = nullptr;
+    uint16_t       capture_id_ = 0;
+};
+
+} // namespace tr3
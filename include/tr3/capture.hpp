@@ -0,0 +1,138 @@
+// =============================================
+// include/tr3/capture.hpp
+// TR3シリーズ - 送受信フレームのバイナリキャプチャ
+// =============================================
+//
+// 現場の通信をそのまま保存し、オフラインで再生（tools/tr3_replay）するための形式。
+// 追記専用で、読み出しはファイル全体をメモリマップしてコピーなしで走査する。
+//
+// ファイル形式（リトルエンディアン）：
+//
+//   ファイルヘッダ（16B）
+//     [0..7]   magic   "TR3CAP\0\0"
+//     [8..9]   version 1
+//     [10..15] 予約（0）
+//
+//   レコード（16B ヘッダ + フレーム本体、8B 境界に詰め物）
+//     [0..7]   ts_us   system_clock のエポックからのマイクロ秒
+//     [8..9]   reader  リーダ識別番号（ReaderPool の番号など）
+//     [10]     dir     1 = 送信（上位 → リーダ）, 2 = 受信（リーダ → 上位）
+//     [11]     予約（0）
+//     [12..13] len     フレーム長（STX〜CR、最大 262）
+//     [14..15] 予約（0）
+//     [16..]   フレーム本体 + 0 詰め（次のレコードが 8B 境界から始まるように）
+//
+// 書き込み途中で落ちた末尾の不完全なレコードは、読み出し時に無視し、
+// 次に CaptureWriter で開いたときに切り詰める（その後ろへ追記しない）。
+// =============================================
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "tr3/protocol.hpp"   // ByteView
+
+namespace tr3 {
+
+struct CaptureError : std::runtime_error { using std::runtime_error::runtime_error; };
+
+enum class CaptureDir : uint8_t { SEND = 1, RECV = 2 };
+
+inline constexpr size_t  CAPTURE_FILE_HEADER   = 16;
+inline constexpr size_t  CAPTURE_RECORD_HEADER = 16;
+inline constexpr uint16_t CAPTURE_VERSION      = 1;
+
+// 読み出した1レコード（frame はメモリマップ内を指す）
+struct CaptureRecord {
+    int64_t    ts_us  = 0;
+    uint16_t   reader = 0;
+    CaptureDir dir    = CaptureDir::RECV;
+    ByteView   frame;
+};
+
+// ================================================================
+// CaptureWriter
+//   - 追記専用。レコードは内部バッファに溜め、一定量ごとにまとめて書き込む
+//   - 複数スレッド（ReaderPool のワーカー等）から同時に write() してよい
+// ================================================================
+class CaptureWriter {
+public:
+    CaptureWriter() = default;
+    explicit CaptureWriter(const std::string& path) { open(path); }
+    ~CaptureWriter();
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+    // ------------------------------------------------------------
+    // 関数名 : open
+    // 概要   : キャプチャファイルを追記モードで開く（新規ならファイルヘッダを書く）
+    // 備考   : 末尾の不完全なレコードは切り詰めてから追記する
+    // 例外   : 開けない／別形式のファイル／切り詰められないなら CaptureError
+    // ------------------------------------------------------------
+    void open(const std::string& path);
+    void close();
+    bool is_open() const { return fp_ != nullptr; }
+
+    // ------------------------------------------------------------
+    // 関数名 : write
+    // 概要   : フレーム1つを記録（時刻省略時は現在時刻）
+    // ------------------------------------------------------------
+    void write(CaptureDir dir, uint16_t reader, ByteView frame,
+               std::chrono::system_clock::time_point ts = std::chrono::system_clock::now());
+
+    // 内部バッファをファイルへ書き出す
+    // （失敗したら最後の完全なレコードまで切り詰めてキャプチャを止め、is_open() が false になる）
+    void flush();
+
+private:
+    void flush_locked();
+
+    std::mutex           mu_;
+    std::FILE*           fp_ = nullptr;
+    std::string          path_;
+    uint64_t             size_ = 0;   // ファイル中の完全なレコードの終端（失敗時はここまで切り詰める）
+    std::vector<uint8_t> buf_;
+};
+
+// ================================================================
+// CaptureReader
+//   - ファイル全体を読み取り専用でメモリマップし、レコードを順に返す
+// ================================================================
+class CaptureReader {
+public:
+    CaptureReader() = default;
+    explicit CaptureReader(const std::string& path) { open(path); }
+    ~CaptureReader();
+    CaptureReader(const CaptureReader&) = delete;
+    CaptureReader& operator=(const CaptureReader&) = delete;
+
+    // 例外：開けない／マップできない／ヘッダ不正なら CaptureError
+    void open(const std::string& path);
+    void close();
+
+    // ------------------------------------------------------------
+    // 関数名 : next
+    // 概要   : 次のレコードを取り出す（rec.frame はマップが開いている間有効）
+    // 戻り値 : false = 終端（末尾の不完全なレコードは無視）
+    // ------------------------------------------------------------
+    bool next(CaptureRecord& rec);
+    void rewind() { pos_ = CAPTURE_FILE_HEADER; }
+
+    size_t size() const { return size_; }
+
+private:
+    const uint8_t* base_ = nullptr;
+    size_t         size_ = 0;
+    size_t         pos_  = CAPTURE_FILE_HEADER;
+#ifdef _WIN32
+    void*          file_ = nullptr;   // HANDLE
+    void*          map_  = nullptr;   // HANDLE
+#endif
+};
+
+} // namespace tr3
@@ -2,45 +2,176 @@
 // include/tr3/client.hpp
 // =============================================
 #pragma once
+#include <array>
+#include <chrono>
 #include <string>
 #include <vector>
 #include <cstdint>
 #include <stdexcept>
 
-// Windows の max/min マクロ無効化
-#ifndef NOMINMAX
-#define NOMINMAX 1
-#endif
-
-#ifdef _WIN32
-#  include <winsock2.h>
-#  include <ws2tcpip.h>
-#  pragma comment(lib, "ws2_32.lib")
-#endif
+#include "tr3/capture.hpp"      // CaptureWriter
+#include "tr3/command_batch.hpp" // CommandBatch
+#include "tr3/frame_pool.hpp"   // FramePool / FrameBlock
+#include "tr3/metrics.hpp"      // Counter / Histogram / MetricsSnapshot
+#include "tr3/net.hpp"          // socket_t / NetError（Windows / POSIX 共通）
+#include "tr3/protocol.hpp"     // Parser
+#include "tr3/ring_buffer.hpp"  // 受信バッファ
+#include "tr3/rtt.hpp"          // RttEstimator
 
 namespace tr3 {
 
-struct NetError : std::runtime_error { using std::runtime_error::runtime_error; };
 struct ProtoError : std::runtime_error { using std::runtime_error::runtime_error; };
 
 class Client {
 public:
+    using clock = std::chrono::steady_clock;
+
+    // ------------------------------------------------------------
+    // 応答タイムアウトの決め方
+    //  - adaptive = true : コマンドごとに実測 RTT から求める（rtt.hpp）。
+    //                      上限は connect() の timeout_ms
+    //  - adaptive = false: 常に connect() の timeout_ms（従来どおり）
+    //  - 再送のたびに待ち時間を backoff 倍にする（上限は同じ）
+    // ------------------------------------------------------------
+    struct TimeoutPolicy {
+        bool   adaptive   = true;
+        int    min_ms     = 20;     // 適応タイムアウトの下限
+        int    initial_ms = 1000;   // 実測がまだないコマンドの待ち時間
+        double backoff    = 2.0;    // 再送ごとの倍率
+    };
+
     Client();
     ~Client();
     void connect(const std::string& ip, uint16_t port, int timeout_ms=5000);
     void close();
+    bool connected() const { return sock_ != net::INVALID_SOCK; }
+    net::socket_t handle() const { return sock_; }   // ソケットオプション設定用
+
+    void set_timeout_policy(const TimeoutPolicy& p) { policy_ = p; }
+    const TimeoutPolicy& timeout_policy() const { return policy_; }
 
     // コマンド送信（raw フレーム）→ デコード済み応答を返す
-    // retries: タイムアウト時の再送回数
-    struct Reply { uint8_t cmd; std::vector<uint8_t> data; std::vector<uint8_t> raw; };
-    Reply transact(const std::vector<uint8_t>& frame, int retries=1);
+    // frame     : std::vector / FrameBuffer / cmd::frames::XXX のいずれも渡せる（コピーしない）
+    // retries   : タイムアウト時の再送回数
+    // timeout_ms: 再送を含む呼び出し全体の期限（-1 = 各回の応答タイムアウトのみ）
+    // 送信前に受信済みの取り残しを読み捨てる。Inventory2 は retries に関わらず再送しない
+    //
+    // Reply : 応答フレーム1つ。raw の実体は接続ごとの FramePool のスロット（block）で、
+    //         data は raw の DATA 部分を指すビュー（コピーしない）。
+    //         ムーブは安価（ビューはそのまま有効）。コピーすると別のスロットに写して指し直す
+    struct Reply {
+        uint8_t    cmd = 0;
+        ByteView   data;    // DATA（raw の中）
+        ByteView   raw;     // STX〜CR
+        FrameBlock block;   // raw の実体（破棄でプールへ返る）
+
+        Reply() = default;
+        Reply(uint8_t c, FrameBlock b) : cmd(c), block(std::move(b)) { bind(); }
+        Reply(const Reply& o) : cmd(o.cmd), block(o.block) { bind(); }
+        Reply& operator=(const Reply& o) {
+            if (this != &o) { cmd = o.cmd; block = o.block; bind(); }
+            return *this;
+        }
+        Reply(Reply&&) noexcept = default;
+        Reply& operator=(Reply&&) noexcept = default;
+
+    private:
+        void bind() {
+            raw  = block.view();
+            data = raw.size() >= HEADER_LEN + FOOTER_LEN
+                 ? ByteView(raw.data() + HEADER_LEN, raw.size() - HEADER_LEN - FOOTER_LEN)
+                 : ByteView();
+        }
+    };
+    Reply transact(ByteView frame, int retries=1, int timeout_ms=-1);
     // ★ 送信せず“次の1フレームだけ”受信（Inventory後のUIDフレーム読取り用）
-    Reply receive_only(int timeout_ms = 2000);
+    //    timeout_ms: 待ち時間の上限（-1 = 直前までのフレーム間隔から求める）
+    Reply receive_only(int timeout_ms = -1);
+
+    // ------------------------------------------------------------
+    // 関数名 : transact_batch
+    // 概要   : batch の全フレームを send 1回で送り、応答を送信順に受け取る
+    // 引数   : batch      - 送るコマンド列（CommandBatch）
+    //          timeout_ms - 全応答を受け取るまでの期限（-1 = 各コマンドの応答タイムアウトの合計）
+    // 戻り値 : batch と同じ順の応答。Inventory2 の応答には続くタグ応答（ACK の件数分）も付く
+    // 例外   : 期限切れで TimeoutError、送受信失敗/切断で NetError
+    // 備考   : 再送はしない（どこまで届いたか分からないため。呼び出し側でやり直す）。
+    //          送信前に受信済みの取り残し（打ち切った前のバッチの応答）を読み捨てる。
+    //          RTT の標本にするのは最初のコマンドの応答だけ
+    // ------------------------------------------------------------
+    struct BatchReply { Reply reply; std::vector<Reply> tags; };
+    std::vector<BatchReply> transact_batch(const CommandBatch& batch, int timeout_ms = -1);
+    // 結果を out に入れる版。out の要素とタグ応答の vector を容量ごと使い回すので、
+    // ループで同じ out を渡せば定常状態ではヒープ確保しない（例外時の out の中身は不定）
+    void transact_batch(const CommandBatch& batch, std::vector<BatchReply>& out, int timeout_ms = -1);
+
+    // コマンド cmd の現在の応答タイムアウト（ミリ秒、再送前の1回目）
+    int command_timeout_ms(uint8_t cmd) const;
+    // コマンドごとの RTT 推定（接続ごとにリセット）と、receive_only のフレーム間隔の推定
+    const RttEstimator& rtt(uint8_t cmd) const { return rtt_[cmd]; }
+    const RttEstimator& frame_gap() const { return gap_; }
+
+    // 受信側 Parser の統計（捨てたバイト数・SUM 不一致など）
+    const Parser::Stats& parser_stats() const { return parser_.stats(); }
+
+    // ------------------------------------------------------------
+    // 通信の計測値（累計。再接続してもクリアしない）
+    //  書き込みは Client を使うスレッドだけ。読み出しは別スレッドからでもよい
+    // ------------------------------------------------------------
+    struct Metrics {
+        Counter   frames_sent;
+        Counter   frames_received;   // 完成フレーム（読み捨てたタグ応答を含む）
+        Counter   bytes_sent;
+        Counter   bytes_received;
+        Counter   retries;           // transact の再送回数
+        Counter   timeouts;          // TimeoutError を投げた回数
+        Counter   stale_frames;      // 読み捨てた取り残し（期限切れ後・再送で重複した応答、タグ応答）
+        Histogram transact_us;       // 送信 → 応答（マイクロ秒。再送を含む呼び出し全体）
+        Histogram inventory_us;      // Inventory2 の送信 → 最後のタグ応答（マイクロ秒）
+    };
+    const Metrics& metrics() const { return metrics_; }
+
+    // 計測値と Parser の統計を out へ追加する（labels は全項目に付く。例: "reader=\"0\""）
+    void collect_metrics(MetricsSnapshot& out, const std::string& labels = "") const;
+
+    // 応答フレーム用のバッファプール（貸し出し状況の確認用）
+    const FramePool& frame_pool() const { return *pool_; }
+
+    // 送受信フレームを cap へ記録する（nullptr で停止。cap は Client より長生きさせること）
+    void set_capture(CaptureWriter* cap, uint16_t reader_id = 0) { capture_ = cap; capture_id_ = reader_id; }
 
 private:
-#ifdef _WIN32
-    SOCKET sock_ = INVALID_SOCKET;
-#endif
+    // 受信バッファ内のバイトを Parser で解析し、完成フレームがあれば fv に取り出す
+    bool next_frame(FrameView& fv);
+    // 期限まで受信可能を待ち、カーネルに溜まっている分をまとめて受信バッファへ（false = 期限切れ）
+    bool fill_rx(clock::time_point deadline);
+    // 期限までに次の完成フレームを取り出す（false = 期限切れ）
+    bool wait_frame(FrameView& fv, clock::time_point deadline);
+    void send_frame(ByteView frame);
+    // 送信前に、受信済みの取り残しフレームを読み捨てる（待たない）
+    void discard_stale();
+    // 完成フレームのビュー → Reply（受信ログ出力を含む）
+    Reply make_reply(const FrameView& fv);
+    // Inventory2 の ACK から1サイクルの所要時間の計測を始める
+    void track_inventory(const FrameView& ack, clock::time_point sent, clock::time_point now);
+
+    net::socket_t sock_ = net::INVALID_SOCK;
+    int timeout_ms_ = 5000;   // 送信タイムアウト兼、応答タイムアウトの上限（connect で指定された値）
+
+    TimeoutPolicy                 policy_;
+    std::array<RttEstimator, 256> rtt_{};   // 送信コマンドコードごと
+    RttEstimator                  gap_;     // receive_only の待ち時間
+
+    RingBuffer<4096> rx_;     // 接続ごとの受信バッファ（次フレーム分の残りバイトを保持）
+    Parser parser_;           // 接続ごとの構文解析器（フレームが recv をまたいでも継続）
+    std::shared_ptr<FramePool> pool_ = FramePool::create();   // Reply の実体（使い回す）
+
+    CaptureWriter* capture_ = nullptr;
+    uint16_t       capture_id_ = 0;
+
+    Metrics           metrics_;
+    clock::time_point inv_start_{};     // 計測中の Inventory2 の送信時刻
+    int               inv_left_ = 0;    // そのタグ応答の残り件数（0 = 計測していない）
 };
 
 } // namespace tr3
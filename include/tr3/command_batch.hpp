@@ -0,0 +1,83 @@
+// =============================================
+// include/tr3/command_batch.hpp
+// TR3シリーズ - 複数コマンドの一括送信バッファ
+// =============================================
+//
+// 「アンテナ切替 → Inventory2 → ブザー」のように続けて送るコマンドを
+// 1つの連続したバッファへ組み立て、send 1回（= 通常 1 TCP セグメント）で送るためのもの。
+// 送信と応答の回収は Client::transact_batch()（送信順に応答を対応付ける）。
+//
+//   CommandBatch b;
+//   b.add(cmd::switch_antenna(fb, 1));          // 組み立て済みフレームを追加
+//   b.add(cmd::frames::INVENTORY2);
+//   b.add(0x00, CMD_BUZZER, buzzer_data);       // フィールドからバッファ末尾へ直接組み立て
+//   auto replies = cli.transact_batch(b);       // replies[i] が i 番目のコマンドの応答
+//
+// バッファは clear() しても容量を保つので、サイクルごとに使い回せばヒープ確保は最初だけ。
+// =============================================
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include "tr3/protocol.hpp"
+
+namespace tr3 {
+
+class CommandBatch {
+public:
+    CommandBatch() { buf_.reserve(64); offs_.reserve(4); }
+
+    // ------------------------------------------------------------
+    // 関数名 : add（組み立て済みフレーム）
+    // 概要   : STX〜CR の完全フレームをバッファ末尾へ複写する
+    // 例外   : フレームとして短すぎる／STX で始まらない → std::invalid_argument
+    // ------------------------------------------------------------
+    CommandBatch& add(ByteView frame) {
+        if (frame.size() < static_cast<size_t>(HEADER_LEN + FOOTER_LEN) || frame[0] != STX) {
+            throw std::invalid_argument("CommandBatch::add: not a frame");
+        }
+        offs_.push_back(static_cast<uint32_t>(buf_.size()));
+        buf_.insert(buf_.end(), frame.begin(), frame.end());
+        return *this;
+    }
+
+    // ------------------------------------------------------------
+    // 関数名 : add（フィールド指定）
+    // 概要   : [STX][ADDR][CMD][LEN][DATA][ETX][SUM][CR] をバッファ末尾へ直接組み立てる
+    // 例外   : DATA が 255 バイト超 → std::length_error
+    // ------------------------------------------------------------
+    CommandBatch& add(uint8_t addr, uint8_t cmd, ByteView data) {
+        const size_t at = buf_.size();
+        buf_.resize(at + HEADER_LEN + data.size() + FOOTER_LEN);
+        try {
+            encode_frame(buf_.data() + at, addr, cmd, data.data(), data.size());
+        } catch (...) {
+            buf_.resize(at);
+            throw;
+        }
+        offs_.push_back(static_cast<uint32_t>(at));
+        return *this;
+    }
+
+    size_t   count() const { return offs_.size(); }
+    bool     empty() const { return offs_.empty(); }
+    ByteView bytes() const { return ByteView(buf_.data(), buf_.size()); }   // 送信する連続バッファ
+
+    // i 番目のフレームと、そのコマンドコード
+    ByteView frame(size_t i) const {
+        const size_t b = offs_[i];
+        const size_t e = (i + 1 < offs_.size()) ? offs_[i + 1] : buf_.size();
+        return ByteView(buf_.data() + b, e - b);
+    }
+    uint8_t cmd(size_t i) const { return buf_[offs_[i] + 2]; }
+
+    void clear() { buf_.clear(); offs_.clear(); }
+
+private:
+    std::vector<uint8_t>  buf_;    // 連結したフレーム
+    std::vector<uint32_t> offs_;   // 各フレームの先頭位置
+};
+
+} // namespace tr3
@@ -0,0 +1,214 @@
+// =============================================
+// include/tr3/command_catalog.hpp
+// TR3シリーズ - 型付きコマンド一覧と応答のデコード
+// =============================================
+//
+// 送信側：コマンドごとに「コマンドコード・固定 DATA・期待する応答の型」を
+//         CommandSpec として constexpr で宣言する（catalog::ROM_VERSION など）。
+//         spec.frame() はコンパイル時に STX〜CR まで組み立て済みのフレームになる。
+//
+// 受信側：decode_reply(cmd, data) が応答を Response（std::variant）へ変換する。
+//         応答コード（CMD）で 256 要素の関数テーブルを引くだけで、ヒープは使わない。
+//
+//   ACK  (0x30) : DATA 先頭 0x90 → RomInfo、[F0 NN] → InventoryAck、それ以外 → Ack（エコー）
+//   NACK (0x31) : Nack
+//   タグ (0x49) : TagInfo
+//   その他／長さ不正 : BadReply
+//
+//   auto rep = cli.transact(catalog::ROM_VERSION.frame());
+//   if (auto rom = reply_as<decltype(catalog::ROM_VERSION)>(rep.cmd, rep.data)) { ... rom->major ... }
+//
+//   std::visit([](const auto& r) { ... }, decode_reply(rep.cmd, rep.data));
+//
+// Ack / Nack / BadReply の data は受信バッファ（Reply::data など）を指すビュー。
+// 元の応答より長く持たないこと。
+// =============================================
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <variant>
+
+#include "tr3/inventory.hpp"   // TagInfo
+#include "tr3/protocol.hpp"
+
+namespace tr3 {
+
+// ---------------------------------------------
+// 応答の型
+// ---------------------------------------------
+
+// ACK（DATA をそのまま返すもの：コマンドモード設定・アンテナ切替・ブザーなど）
+struct Ack {
+    ByteView data;
+};
+
+// ROMバージョン（ACK、DATA = [90]['1']['0']['2']['3']['T']['R']['3']['X']['M']）
+struct RomInfo {
+    uint8_t              major = 0;
+    uint8_t              minor = 0;
+    uint8_t              patch = 0;
+    std::array<char, 3>  series{};   // "TR3"
+    std::array<char, 2>  code{};     // "XM"
+
+    // "1.02.3 TR3XM"
+    std::string to_string() const {
+        char b[32];
+        std::snprintf(b, sizeof(b), "%u.%02u.%u %.3s%.2s", major, minor, patch, series.data(), code.data());
+        return b;
+    }
+};
+
+// Inventory2 の ACK（DATA = [F0][NN]。この後に NN 件のタグ応答が続く）
+struct InventoryAck {
+    uint8_t count = 0;
+};
+
+// NACK（data はエラー内容。機種・コマンドにより異なる）
+struct Nack {
+    ByteView data;
+};
+
+// 応答コードが不明、または DATA が期待した形でない
+struct BadReply {
+    uint8_t  cmd = 0;
+    ByteView data;
+};
+
+using Response = std::variant<Ack, RomInfo, InventoryAck, TagInfo, Nack, BadReply>;
+
+// ---------------------------------------------
+// デコード（応答コードごとの関数をテーブルで引く）
+// ---------------------------------------------
+namespace detail {
+
+using DecodeFn = Response (*)(uint8_t cmd, ByteView data);
+
+inline Response decode_ack(uint8_t cmd, ByteView d) {
+    if (!d.empty() && d[0] == 0x90) {
+        if (d.size() < 10) return BadReply{ cmd, d };
+        auto dig = [](uint8_t c) { return static_cast<uint8_t>((c >= '0' && c <= '9') ? c - '0' : 0); };
+        RomInfo r;
+        r.major  = dig(d[1]);
+        r.minor  = static_cast<uint8_t>(dig(d[2]) * 10 + dig(d[3]));
+        r.patch  = dig(d[4]);
+        r.series = { char(d[5]), char(d[6]), char(d[7]) };
+        r.code   = { char(d[8]), char(d[9]) };
+        return r;
+    }
+    if (auto n = parse_uid_count(d)) return InventoryAck{ static_cast<uint8_t>(*n) };
+    return Ack{ d };
+}
+
+inline Response decode_nack(uint8_t, ByteView d) {
+    return Nack{ d };
+}
+
+inline Response decode_tag(uint8_t cmd, ByteView d) {
+    if (auto t = parse_tag(cmd, d)) return *t;
+    return BadReply{ cmd, d };
+}
+
+inline Response decode_unknown(uint8_t cmd, ByteView d) {
+    return BadReply{ cmd, d };
+}
+
+constexpr std::array<DecodeFn, 256> make_decode_table() {
+    std::array<DecodeFn, 256> t{};
+    for (auto& f : t) f = &decode_unknown;
+    t[RES_ACK]  = &decode_ack;
+    t[RES_NACK] = &decode_nack;
+    t[RES_TAG]  = &decode_tag;
+    return t;
+}
+
+inline constexpr std::array<DecodeFn, 256> DECODE_TABLE = make_decode_table();
+
+} // namespace detail
+
+// ------------------------------------------------------------
+// 関数名 : decode_reply
+// 概要   : 応答（CMD, DATA）を型付きの Response に変換する
+// ------------------------------------------------------------
+inline Response decode_reply(uint8_t cmd, ByteView data) {
+    return detail::DECODE_TABLE[cmd](cmd, data);
+}
+
+// ---------------------------------------------
+// コマンドの宣言
+//  - Code    : コマンドコード
+//  - ReplyT  : 期待する応答の型（Response の選択肢のどれか）
+//  - N       : 固定 DATA の長さ
+// ---------------------------------------------
+template <uint8_t Code, typename ReplyT, size_t N>
+struct CommandSpec {
+    using reply_type = ReplyT;
+    static constexpr uint8_t code = Code;
+
+    std::array<uint8_t, N> data{};
+
+    // STX〜CR の完全フレーム（constexpr 文脈ならコンパイル時に組み立て済み）
+    constexpr FixedFrame<N> frame(uint8_t addr = 0x00) const { return fixed_frame(addr, Code, data); }
+};
+
+// ------------------------------------------------------------
+// 関数名 : reply_as
+// 概要   : 応答をデコードし、Spec の期待する型ならそれを返す
+// 戻り値 : 期待した型でなければ std::nullopt（NACK・別の応答・長さ不正など）
+// ------------------------------------------------------------
+template <typename Spec>
+std::optional<typename Spec::reply_type> reply_as(uint8_t cmd, ByteView data) {
+    const Response r = decode_reply(cmd, data);
+    if (const auto* p = std::get_if<typename Spec::reply_type>(&r)) return *p;
+    return std::nullopt;
+}
+
+// ---------------------------------------------
+// コマンド一覧
+// ---------------------------------------------
+namespace catalog {
+
+    using RomVersion  = CommandSpec<CMD_ROM,        RomInfo,      1>;
+    using CommandMode = CommandSpec<CMD_SET,        Ack,          4>;
+    using Inventory2  = CommandSpec<CMD_INVENTORY2, InventoryAck, 3>;
+    using Buzzer      = CommandSpec<CMD_BUZZER,     Ack,          2>;
+    using SwitchAnt   = CommandSpec<CMD_SET,        Ack,          2>;
+
+    inline constexpr RomVersion  ROM_VERSION { cmd::ROM_DATA };
+    inline constexpr CommandMode COMMAND_MODE{ cmd::COMMAND_MODE_DATA };
+    inline constexpr Inventory2  INVENTORY2  { cmd::INVENTORY2_DATA };
+    inline constexpr Buzzer      BUZZER_ON   { { 0x01, 0x00 } };
+    inline constexpr Buzzer      BUZZER_OFF  { { 0x00, 0x00 } };
+
+    // アンテナ切替（DATA = [9C][ant]。番号は実行時に決まるので frame() は呼び出しごとにスタック上で組み立てる）
+    constexpr SwitchAnt switch_antenna(uint8_t ant) { return SwitchAnt{ { 0x9C, ant } }; }
+
+    namespace detail {
+        template <size_t A, size_t B>
+        constexpr bool same_frame(const FixedFrame<A>& a, const FixedFrame<B>& b) {
+            if (a.size() != b.size()) return false;
+            for (size_t i = 0; i < a.size(); ++i) if (a.bytes[i] != b.bytes[i]) return false;
+            return true;
+        }
+        template <size_t A, size_t M>
+        constexpr bool same_bytes(const FixedFrame<A>& a, const std::array<uint8_t, M>& b) {
+            if (a.size() != M) return false;
+            for (size_t i = 0; i < M; ++i) if (a.bytes[i] != b[i]) return false;
+            return true;
+        }
+    }
+    // cmd::frames（従来の固定フレーム）と同じバイト列になることをコンパイル時に確認
+    static_assert(detail::same_frame(ROM_VERSION.frame(),  cmd::frames::ROM_VERSION));
+    static_assert(detail::same_frame(COMMAND_MODE.frame(), cmd::frames::COMMAND_MODE));
+    static_assert(detail::same_frame(INVENTORY2.frame(),   cmd::frames::INVENTORY2));
+    static_assert(detail::same_frame(BUZZER_ON.frame(),    cmd::frames::BUZZER_ON));
+    static_assert(detail::same_frame(BUZZER_OFF.frame(),   cmd::frames::BUZZER_OFF));
+    // アンテナ切替は固定フレームがないので、ANT#1 のバイト列（SUM = 02+00+4E+02+9C+01+03 の下位 8 ビット）と比べる
+    static_assert(detail::same_bytes(switch_antenna(1).frame(),
+                                     std::array<uint8_t, 9>{ 0x02, 0x00, 0x4E, 0x02, 0x9C, 0x01, 0x03, 0xF2, 0x0D }));
+}
+
+} // namespace tr3
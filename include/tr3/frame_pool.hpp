@@ -0,0 +1,125 @@
+// =============================================
+// include/tr3/frame_pool.hpp
+// TR3シリーズ - 受信フレーム用のバッファプール
+// =============================================
+//
+// Client / AsyncClient が応答（Reply）ごとに std::vector を確保しないよう、
+// 最大フレーム長（262 バイト）の固定長スロットを接続ごとのプールから貸し出す。
+//
+//  - スロットは CHUNK_SLOTS 個ずつまとめて確保し、返却されたものは空きリストで使い回す。
+//    同時に持っている応答の数が増えたときだけ確保が起き、定常状態の読取では確保しない
+//  - FrameBlock は RAII のハンドル。破棄（またはムーブ先の破棄）でスロットをプールへ返す。
+//    ムーブしてもスロットの位置は変わらないので、中を指すビューはそのまま使える。
+//    コピーは同じプールから別のスロットを借りて中身を写す
+//  - FrameBlock はプールを shared_ptr で持つので、Client より長生きしてもよい
+//  - 貸し出し／返却は mutex で守る（AsyncClient の future で別スレッドへ渡った応答の破棄など）
+//
+//   auto pool = FramePool::create();
+//   FrameBlock b = pool->acquire(fv.raw);   // fv.raw をスロットへ写す
+//   ByteView raw = b.view();
+// =============================================
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "tr3/protocol.hpp"   // ByteView / MAX_FRAME_LEN
+
+namespace tr3 {
+
+class FramePool;
+
+// ---------------------------------------------
+// プールのスロット1つを所有するハンドル
+// ---------------------------------------------
+class FrameBlock {
+public:
+    FrameBlock() = default;
+    ~FrameBlock() { reset(); }
+
+    FrameBlock(FrameBlock&& o) noexcept : pool_(std::move(o.pool_)), p_(o.p_), len_(o.len_) {
+        o.p_   = nullptr;
+        o.len_ = 0;
+    }
+    FrameBlock& operator=(FrameBlock&& o) noexcept {
+        if (this != &o) {
+            reset();
+            pool_  = std::move(o.pool_);
+            p_     = o.p_;
+            len_   = o.len_;
+            o.p_   = nullptr;
+            o.len_ = 0;
+        }
+        return *this;
+    }
+    FrameBlock(const FrameBlock& o);
+    FrameBlock& operator=(const FrameBlock& o) {
+        if (this != &o) *this = FrameBlock(o);
+        return *this;
+    }
+
+    // スロットをプールへ返して空にする
+    void reset();
+
+    const uint8_t* data()  const { return p_; }
+    size_t         size()  const { return len_; }
+    bool           empty() const { return len_ == 0; }
+    ByteView       view()  const { return ByteView(p_, len_); }
+
+private:
+    friend class FramePool;
+    FrameBlock(std::shared_ptr<FramePool> pool, uint8_t* p, size_t n) : pool_(std::move(pool)), p_(p), len_(n) {}
+
+    std::shared_ptr<FramePool> pool_;
+    uint8_t*                   p_   = nullptr;
+    size_t                     len_ = 0;
+};
+
+// ---------------------------------------------
+// 固定長スロットのプール（FramePool::create() で作る）
+// ---------------------------------------------
+class FramePool : public std::enable_shared_from_this<FramePool> {
+public:
+    static constexpr size_t SLOT_SIZE   = (MAX_FRAME_LEN + 7) & ~size_t{7};   // 空きリストのポインタを置けるよう 8 の倍数
+    static constexpr size_t CHUNK_SLOTS = 64;
+
+    static std::shared_ptr<FramePool> create() { return std::shared_ptr<FramePool>(new FramePool()); }
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    // ------------------------------------------------------------
+    // 関数名 : acquire
+    // 概要   : スロットを1つ借りて bytes を写す（空きがなければ CHUNK_SLOTS 個を追加で確保）
+    // 例外   : bytes が SLOT_SIZE を超えると std::length_error
+    // ------------------------------------------------------------
+    FrameBlock acquire(ByteView bytes);
+
+    size_t capacity() const;   // 確保済みのスロット数
+    size_t in_use()   const;   // 貸し出し中のスロット数
+
+private:
+    friend class FrameBlock;
+    FramePool() = default;
+    void release(uint8_t* p);
+
+    mutable std::mutex mu_;
+    uint8_t*           free_   = nullptr;   // 空きスロットの連結リスト（スロットの先頭に次のアドレス）
+    size_t             in_use_ = 0;
+    std::vector<std::unique_ptr<uint8_t[]>> chunks_;
+};
+
+inline FrameBlock::FrameBlock(const FrameBlock& o) {
+    if (o.p_) *this = o.pool_->acquire(o.view());
+}
+
+inline void FrameBlock::reset() {
+    if (p_) pool_->release(p_);
+    pool_.reset();
+    p_   = nullptr;
+    len_ = 0;
+}
+
+} // namespace tr3
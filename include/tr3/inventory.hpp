@@ -0,0 +1,57 @@
+// =============================================
+// include/tr3/inventory.hpp
+// TR3シリーズ - Inventory 応答の解析
+// =============================================
+//
+// Inventory2 の応答は次の順で届く：
+//   1) ACK   : CMD=0x30, DATA=[F0][NN]      … NN = 検出したタグ数
+//   2) タグ応答 × NN : CMD=0x49, DATA=[DSFID][UID(8B)]
+//
+// UID は LSB → MSB の順で届く（表示時は MSB → LSB に並べ替える）。
+// =============================================
+#pragma once
+#include <array>
+#include <cstdint>
+#include <optional>
+
+#include "tr3/protocol.hpp"
+
+namespace tr3 {
+
+// ---------------------------------------------
+// Inventory タグ応答（1タグ）
+//  CMD=0x49, DATA= [DSFID][UID(8B)]
+// ---------------------------------------------
+struct TagInfo {
+    uint8_t dsfid{};
+    std::array<uint8_t,8> uid{};     // 受信順（LSB → MSB）
+
+    // UID を 64bit 整数として（uid[0] が最下位バイト）
+    uint64_t uid64() const {
+        uint64_t v = 0;
+        for (int i = 7; i >= 0; --i) v = (v << 8) | uid[i];
+        return v;
+    }
+};
+
+// ---------------------------------------------
+// Inventory ACK（タグ件数通知）
+//  フォーマット例：F0 NN
+// ---------------------------------------------
+inline std::optional<int> parse_uid_count(ByteView d) {
+    if (d.size() == 2 && d[0] == 0xF0) return static_cast<int>(d[1]);
+    return std::nullopt;
+}
+
+// ---------------------------------------------
+// Inventory タグ応答（1タグ）の解析
+// ---------------------------------------------
+inline std::optional<TagInfo> parse_tag(uint8_t cmd, ByteView d) {
+    if (cmd != RES_TAG || d.size() != 9) return std::nullopt;
+    TagInfo t;
+    t.dsfid = d[0];
+    for (int i = 0; i < 8; ++i) t.uid[i] = d[1 + i];
+    return t;
+}
+
+} // namespace tr3
@@ -0,0 +1,71 @@
+// =============================================
+// include/tr3/inventory_stream.hpp
+// TR3シリーズ - 連続 Inventory（ストリーミング）
+// =============================================
+//
+// Inventory2 を間を空けずに繰り返し、ACK（F0 NN）とタグ応答（CMD=0x49）を
+// ライブラリ側で解析して TagInfo をコールバックへ流す。
+//
+//  - 常に depth 個の Inventory2 を先行投入しておき、1サイクル完了ごとに
+//    次の1個を補充する（リーダ側の処理待ちで回線が空かないようにする）
+//  - run() は stop() / max_cycles 到達 / 通信エラーまで戻らない
+//  - コールバックは run() を呼んだスレッドで実行される
+// =============================================
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+#include "tr3/async_client.hpp"
+#include "tr3/inventory.hpp"
+
+namespace tr3 {
+
+class InventoryStream {
+public:
+    using TagCallback   = std::function<void(const TagInfo&)>;
+    using CycleCallback = std::function<void(uint64_t cycle, int tag_count)>;
+
+    explicit InventoryStream(AsyncClient& cli, uint8_t addr = 0x00) : cli_(cli), addr_(addr) {}
+
+    void on_tag(TagCallback cb)     { on_tag_   = std::move(cb); }
+    void on_cycle(CycleCallback cb) { on_cycle_ = std::move(cb); }   // 1サイクル完了ごと（任意）
+
+    // 先行投入する Inventory2 の数（既定 2）
+    void set_depth(int n) { depth_ = n > 0 ? n : 1; }
+
+    // ------------------------------------------------------------
+    // 関数名 : run
+    // 概要   : 連続 Inventory を実行する
+    // 引数   : max_cycles - 実行するサイクル数（0 = stop() まで無制限）
+    // 例外   : 通信エラー（切断/タイムアウト）で NetError
+    // ------------------------------------------------------------
+    void run(uint64_t max_cycles = 0);
+
+    // 別スレッドまたはコールバック内から停止要求（実行中のサイクルは完了を待つ）
+    void stop() { stop_ = true; }
+
+    // 直前（実行中）の run() で完了したサイクル数と受信タグ数（run() の開始で 0 に戻る）。
+    // 書くのは run() のスレッドだけ（relaxed）。他スレッドからの読み出しは目安の値
+    uint64_t cycles() const { return cycles_.load(std::memory_order_relaxed); }
+    uint64_t tags()   const { return tags_.load(std::memory_order_relaxed); }
+
+private:
+    void submit_one();
+
+    AsyncClient& cli_;
+    uint8_t      addr_;
+    int          depth_ = 2;
+
+    TagCallback   on_tag_;
+    CycleCallback on_cycle_;
+
+    std::atomic<bool>  stop_{false};
+    uint64_t           max_cycles_ = 0;
+    uint64_t           submitted_  = 0;
+    std::atomic<uint64_t> cycles_{0};
+    std::atomic<uint64_t> tags_{0};
+    std::exception_ptr error_;
+};
+
+} // namespace tr3
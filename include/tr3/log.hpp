@@ -0,0 +1,83 @@
+// =============================================
+// include/tr3/log.hpp
+// TR3シリーズ - 非同期ログ
+// =============================================
+//
+// 送受信フレームのダンプやメッセージを、I/O スレッドで整形・出力しないためのログ。
+//
+//  - 呼び出し側は固定長のバイナリレコード（時刻・レベル・方向・生バイト列）を
+//    ロックなしのリングバッファへ積むだけ（整形・localtime・コンソール出力なし）
+//  - 背景の書き出しスレッドがレコードを取り出し、その時点で初めて16進文字列へ整形する
+//  - リングが満杯なら待たずに捨てて dropped() を数える（I/O を止めない）
+//  - レベル未満のレコードは積まない。フレームダンプ（Level::FRAME）は既定で無効
+//
+// 出力形式（従来の std::cout 出力と同じ）：
+//   "09/04 18:13:13.316  [send]  02 00 4F 01 90 03 E5 0D"
+//
+// 対話用途など出力順を崩したくない場合は set_synchronous(true) で呼び出し側スレッドから直接書く。
+// =============================================
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+
+#include "tr3/protocol.hpp"   // ByteView
+
+namespace tr3::log {
+
+enum class Level : uint8_t {
+    FRAME = 0,   // 送受信フレームのダンプ
+    DEBUG = 1,
+    INFO  = 2,   // 既定
+    WARN  = 3,
+    ERR   = 4,
+    OFF   = 5,
+};
+
+// フレームの方向
+enum class Dir : uint8_t { NONE, SEND, RECV };
+
+namespace detail {
+inline std::atomic<uint8_t> g_level{ static_cast<uint8_t>(Level::INFO) };
+}
+
+// ------------------------------------------------------------
+// レベル判定（ホットパスではこれだけが常に実行される）
+// ------------------------------------------------------------
+inline bool enabled(Level lv) {
+    return static_cast<uint8_t>(lv) >= detail::g_level.load(std::memory_order_relaxed);
+}
+inline void  set_level(Level lv) { detail::g_level.store(static_cast<uint8_t>(lv), std::memory_order_relaxed); }
+inline Level level() { return static_cast<Level>(detail::g_level.load(std::memory_order_relaxed)); }
+
+// 文字列 → Level（"frame" / "debug" / "info" / "warn" / "error" / "off"。不明なら false）
+bool parse_level(std::string_view name, Level& out);
+
+// ------------------------------------------------------------
+// 出力設定
+// ------------------------------------------------------------
+void set_output(std::FILE* fp);          // 既定 stdout（所有しない）
+void set_synchronous(bool on);           // true = 呼び出し側スレッドで即時出力
+
+// ------------------------------------------------------------
+// 記録（レベル未満なら何もしない）
+// ------------------------------------------------------------
+void frame_record(Dir dir, ByteView raw);
+void text_record(Level lv, std::string_view msg);   // 長すぎるメッセージは切り詰める
+
+inline void frame(Dir dir, ByteView raw) {
+    if (enabled(Level::FRAME)) frame_record(dir, raw);
+}
+inline void write(Level lv, std::string_view msg) {
+    if (enabled(lv)) text_record(lv, msg);
+}
+
+// 積まれたレコードをすべて書き出すまで待つ
+// （書き出しスレッドが停止済みなら待たない。出力先が詰まっていても最大 1 秒で戻る）
+void flush();
+
+// リング満杯で捨てたレコード数
+uint64_t dropped();
+
+} // namespace tr3::log
@@ -0,0 +1,142 @@
+// =============================================
+// include/tr3/metrics.hpp
+// TR3シリーズ - 計測値（カウンタ・遅延ヒストグラム）と出力
+// =============================================
+//
+// Client / Parser が通信のたびに更新する計測値。読む側がいなくても常に更新されるので、
+// 書き込みは「ほぼタダ」になるようにしてある：
+//
+//  - Counter   : 書き込みは1スレッド（持ち主の Client / Parser）だけ。
+//                lock 付き命令を使わず relaxed の load + store で足す。
+//                別スレッドからの読み出しは atomic なので値が壊れない（多少古いだけ）
+//  - Histogram : HDR 形式の対数＋線形バケット（2 のべき乗ごとに 16 分割、誤差 6% 程度）。
+//                記録はバケット番号の計算（ビット演算のみ）とカウンタ 3〜4 個の更新
+//
+// 出力は MetricsSnapshot に値を集めてから行う（Client::collect_metrics など）：
+//
+//   MetricsSnapshot ms;
+//   cli.collect_metrics(ms, "reader=\"0\"");
+//   std::cout << ms.to_text();                                   // 人が読む要約
+//   write_file_atomic("/var/lib/node_exporter/tr3.prom", ms.to_prometheus());   // Prometheus
+// =============================================
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tr3 {
+
+// ---------------------------------------------
+// 単調増加カウンタ（書き込み1スレッド・読み出しは任意のスレッド）
+//  uint64_t と同じように ++ / += / 比較・表示ができる
+// ---------------------------------------------
+class Counter {
+public:
+    Counter() = default;
+    Counter(const Counter& o) : v_(o.value()) {}
+    Counter& operator=(const Counter& o) { v_.store(o.value(), std::memory_order_relaxed); return *this; }
+
+    void add(uint64_t n = 1) { v_.store(v_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+    Counter& operator++()           { add(1); return *this; }
+    Counter& operator+=(uint64_t n) { add(n); return *this; }
+
+    uint64_t value() const { return v_.load(std::memory_order_relaxed); }
+    operator uint64_t() const { return value(); }
+
+private:
+    std::atomic<uint64_t> v_{0};
+};
+
+// ---------------------------------------------
+// ヒストグラムの読み出し結果
+// ---------------------------------------------
+struct HistogramSnapshot {
+    std::vector<uint64_t> counts;   // バケットごとの件数（Histogram::lower_bound / upper_bound）
+    uint64_t count = 0;
+    uint64_t sum   = 0;
+    uint64_t max   = 0;
+
+    double mean() const { return count ? static_cast<double>(sum) / static_cast<double>(count) : 0.0; }
+    // q（0〜1）分位点。バケット内の最大値で返す（max を超えない）
+    uint64_t percentile(double q) const;
+};
+
+// ---------------------------------------------
+// 遅延ヒストグラム（値は整数。Client はマイクロ秒で記録する）
+//  - 0〜15 は 1 刻み、以降は [2^k, 2^(k+1)) を 16 等分
+//  - 2^36 以上（マイクロ秒なら約 19 時間）は最後のバケットに入れる
+// ---------------------------------------------
+class Histogram {
+public:
+    static constexpr int    SUB_BITS = 4;
+    static constexpr size_t SUB      = size_t{1} << SUB_BITS;
+    static constexpr int    MAX_MSB  = 35;
+    static constexpr size_t BUCKETS  = (MAX_MSB - SUB_BITS + 2) * SUB;
+
+    // 書き込みは1スレッドのみ
+    void record(uint64_t v) {
+        bump(counts_[index_of(v)], 1);
+        bump(count_, 1);
+        bump(sum_, v);
+        if (v > max_.load(std::memory_order_relaxed)) max_.store(v, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    HistogramSnapshot snapshot() const;
+
+    static size_t   index_of(uint64_t v);
+    static uint64_t lower_bound(size_t index);   // バケットの最小値
+    static uint64_t upper_bound(size_t index);   // バケットの最大値 + 1
+
+private:
+    static void bump(std::atomic<uint64_t>& a, uint64_t n) {
+        a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<uint64_t>, BUCKETS> counts_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+// ---------------------------------------------
+// 出力用に集めた計測値
+//  - name は Prometheus の規約どおり（tr3_xxx_total / tr3_xxx_seconds など）
+//  - labels は "reader=\"0\",ip=\"192.168.0.2\"" の形（空でもよい）
+//  - 同じ name の値は続けて追加しなくてもよい（出力時にまとめる）
+// ---------------------------------------------
+class MetricsSnapshot {
+public:
+    void counter(const std::string& name, const std::string& help, const std::string& labels, uint64_t value);
+    // h は unit_seconds 倍すると秒になる値で記録されたもの（マイクロ秒なら 1e-6）
+    void histogram(const std::string& name, const std::string& help, const std::string& labels,
+                   const HistogramSnapshot& h, double unit_seconds);
+
+    // 人が読む要約（1行1項目。ヒストグラムは件数・平均・p50/p90/p99・最大をミリ秒で）
+    std::string to_text() const;
+    // Prometheus テキスト形式（# HELP / # TYPE 付き。ヒストグラムは 2 のべき乗ごとの le）
+    std::string to_prometheus() const;
+
+    bool empty() const { return counters_.empty() && histograms_.empty(); }
+
+private:
+    struct CounterItem   { std::string name, help, labels; uint64_t value; };
+    struct HistogramItem { std::string name, help, labels; HistogramSnapshot h; double unit; };
+
+    std::vector<CounterItem>   counters_;
+    std::vector<HistogramItem> histograms_;
+};
+
+// ------------------------------------------------------------
+// 関数名 : write_file_atomic
+// 概要   : path + ".tmp" に書いてから rename で置き換える
+//          （node_exporter の textfile collector が書きかけを読まないように）。
+//          置き換える前に close の結果を確認し、ディスクへ同期する
+// 戻り値 : false = 書き込み／同期／置き換えに失敗（一時ファイルは消す）
+// ------------------------------------------------------------
+bool write_file_atomic(const std::string& path, const std::string& content);
+
+} // namespace tr3
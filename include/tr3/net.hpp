@@ -0,0 +1,174 @@
+// =============================================
+// include/tr3/net.hpp
+// TR3シリーズ - ソケット層（Windows / POSIX 共通ラッパ）
+// =============================================
+//
+// Client から OS 依存部分を切り離すための薄いラッパ。
+//  - Windows : WinSock2（WSAPoll / ioctlsocket）
+//  - POSIX   : BSD ソケット（poll / fcntl）
+//
+// 方針：
+//  - ソケットはすべてノンブロッキングで扱い、待ち合わせは poll 系で行う
+//    （タイムアウトを呼び出し単位で指定できるようにするため）
+//  - TCP_NODELAY を有効化（短いコマンドフレームを即時送出）
+//  - エラーは NetError 例外で通知する
+// =============================================
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+
+// Windows の max/min マクロ無効化
+#ifndef NOMINMAX
+#define NOMINMAX 1
+#endif
+
+#ifdef _WIN32
+#  include <winsock2.h>
+#  include <ws2tcpip.h>
+#  pragma comment(lib, "ws2_32.lib")
+#endif
+
+namespace tr3 {
+
+struct NetError : std::runtime_error { using std::runtime_error::runtime_error; };
+// 応答待ちの期限切れ（接続自体は生きている可能性がある。切断・送受信エラーは NetError）
+struct TimeoutError : NetError { using NetError::NetError; };
+
+namespace net {
+
+#ifdef _WIN32
+using socket_t = SOCKET;
+inline const socket_t INVALID_SOCK = INVALID_SOCKET;
+#else
+using socket_t = int;
+inline constexpr socket_t INVALID_SOCK = -1;
+#endif
+
+// ------------------------------------------------------------
+// 関数名 : startup / cleanup
+// 概要   : ソケットライブラリの初期化／後始末（Windows は WSAStartup/WSACleanup）
+// 備考   : POSIX では何もしない。呼び出しは対にすること
+// ------------------------------------------------------------
+void startup();
+void cleanup();
+
+// ------------------------------------------------------------
+// 関数名 : connect_tcp
+// 概要   : 指定IP/PORTへノンブロッキングでTCP接続し、接続済みソケットを返す
+// 引数   : ip         - 接続先IP（IPv4 ドット表記）
+//          port       - ポート番号
+//          timeout_ms - 接続完了までの待ち時間（ミリ秒）
+// 戻り値 : 接続済み（ノンブロッキング・TCP_NODELAY 設定済み）ソケット
+// 例外   : 失敗/タイムアウトで NetError
+// ------------------------------------------------------------
+socket_t connect_tcp(const std::string& ip, uint16_t port, int timeout_ms);
+
+// ------------------------------------------------------------
+// 関数名 : connect_start / connect_finish
+// 概要   : 待たない接続（イベントループ用）。connect_start で接続を開始し、
+//          書込可能（またはエラー）になったら connect_finish で結果を確定する
+// 戻り値 : connect_start - 接続中（または接続済み）のノンブロッキングソケット
+// 例外   : 失敗で NetError（connect_finish 失敗時、ソケットは呼び出し側で閉じる）
+// ------------------------------------------------------------
+socket_t connect_start(const std::string& ip, uint16_t port);
+void     connect_finish(socket_t s);
+
+// ------------------------------------------------------------
+// 関数名 : connect_unix
+// 概要   : Unix ドメインソケット（SOCK_STREAM）へ接続する
+// 引数   : path       - ソケットファイルのパス
+//          timeout_ms - 接続完了までの待ち時間（ミリ秒）
+// 戻り値 : 接続済み（ノンブロッキング）ソケット
+// 例外   : 失敗/タイムアウト、または Windows では NetError
+// ------------------------------------------------------------
+socket_t connect_unix(const std::string& path, int timeout_ms);
+
+// ------------------------------------------------------------
+// 関数名 : connect_udp
+// 概要   : 宛先を固定した UDP ソケットを作る（以降 send_some で1データグラムずつ送る）
+// 戻り値 : ノンブロッキングの UDP ソケット
+// 例外   : 失敗で NetError
+// ------------------------------------------------------------
+socket_t connect_udp(const std::string& ip, uint16_t port);
+
+// ------------------------------------------------------------
+// 関数名 : listen_tcp / accept_tcp
+// 概要   : 待受ソケットの作成と接続受付（シミュレータ等のサーバ側で使用）
+// 引数   : ip         - 待受アドレス（例: "127.0.0.1"、"0.0.0.0"）
+//          port       - ポート番号（0 で自動割当。実際の番号は local_port で取得）
+//          timeout_ms - 受付待ち時間（-1 で無制限）
+// 戻り値 : accept_tcp - 接続済みソケット（ノンブロッキング・TCP_NODELAY）。
+//                       タイムアウト時は INVALID_SOCK
+// 例外   : 失敗で NetError
+// ------------------------------------------------------------
+socket_t listen_tcp(const std::string& ip, uint16_t port, int backlog = 64);
+socket_t accept_tcp(socket_t listener, int timeout_ms);
+uint16_t local_port(socket_t s);
+
+// ------------------------------------------------------------
+// 関数名 : close_socket
+// 概要   : ソケットを閉じて INVALID_SOCK を代入する（無効値なら何もしない）
+// ------------------------------------------------------------
+void close_socket(socket_t& s);
+
+// ------------------------------------------------------------
+// 関数名 : set_nonblocking / set_nodelay
+// 概要   : ソケットオプション設定（失敗で NetError）
+// ------------------------------------------------------------
+void set_nonblocking(socket_t s);
+void set_nodelay(socket_t s);
+
+// ------------------------------------------------------------
+// 関数名 : set_keepalive
+// 概要   : TCP keepalive を有効化（無通信 idle_s 秒後から interval_s 秒間隔で
+//          count 回応答がなければ、カーネルが接続を切断扱いにする）
+// 備考   : 切断はその後の recv / send のエラーとして届く。
+//          細かい設定に対応しない OS では SO_KEEPALIVE のみ有効化する
+// ------------------------------------------------------------
+void set_keepalive(socket_t s, int idle_s, int interval_s, int count);
+
+// ------------------------------------------------------------
+// 関数名 : wait_readable / wait_writable
+// 概要   : 読込／書込可能になるまで最大 timeout_ms 待つ
+// 戻り値 : true = 可能, false = タイムアウト
+// 例外   : poll 失敗で NetError
+// ------------------------------------------------------------
+bool wait_readable(socket_t s, int timeout_ms);
+bool wait_writable(socket_t s, int timeout_ms);
+
+// ------------------------------------------------------------
+// 関数名 : wait_io
+// 概要   : 読込（常に）／書込（want_write 時）のどちらかが可能になるまで最大 timeout_ms 待つ
+// 戻り値 : IO_READABLE / IO_WRITABLE のビット和（0 = タイムアウト）
+//          エラー/切断は IO_READABLE として返す（recv 側で検出させる）
+// ------------------------------------------------------------
+enum : unsigned { IO_READABLE = 1u, IO_WRITABLE = 2u };
+unsigned wait_io(socket_t s, bool want_write, int timeout_ms);
+
+// ------------------------------------------------------------
+// 関数名 : send_all
+// 概要   : n バイトをすべて送信する（EWOULDBLOCK 時は書込可能まで待つ）
+// 例外   : 送信失敗/タイムアウトで NetError
+// ------------------------------------------------------------
+void send_all(socket_t s, const uint8_t* p, size_t n, int timeout_ms);
+
+// ------------------------------------------------------------
+// 関数名 : send_some
+// 概要   : 送れるだけ送信する（待たない）
+// 戻り値 : >=0 = 送信バイト数, -1 = 送信バッファ満杯（EWOULDBLOCK）
+// 例外   : それ以外のエラーで NetError
+// ------------------------------------------------------------
+long send_some(socket_t s, const uint8_t* p, size_t n);
+
+// ------------------------------------------------------------
+// 関数名 : recv_some
+// 概要   : カーネルに溜まっている分を最大 n バイト受信する（待たない）
+// 戻り値 : >0 = 受信バイト数, 0 = 相手が切断, -1 = 受信データなし（EWOULDBLOCK）
+// 例外   : それ以外のエラーで NetError
+// ------------------------------------------------------------
+long recv_some(socket_t s, uint8_t* p, size_t n);
+
+} // namespace net
+} // namespace tr3
@@ -22,11 +22,15 @@
 // =============================================
 
 #pragma once
+#include <array>
 #include <cstdint>
 #include <vector>
 #include <string>
 #include <stdexcept>
 #include <algorithm>
+#include <cstddef>
+
+#include "tr3/metrics.hpp"   // Counter（Parser::Stats）
 
 namespace tr3 {
 
@@ -40,6 +44,108 @@ inline constexpr uint8_t CR  = 0x0D;   // Carriage Return
 inline constexpr int HEADER_LEN = 4;   // ヘッダ部: STX, ADDR, CMD, LEN
 inline constexpr int FOOTER_LEN = 3;   // フッタ部: ETX, SUM, CR
 
+inline constexpr size_t MAX_DATA_LEN  = 255;                                   // LEN は 1 バイト
+inline constexpr size_t MAX_FRAME_LEN = HEADER_LEN + MAX_DATA_LEN + FOOTER_LEN;  // 262 バイト
+
+// コマンドコード（送信）
+inline constexpr uint8_t CMD_BUZZER     = 0x42;   // ブザー制御
+inline constexpr uint8_t CMD_SET        = 0x4E;   // 各種設定（コマンドモード／アンテナ切替）
+inline constexpr uint8_t CMD_ROM        = 0x4F;   // ROMバージョン確認
+inline constexpr uint8_t CMD_INVENTORY2 = 0x78;   // Inventory2
+
+// 応答コード（受信）
+inline constexpr uint8_t RES_ACK        = 0x30;   // ACK 応答
+inline constexpr uint8_t RES_NACK       = 0x31;   // NACK 応答
+inline constexpr uint8_t RES_TAG        = 0x49;   // Inventory タグ応答（DATA=[DSFID][UID 8B]）
+
+// ================================================================
+// ByteView 構造体
+//   - 連続したバイト列への読み取り専用ビュー（所有しない）
+//   - C++17 のため std::span<const uint8_t> の代わりに使用
+// ================================================================
+struct ByteView {
+    const uint8_t* ptr = nullptr;
+    size_t         len = 0;
+
+    constexpr ByteView() = default;
+    constexpr ByteView(const uint8_t* p, size_t n) : ptr(p), len(n) {}
+    ByteView(const std::vector<uint8_t>& v) : ptr(v.data()), len(v.size()) {}
+
+    constexpr const uint8_t* data()  const { return ptr; }
+    constexpr size_t         size()  const { return len; }
+    constexpr bool           empty() const { return len == 0; }
+    constexpr const uint8_t* begin() const { return ptr; }
+    constexpr const uint8_t* end()   const { return ptr + len; }
+    constexpr uint8_t operator[](size_t i) const { return ptr[i]; }
+};
+
+// ================================================================
+// encode_frame
+//   - [STX][ADDR][CMD][LEN][DATA...][ETX][SUM][CR] を out へ直接書き込む
+//   - out は HEADER_LEN + len + FOOTER_LEN バイト以上あること
+//   - ヒープを使わない。constexpr なので固定フレームはコンパイル時に生成できる
+//   - 戻値：書き込んだバイト数
+// ================================================================
+constexpr size_t encode_frame(uint8_t* out, uint8_t addr, uint8_t cmd, const uint8_t* data, size_t len) {
+    if (len > MAX_DATA_LEN) throw std::length_error("encode_frame: DATA が 255 バイトを超えています");
+    out[0] = STX;
+    out[1] = addr;
+    out[2] = cmd;
+    out[3] = static_cast<uint8_t>(len);
+    uint32_t sum = STX + addr + cmd + static_cast<uint32_t>(len) + ETX;
+    for (size_t i = 0; i < len; ++i) {
+        out[HEADER_LEN + i] = data[i];
+        sum += data[i];
+    }
+    out[HEADER_LEN + len]     = ETX;
+    out[HEADER_LEN + len + 1] = static_cast<uint8_t>(sum & 0xFF);
+    out[HEADER_LEN + len + 2] = CR;
+    return HEADER_LEN + len + FOOTER_LEN;
+}
+
+// ================================================================
+// FrameBuffer 構造体
+//   - 最大長（262 バイト）の送信フレームを保持する固定長バッファ
+//   - スタック上に置いて cmd::xxx(buf, ...) で組み立て、ByteView として送る
+// ================================================================
+struct FrameBuffer {
+    std::array<uint8_t, MAX_FRAME_LEN> bytes{};
+    size_t len = 0;
+
+    const uint8_t* data() const { return bytes.data(); }
+    size_t         size() const { return len; }
+    ByteView       view() const { return ByteView(bytes.data(), len); }
+    operator ByteView() const   { return view(); }
+
+    // 組み立て（戻値は組み立てたフレームのビュー）
+    ByteView assign(uint8_t addr, uint8_t cmd, ByteView data) {
+        len = encode_frame(bytes.data(), addr, cmd, data.data(), data.size());
+        return view();
+    }
+};
+
+// ================================================================
+// FixedFrame 構造体
+//   - DATA 長 N がコンパイル時に決まるフレーム（cmd::frames の定数用）
+// ================================================================
+template <size_t N>
+struct FixedFrame {
+    std::array<uint8_t, HEADER_LEN + N + FOOTER_LEN> bytes{};
+
+    constexpr const uint8_t* data() const { return bytes.data(); }
+    constexpr size_t         size() const { return bytes.size(); }
+    constexpr ByteView       view() const { return ByteView(bytes.data(), bytes.size()); }
+    constexpr operator ByteView() const   { return view(); }
+    std::vector<uint8_t>     to_vector() const { return std::vector<uint8_t>(bytes.begin(), bytes.end()); }
+};
+
+template <size_t N>
+constexpr FixedFrame<N> fixed_frame(uint8_t addr, uint8_t cmd, const std::array<uint8_t, N>& data) {
+    FixedFrame<N> f{};
+    encode_frame(f.bytes.data(), addr, cmd, data.data(), N);
+    return f;
+}
+
 // ================================================================
 // Frame 構造体
 //   - 送信コマンドを組み立てるための単位
@@ -57,6 +163,13 @@ struct Frame {
     // ------------------------------------------------------------
     std::vector<uint8_t> encode() const;
 
+    // ------------------------------------------------------------
+    // 関数: encode_to
+    // 概要: ヒープを使わず固定長バッファへ生成する
+    // 戻値: 生成したフレームのビュー（out を指す）
+    // ------------------------------------------------------------
+    ByteView encode_to(FrameBuffer& out) const { return out.assign(addr, cmd, ByteView(data)); }
+
     // ------------------------------------------------------------
     // 関数: calc_sum
     // 概要: STX〜ETXまでの総和を計算し、下位1バイトを返す
@@ -64,6 +177,7 @@ struct Frame {
     // 戻値: 計算されたSUM値（1バイト）
     // ------------------------------------------------------------
     static uint8_t calc_sum(const std::vector<uint8_t>& stx_to_etx);
+    static uint8_t calc_sum(ByteView stx_to_etx);   // コピーなし版
 };
 
 // ================================================================
@@ -76,14 +190,64 @@ struct Decoded {
     std::vector<uint8_t> data;   // データ部（LENバイト）
 };
 
+// ================================================================
+// FrameView 構造体
+//   - Parser::feed() が返す完成フレームのビュー（コピーなし）
+//   - data / raw は入力バッファ（または Parser 内部バッファ）を指す。
+//     次の feed()/push()/reset() 呼び出しまで、かつ入力バッファが
+//     有効な間だけ使用できる
+// ================================================================
+struct FrameView {
+    uint8_t  addr{};             // アドレス
+    uint8_t  cmd{};              // コマンドコード
+    ByteView data;               // データ部（LENバイト）
+    ByteView raw;                // STX〜CR の完全フレーム
+
+    Decoded to_decoded() const { return Decoded{ addr, cmd, std::vector<uint8_t>(data.begin(), data.end()) }; }
+};
+
 // ================================================================
 // Parser クラス
 //   - ストリーミング入力を解析する状態機械
 //   - 1バイトずつ push() で流し込み、フレーム完成時に true
 //   - 完成したら take() または take_raw() で取り出す
+//   - まとまったバッファは feed() で一括解析できる（フレームのビューを返す）
+//   - 再同期：ETX/CR/SUM 不正のフレームは先頭の STX 1バイトだけを捨て、
+//     溜めたバイトの中から次の STX 候補を探し直す（後続の正しいフレームを失わない）
+//   - 取り出されないまま次のバイトが来た完成フレームは捨て、そのバイトから解析を続ける
 // ================================================================
 class Parser {
 public:
+    // 解析の統計（累計。reset() ではクリアしない）
+    //  Counter（metrics.hpp）なので、解析中でも別スレッドから読める
+    struct Stats {
+        Counter frames;            // 完成フレーム数
+        Counter dropped_bytes;     // フレームにならずに捨てたバイト数
+        Counter checksum_errors;   // SUM 不一致
+        Counter format_errors;     // ETX / CR 位置の不正
+        Counter resyncs;           // 不正フレームの後に次の STX から探し直した回数
+    };
+
+    // feed() の結果
+    struct FeedResult {
+        size_t consumed = 0;     // 入力から消費したバイト数
+        bool   frame    = false; // true = out に完成フレームあり
+    };
+
+    // ------------------------------------------------------------
+    // 関数: feed
+    // 概要: 連続した入力バッファを走査し、最初の完成フレームまで解析する
+    // 引数: in  - 受信バイト列
+    //       out - 完成フレームのビュー（frame==true のときのみ有効）
+    // 戻値: FeedResult - 消費バイト数とフレーム完成有無
+    // 備考: フレームが入力内に丸ごと収まっていればコピーせず入力を指すビューを返す。
+    //       入力をまたぐフレームだけ内部バッファに一括コピーして組み立てる。
+    //       残り（in.size() - consumed）は次の feed() に渡すこと。
+    //       再同期で内部に完成フレームが残ることがあるため、frame==true の間は
+    //       入力が空になっても feed() を呼び続けること
+    // ------------------------------------------------------------
+    FeedResult feed(ByteView in, FrameView& out);
+
     // ------------------------------------------------------------
     // 関数: push
     // 概要: 受信した1バイトを内部バッファに追加し解析を進める
@@ -92,6 +256,15 @@ public:
     // ------------------------------------------------------------
     bool push(uint8_t byte);
 
+    // ------------------------------------------------------------
+    // 関数: resume
+    // 概要: 再同期で内部に残ったバイトから次の完成フレームを探す（入力なし）
+    // 戻値: true = 完成フレームあり（take/take_raw 可）
+    // 備考: push() は1バイトにつき1フレームしか返せないため、take() の後に
+    //       while (resume()) take(); として残りを取り出す
+    // ------------------------------------------------------------
+    bool resume();
+
     // ------------------------------------------------------------
     // 関数: take
     // 概要: 完成済みフレームを Decoded 構造体に変換して返す
@@ -109,58 +282,117 @@ public:
 
     // ------------------------------------------------------------
     // 関数: reset
-    // 概要: 内部バッファと状態をリセットする
+    // 概要: 内部バッファと状態をリセットする（未完成のバイトは dropped_bytes に計上）
     // ------------------------------------------------------------
     void reset();
 
+    const Stats& stats() const { return stats_; }
+    void reset_stats() { stats_ = Stats{}; }
+
 private:
+    // フレーム検証の結果
+    enum class Check { OK, FORMAT, CHECKSUM };
+
+    // STX〜CR の完全フレームの ETX/CR/SUM を検証
+    static Check check_frame(ByteView raw);
+    // 検証済み完全フレーム → FrameView
+    static FrameView view_of(ByteView raw);
+
+    // buf_ の内容から状態を決め直す（STX 合わせ・長さ確認・検証・不正時の再同期）
+    // 戻値: true = buf_ 先頭 frame_len_ バイトが完成フレーム
+    bool rescan();
+    // 完成フレーム（buf_ 先頭 frame_len_ バイト）を取り除き、後続バイトを残す
+    void drop_frame();
+    // 不正フレームの計上
+    void count_error(Check c);
+
     // 状態遷移（状態機械）
     enum class State { SEEK_STX, HEADER, PAYLOAD, FOOTER };
     State st_ = State::SEEK_STX;     // 現在の状態
 
-    std::vector<uint8_t> buf_;       // 内部受信バッファ
-    size_t need_ = 0;                // 残り読み取り必要バイト数
+    std::vector<uint8_t> buf_;       // 内部受信バッファ（先頭は常に STX。再同期後は後続バイトも含む）
+    size_t need_      = 0;           // 次の判定までに必要なバイト数
+    size_t frame_len_ = 0;           // FOOTER 状態の完成フレーム長
+    Stats  stats_;
 };
 
 // ================================================================
 // cmd 名前空間
 //   - よく使う標準コマンドのビルダー
-//   - 返り値は Frame.encode() で生成されたバイト列
+//   - cmd::xxx(...)        : std::vector で返す（従来どおり）
+//   - cmd::xxx(buf, ...)   : FrameBuffer へ書き込みビューを返す（ヒープ不使用）
+//   - cmd::frames::XXX     : ADDR=0x00 の固定コマンド（コンパイル時に生成済み）
 // ================================================================
 namespace cmd {
 
+    // ---- DATA 部の定義 ----
+    inline constexpr std::array<uint8_t, 1> ROM_DATA          = { 0x90 };
+    inline constexpr std::array<uint8_t, 4> COMMAND_MODE_DATA = { 0x00, 0x00, 0x00, 0x1C };
+    inline constexpr std::array<uint8_t, 3> INVENTORY2_DATA   = { 0xF0, 0x40, 0x01 };
+
+    // ---- 固定フレーム（ADDR=0x00） ----
+    namespace frames {
+        inline constexpr auto ROM_VERSION  = fixed_frame(0x00, CMD_ROM,        ROM_DATA);
+        inline constexpr auto COMMAND_MODE = fixed_frame(0x00, CMD_SET,        COMMAND_MODE_DATA);
+        inline constexpr auto INVENTORY2   = fixed_frame(0x00, CMD_INVENTORY2, INVENTORY2_DATA);
+        inline constexpr auto BUZZER_ON    = fixed_frame<2>(0x00, CMD_BUZZER,  { 0x01, 0x00 });
+        inline constexpr auto BUZZER_OFF   = fixed_frame<2>(0x00, CMD_BUZZER,  { 0x00, 0x00 });
+    }
+
+    // ---- 固定長バッファ版 ----
+
     // ROMバージョン確認コマンド
-    inline std::vector<uint8_t> check_rom_version(uint8_t addr=0x00) {
-        Frame f; f.addr=addr; f.cmd=0x4F; f.data = {0x90};
-        return f.encode();
+    inline ByteView check_rom_version(FrameBuffer& out, uint8_t addr=0x00) {
+        return out.assign(addr, CMD_ROM, ByteView(ROM_DATA.data(), ROM_DATA.size()));
     }
 
     // コマンドモード設定コマンド
-    inline std::vector<uint8_t> set_command_mode(uint8_t addr=0x00) {
-        Frame f; f.addr=addr; f.cmd=0x4E;
-        f.data = {0x00,0x00,0x00,0x1C};
-        return f.encode();
+    inline ByteView set_command_mode(FrameBuffer& out, uint8_t addr=0x00) {
+        return out.assign(addr, CMD_SET, ByteView(COMMAND_MODE_DATA.data(), COMMAND_MODE_DATA.size()));
     }
 
     // アンテナ切替コマンド
-    inline std::vector<uint8_t> switch_antenna(uint8_t ant, uint8_t addr=0x00) {
-        Frame f; f.addr=addr; f.cmd=0x4E;
-        f.data = {0x9C, ant};
-        return f.encode();
+    inline ByteView switch_antenna(FrameBuffer& out, uint8_t ant, uint8_t addr=0x00) {
+        const uint8_t d[2] = { 0x9C, ant };
+        return out.assign(addr, CMD_SET, ByteView(d, sizeof(d)));
     }
 
     // Inventory2 コマンド
-    inline std::vector<uint8_t> inventory2(uint8_t addr=0x00) {
-        Frame f; f.addr=addr; f.cmd=0x78;
-        f.data = {0xF0,0x40,0x01};
-        return f.encode();
+    inline ByteView inventory2(FrameBuffer& out, uint8_t addr=0x00) {
+        return out.assign(addr, CMD_INVENTORY2, ByteView(INVENTORY2_DATA.data(), INVENTORY2_DATA.size()));
     }
 
     // ブザー制御コマンド
+    inline ByteView buzzer(FrameBuffer& out, uint8_t onoff=0x01, uint8_t addr=0x00) {
+        const uint8_t d[2] = { onoff, 0x00 };
+        return out.assign(addr, CMD_BUZZER, ByteView(d, sizeof(d)));
+    }
+
+    // ---- std::vector 版 ----
+
+    inline std::vector<uint8_t> check_rom_version(uint8_t addr=0x00) {
+        FrameBuffer b; check_rom_version(b, addr);
+        return std::vector<uint8_t>(b.data(), b.data() + b.size());
+    }
+
+    inline std::vector<uint8_t> set_command_mode(uint8_t addr=0x00) {
+        FrameBuffer b; set_command_mode(b, addr);
+        return std::vector<uint8_t>(b.data(), b.data() + b.size());
+    }
+
+    inline std::vector<uint8_t> switch_antenna(uint8_t ant, uint8_t addr=0x00) {
+        FrameBuffer b; switch_antenna(b, ant, addr);
+        return std::vector<uint8_t>(b.data(), b.data() + b.size());
+    }
+
+    inline std::vector<uint8_t> inventory2(uint8_t addr=0x00) {
+        FrameBuffer b; inventory2(b, addr);
+        return std::vector<uint8_t>(b.data(), b.data() + b.size());
+    }
+
     inline std::vector<uint8_t> buzzer(uint8_t onoff=0x01, uint8_t addr=0x00) {
-        Frame f; f.addr=addr; f.cmd=0x42;
-        f.data = {onoff,0x00};
-        return f.encode();
+        FrameBuffer b; buzzer(b, onoff, addr);
+        return std::vector<uint8_t>(b.data(), b.data() + b.size());
     }
 }
 
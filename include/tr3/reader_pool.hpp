@@ -0,0 +1,105 @@
+// =============================================
+// include/tr3/reader_pool.hpp
+// TR3シリーズ - 複数リーダの一括制御（イベントループ）
+// =============================================
+//
+// 1プロセスで多数（数百台）のリーダを巡回するためのプール。
+//  - リーダごとに AsyncClient（ノンブロッキング）を持つ
+//  - 少数のワーカースレッドがそれぞれ epoll（Linux）／poll（その他）で
+//    担当リーダの接続を多重化する（リーダ i はワーカー i % workers が担当）
+//  - 各リーダで「アンテナ切替 → Inventory2」を1巡ぶん先行送信し、
+//    サイクル完了後 cycle_interval_ms 待って次のサイクルを開始する
+//    （巡回順・回数・休止・ブザーは AntennaScheduler に従う）
+//  - 接続時に ROMバージョン確認 → コマンドモード設定 を行う
+//  - 切断/タイムアウト時は reconnect_ms 後に再接続する
+//  - 検出タグは on_tag コールバック1本に集約して通知する。
+//    publish_to() を指定すると TagRecord としてロックなしキューにも積む（別スレッドで処理する用）
+//
+// 注意：
+//  - コールバックはワーカースレッドから呼ばれる。workers > 1 のときは
+//    複数スレッドから同時に呼ばれうるので、呼び出し側で排他すること
+//  - add_reader / on_tag / on_status / publish_to は start() 前に呼ぶこと
+// =============================================
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+#include "tr3/antenna_scheduler.hpp"
+#include "tr3/capture.hpp"
+#include "tr3/inventory.hpp"
+#include "tr3/tag_queue.hpp"
+
+namespace tr3 {
+
+// リーダ1台ぶんの設定
+struct ReaderConfig {
+    std::string ip;
+    uint16_t    port              = 9004;
+    uint8_t     addr              = 0x00;   // フレームの ADDR
+    int         antennas          = 1;      // 巡回するアンテナ数（ANT#0 〜。schedule 未指定時）
+    SchedulerConfig schedule;               // 重み・滞在・休止・ブザー（antennas が空なら均等巡回）
+    int         cycle_interval_ms = 0;      // サイクル間隔（0 = 連続）
+    int         timeout_ms        = 2000;   // 接続／応答タイムアウト
+    int         reconnect_ms      = 1000;   // 再接続までの待ち時間
+};
+
+// タグ検出イベント
+struct TagEvent {
+    uint32_t reader{};                              // add_reader() の戻り値
+    uint8_t  antenna{};                             // 検出したアンテナ番号
+    TagInfo  tag;                                   // DSFID / UID
+    std::chrono::system_clock::time_point time;     // 受信時刻
+};
+
+class ReaderPool {
+public:
+    using TagCallback    = std::function<void(const TagEvent&)>;
+    using StatusCallback = std::function<void(uint32_t reader, const std::string& message)>;
+
+    explicit ReaderPool(size_t workers = 1);
+    ~ReaderPool();
+    ReaderPool(const ReaderPool&) = delete;
+    ReaderPool& operator=(const ReaderPool&) = delete;
+
+    // リーダを追加し、識別番号（0 から連番）を返す
+    uint32_t add_reader(const ReaderConfig& cfg);
+
+    void on_tag(TagCallback cb)       { on_tag_    = std::move(cb); }
+    void on_status(StatusCallback cb) { on_status_ = std::move(cb); }   // 接続/切断などの通知
+
+    // 検出タグを q へも積む（nullptr で停止。q は stop() より長生きさせること）。
+    // 満杯なら捨てて q->dropped() で数える（ワーカーは待たない）
+    void publish_to(TagQueue* q) { queue_ = q; }
+
+    // 全リーダの送受信フレームを cap へ記録（レコードの reader = リーダ識別番号）
+    void set_capture(CaptureWriter* cap) { capture_ = cap; }
+
+    // ワーカースレッドを起動／停止（stop はスレッド終了まで待つ）
+    void start();
+    void stop();
+    bool running() const { return running_.load(); }
+
+    size_t size() const { return readers_.size(); }
+
+private:
+    struct Reader;
+    void worker_main(size_t index, size_t nthreads);
+
+    size_t workers_;
+    std::vector<std::unique_ptr<Reader>> readers_;
+    std::vector<std::thread>             threads_;
+    std::atomic<bool>                    running_{false};
+
+    TagCallback    on_tag_;
+    StatusCallback on_status_;
+    TagQueue*      queue_   = nullptr;
+    CaptureWriter* capture_ = nullptr;
+};
+
+} // namespace tr3
@@ -0,0 +1,62 @@
+// =============================================
+// include/tr3/ring_buffer.hpp
+// TR3シリーズ - 受信用リングバッファ（接続ごとに1つ）
+// =============================================
+//
+// recv() 1回でカーネルに溜まっている分をまとめて受け取り、
+// Parser が消費しきれなかったバイトは次のフレームのために残しておく。
+//
+//  - 容量 N は 2 のべき乗（インデックス計算をマスクで行う）
+//  - 読み書きとも「連続領域」単位で扱う（recv / Parser にそのまま渡せる）
+//  - 単一スレッド用（Client 内部で使用）
+// =============================================
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+namespace tr3 {
+
+template <size_t N>
+class RingBuffer {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "RingBuffer: N は 2 のべき乗");
+    static constexpr size_t MASK = N - 1;
+
+public:
+    static constexpr size_t capacity() { return N; }
+
+    size_t size()  const { return wr_ - rd_; }
+    size_t space() const { return N - size(); }
+    bool   empty() const { return wr_ == rd_; }
+
+    // ------------------------------------------------------------
+    // 読み出し側：先頭から連続して読める領域
+    // ------------------------------------------------------------
+    const uint8_t* read_ptr() const { return buf_.data() + (rd_ & MASK); }
+    size_t read_len() const { return std::min(size(), N - (rd_ & MASK)); }
+
+    // n バイト消費（空になったら先頭に巻き戻して連続領域を最大化）
+    void consume(size_t n) {
+        rd_ += std::min(n, size());
+        if (rd_ == wr_) rd_ = wr_ = 0;
+    }
+
+    // ------------------------------------------------------------
+    // 書き込み側：末尾に連続して書ける領域（recv の受け先）
+    // ------------------------------------------------------------
+    uint8_t* write_ptr() { return buf_.data() + (wr_ & MASK); }
+    size_t write_len() const { return std::min(space(), N - (wr_ & MASK)); }
+
+    // n バイト書き込んだことを確定
+    void commit(size_t n) { wr_ += std::min(n, write_len()); }
+
+    void clear() { rd_ = wr_ = 0; }
+
+private:
+    std::array<uint8_t, N> buf_{};
+    size_t rd_ = 0;   // 読み出し位置（単調増加）
+    size_t wr_ = 0;   // 書き込み位置（単調増加）
+};
+
+} // namespace tr3
@@ -0,0 +1,67 @@
+// =============================================
+// include/tr3/rtt.hpp
+// TR3シリーズ - 往復時間（RTT）の推定と応答タイムアウトの算出
+// =============================================
+//
+// TCP の再送タイマ（RFC 6298）と同じ考え方で、実測した往復時間から
+// 「この接続・このコマンドならここまで待てば十分」という時間を求める。
+//
+//   SRTT   ← 7/8 · SRTT   + 1/8 · R
+//   RTTVAR ← 3/4 · RTTVAR + 1/4 · |SRTT − R|
+//   RTO    =  SRTT + 4 · RTTVAR   （下限／上限で丸める）
+//
+// 再送した要求の応答は、どの送信に対する応答か分からないので標本にしない
+// （Karn のアルゴリズム。呼び出し側で判断する）。
+// =============================================
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace tr3 {
+
+class RttEstimator {
+public:
+    // ------------------------------------------------------------
+    // 関数名 : sample
+    // 概要   : 往復時間の実測値（ミリ秒）を1つ取り込む
+    // ------------------------------------------------------------
+    void sample(double ms) {
+        if (ms < 0.0) ms = 0.0;
+        if (n_ == 0) {
+            srtt_   = ms;
+            rttvar_ = ms / 2.0;
+        } else {
+            rttvar_ = 0.75 * rttvar_ + 0.25 * std::fabs(srtt_ - ms);
+            srtt_   = 0.875 * srtt_ + 0.125 * ms;
+        }
+        ++n_;
+    }
+
+    // ------------------------------------------------------------
+    // 関数名 : rto_ms
+    // 概要   : 応答タイムアウト（ミリ秒）
+    // 引数   : min_ms     - 下限（OS のタイマ分解能やリーダ内部の処理揺らぎぶん）
+    //          max_ms     - 上限
+    //          initial_ms - 標本がまだないときの値
+    // ------------------------------------------------------------
+    int rto_ms(int min_ms, int max_ms, int initial_ms) const {
+        const double v = n_ == 0 ? static_cast<double>(initial_ms) : srtt_ + 4.0 * rttvar_;
+        const int ms = static_cast<int>(std::ceil(v));
+        return std::max(min_ms, std::min(max_ms, ms));
+    }
+
+    bool     has_samples() const { return n_ > 0; }
+    uint64_t samples()     const { return n_; }
+    double   srtt_ms()     const { return srtt_; }
+    double   rttvar_ms()   const { return rttvar_; }
+
+    void reset() { srtt_ = rttvar_ = 0.0; n_ = 0; }
+
+private:
+    double   srtt_   = 0.0;
+    double   rttvar_ = 0.0;
+    uint64_t n_      = 0;
+};
+
+} // namespace tr3
@@ -0,0 +1,36 @@
+// =============================================
+// include/tr3/simd.hpp
+// TR3シリーズ - バイト列の走査カーネル（STX 探索・8bit 総和）
+// =============================================
+//
+// プロトコル層の内側ループ（SUM 計算）を SIMD で処理する。
+// STX 探索の find_byte は比較用（Parser は memchr を使う。libc の memchr のほうが速い：tr3_bench 参照）
+//  - x86 / x64 : SSE2（常に有効）。AVX2 は実行時に CPU を判定して切り替える
+//  - その他     : スカラー実装
+//  - TR3_NO_SIMD を定義するとスカラー実装に固定（比較・検証用）
+//
+// どちらもコピーなしでポインタ + 長さを受け取る。
+// =============================================
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace tr3::simd {
+
+// ------------------------------------------------------------
+// 関数名 : find_byte
+// 概要   : [p, p+n) から最初の v を探す（memchr と同じ意味）
+// 戻り値 : 見つかった位置。なければ nullptr
+// ------------------------------------------------------------
+const uint8_t* find_byte(const uint8_t* p, size_t n, uint8_t v);
+
+// ------------------------------------------------------------
+// 関数名 : sum_bytes
+// 概要   : [p, p+n) のバイトの総和（下位 8bit が TR3 の SUM）
+// ------------------------------------------------------------
+uint32_t sum_bytes(const uint8_t* p, size_t n);
+
+// 使用中の実装名（"avx2" / "sse2" / "scalar"）
+const char* kernel_name();
+
+} // namespace tr3::simd
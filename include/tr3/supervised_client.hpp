@@ -0,0 +1,148 @@
+// =============================================
+// include/tr3/supervised_client.hpp
+// TR3シリーズ - 自動再接続つきクライアント（長時間運用向け）
+// =============================================
+//
+// Client は切断されると NetError を投げるだけなので、呼び出し側は
+// 接続 → ROM確認 → コマンドモード設定 をやり直す必要がある。
+// SupervisedClient は Client を包み、次を肩代わりする：
+//
+//  - 死活監視：TCP keepalive に加え、無通信が idle_probe_ms 続いたら
+//              次のコマンドの前に ROM確認（probe）を送って生存を確かめる
+//  - 切断判定：NetError（切断・送受信エラー）は即、TimeoutError は
+//              max_timeouts 回連続したら接続を捨てる
+//  - 再接続  ：次の transact / receive_only（または ensure_connected）で、
+//              待ち時間を reconnect_min_ms から倍々に（上限 reconnect_max_ms、±20% の揺らぎ）
+//              伸ばしながら接続をやり直す
+//  - 再設定  ：接続のたびに setup のコマンド（既定：ROM確認 + コマンドモード）を再送
+//
+// 呼び出し側は NetError を受けたら「いまのステップ」からやり直すだけでよい
+// （再接続と再設定は次の呼び出しの中で行われる）。
+//
+//   SupervisedClient sup(cfg);
+//   for (;;) {
+//       try { sup.transact(cmd::frames::INVENTORY2); ... }
+//       catch (const NetError&) { continue; }   // 次の呼び出しで再接続される
+//   }
+//
+// 単一スレッド用。stop() だけは別スレッドから呼んでよい（再接続待ちを中断する）。
+// =============================================
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "tr3/client.hpp"
+
+namespace tr3 {
+
+struct SessionConfig {
+    std::string ip;
+    uint16_t    port              = 9004;
+    int         timeout_ms        = 5000;   // 接続タイムアウト兼、応答タイムアウトの上限
+    int         reconnect_min_ms  = 100;    // 最初の再接続までの待ち時間
+    int         reconnect_max_ms  = 5000;   // 再接続間隔の上限
+    double      reconnect_backoff = 2.0;    // 失敗ごとの倍率
+    int         idle_probe_ms     = 2000;   // 無通信がこの時間続いたら probe（0 = しない）
+    int         keepalive_s       = 5;      // TCP keepalive の開始までの無通信秒数（0 = 使わない）
+    int         max_timeouts      = 3;      // 連続タイムアウトがこの回数で接続を捨てる
+    int         connect_wait_ms   = -1;     // 1回の呼び出しが再接続を待つ上限（-1 = つながるまで待つ）
+    // 接続のたびに送るコマンド（空なら ROM確認 + コマンドモード設定）
+    std::vector<std::vector<uint8_t>> setup;
+};
+
+class SupervisedClient {
+public:
+    using Reply      = Client::Reply;
+    using BatchReply = Client::BatchReply;
+    using clock = std::chrono::steady_clock;
+    using StatusCallback = std::function<void(const std::string& message)>;
+
+    explicit SupervisedClient(SessionConfig cfg);
+    SupervisedClient(const SupervisedClient&) = delete;
+    SupervisedClient& operator=(const SupervisedClient&) = delete;
+
+    // 接続／切断／再接続失敗などの通知（呼び出したスレッドで呼ばれる）
+    void on_status(StatusCallback cb) { on_status_ = std::move(cb); }
+
+    // ------------------------------------------------------------
+    // 関数名 : ensure_connected
+    // 概要   : 接続済みでなければ、成功するか stop() されるまで再接続を繰り返す
+    // 例外   : stop() 済みなら NetError("stopped")。connect_wait_ms >= 0 でその時間内に
+    //          つながらなければ NetError（再接続の待ち時間は次の呼び出しへ持ち越す）
+    // ------------------------------------------------------------
+    void ensure_connected();
+
+    // ------------------------------------------------------------
+    // 関数名 : transact / receive_only
+    // 概要   : Client の同名関数と同じ。呼び出し前に必要なら再接続・probe を行い、
+    //          失敗時は切断判定をしてから例外をそのまま投げ直す
+    // ------------------------------------------------------------
+    Reply transact(ByteView frame, int retries = 1, int timeout_ms = -1);
+    Reply receive_only(int timeout_ms = -1);
+    // 複数コマンドの一括送信（Client::transact_batch）。再接続・probe は transact と同じ
+    std::vector<BatchReply> transact_batch(const CommandBatch& batch, int timeout_ms = -1);
+    void transact_batch(const CommandBatch& batch, std::vector<BatchReply>& out, int timeout_ms = -1);
+
+    // 無通信が idle_probe_ms を超えていれば probe を送る（待ち時間中に呼ぶ用）
+    // 戻り値 : false = probe に失敗して切断した
+    bool probe_if_idle();
+
+    // 再接続待ちを中断し、以降の呼び出しを NetError で失敗させる（別スレッドから可）
+    void stop();
+    bool stopped() const { return stop_.load(); }
+
+    // 接続を捨てる（次の呼び出しで再接続）
+    void drop(const std::string& reason);
+
+    bool     connected()  const { return cli_.connected(); }
+    uint64_t reconnects() const { return reconnects_; }
+    // 接続の世代（接続・再接続に成功するたびに 1 増える。0 = まだ接続していない）。
+    // 呼び出しの中で黙って再接続されると、setup の再送でリーダの状態（アンテナなど）が既定に戻る。
+    // 呼び出しの前後で値が変わっていたら、設定し直すこと
+    uint64_t generation() const { return generation_; }
+    // 直近の接続で setup コマンドに返った応答（setup と同じ順）
+    const std::vector<Reply>& setup_replies() const { return setup_replies_; }
+
+    // Client の計測値（collect_metrics）に再接続回数を加えて out へ追加する
+    void collect_metrics(MetricsSnapshot& out, const std::string& labels = "") const {
+        cli_.collect_metrics(out, labels);
+        out.counter("tr3_reconnects_total", "Reconnections after a dropped session.", labels, reconnects_);
+    }
+
+    Client&       client()       { return cli_; }
+    const Client& client() const { return cli_; }
+
+private:
+    bool try_connect();                       // 1回だけ接続 + setup（失敗時 false）
+    bool sleep_for(std::chrono::milliseconds d);   // stop() で中断されたら false
+    void schedule_retry();                    // 次の接続を試す時刻を決める（failures_ に応じた待ち）
+    void note_ok() { last_io_ = clock::now(); timeouts_ = 0; }
+    void note_error(const NetError& e);
+    void status(const std::string& msg) { if (on_status_) on_status_(msg); }
+
+    SessionConfig  cfg_;
+    Client         cli_;
+    StatusCallback on_status_;
+
+    std::vector<Reply> setup_replies_;
+    clock::time_point  last_io_{};
+    int                timeouts_   = 0;
+    int                failures_   = 0;   // 連続した接続失敗
+    clock::time_point  next_try_{};       // 次に接続を試してよい時刻
+    uint64_t           reconnects_ = 0;
+    uint64_t           generation_ = 0;
+    bool               ever_connected_ = false;
+    uint32_t           rng_ = 0x9E3779B9u;
+
+    std::atomic<bool>       stop_{false};
+    std::mutex              mu_;
+    std::condition_variable cv_;
+};
+
+} // namespace tr3
@@ -0,0 +1,111 @@
+// =============================================
+// include/tr3/tag_cache.hpp
+// TR3シリーズ - タグ重複排除キャッシュ
+// =============================================
+//
+// 同じ UID が「読取回数 × アンテナ数」のサイクルごとに何度も報告されるため、
+// 上位へはイベント（初検出／継続検出／消失）だけを送る。
+//
+//  - キーは TagInfo::uid の 8 バイトを 64bit 整数化したもの（文字列化しない）
+//  - 開番地法（線形探索）のハッシュ表。容量は 2 のべき乗、負荷率 1/2 超で倍増
+//  - 削除は後方シフト（墓標なし）で探索長を短く保つ
+//  - アンテナごとの読取回数を保持
+//
+// イベント：
+//  - FIRST_SEEN : 初めて（または消失後に再び）読めた
+//  - LAST_SEEN  : 読み続けている（refresh_ms ごとに1回。0 で通知しない）
+//  - LOST       : lost_after_ms の間読めなかった（expire() で判定）
+//
+// 単一スレッド用。
+// =============================================
+#pragma once
+#include <array>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+
+#include "tr3/inventory.hpp"
+
+namespace tr3 {
+
+// TagCache の設定
+struct TagCacheConfig {
+    int lost_after_ms = 3000;   // この時間読めなければ LOST
+    int refresh_ms    = 0;      // 継続検出の通知間隔（0 = 通知しない）
+};
+
+class TagCache {
+public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr size_t MAX_ANTENNAS = 8;   // アンテナ別カウンタの数（これ以上の番号は最後に集計）
+
+    using Config = TagCacheConfig;
+
+    enum class EventType : uint8_t { FIRST_SEEN, LAST_SEEN, LOST };
+
+    // タグ1件ぶんの状態
+    struct Entry {
+        uint64_t          uid = 0;
+        uint8_t           dsfid = 0;
+        uint8_t           antenna = 0;           // 最後に読めたアンテナ
+        uint32_t          reads = 0;             // 0 = 空きスロット
+        clock::time_point first{};
+        clock::time_point last{};
+        clock::time_point reported{};            // 最後にイベントを出した時刻
+        std::array<uint32_t, MAX_ANTENNAS> ant_reads{};
+    };
+
+    // tag は通知時点の写し（表の中を指さないので、コールバック内で observe() して
+    // 表が伸びたり、LOST で削除されたりしても無効にならない）
+    struct Event {
+        EventType type;
+        Entry     tag;
+    };
+    using Callback = std::function<void(const Event&)>;
+
+    explicit TagCache(Config cfg = {}, Callback cb = {}, size_t initial_capacity = 256);
+
+    void on_event(Callback cb) { cb_ = std::move(cb); }
+
+    // ------------------------------------------------------------
+    // 関数名 : observe
+    // 概要   : 読取1件を登録（新規なら FIRST_SEEN、refresh_ms 経過なら LAST_SEEN）
+    // ------------------------------------------------------------
+    void observe(uint64_t uid, uint8_t dsfid, uint8_t antenna, clock::time_point now = clock::now());
+    void observe(const TagInfo& t, uint8_t antenna, clock::time_point now = clock::now()) {
+        observe(t.uid64(), t.dsfid, antenna, now);
+    }
+
+    // ------------------------------------------------------------
+    // 関数名 : expire
+    // 概要   : lost_after_ms 以上読めていないタグを LOST 通知して削除
+    // 備考   : 全スロット走査。サイクル完了ごと程度の頻度で呼ぶ
+    // ------------------------------------------------------------
+    void expire(clock::time_point now = clock::now());
+
+    const Entry* find(uint64_t uid) const;
+    size_t size() const { return size_; }
+    void clear();
+
+private:
+    static uint64_t mix(uint64_t x) {
+        // splitmix64 の最終段（先頭バイトが共通の UID でも散らす）
+        x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+    size_t slot_of(uint64_t uid) const { return static_cast<size_t>(mix(uid)) & (slots_.size() - 1); }
+    void grow();
+    void erase_at(size_t i);
+
+    Config             cfg_;
+    Callback           cb_;
+    std::vector<Entry> slots_;
+    size_t             size_ = 0;
+};
+
+} // namespace tr3
@@ -0,0 +1,238 @@
+// =============================================
+// include/tr3/tag_queue.hpp
+// TR3シリーズ - タグレコードのロックなしキュー（スレッド間の受け渡し）
+// =============================================
+//
+// 通信スレッドが読み取ったタグを、別スレッド（集計・業務処理）へ渡すための
+// 容量固定のキュー。ミューテックスも1件ごとのヒープ確保も使わない。
+//
+//  - SpscQueue<T, N> : 書き込み1スレッド → 読み出し1スレッド（Client / SupervisedClient を回す1本）
+//  - MpscQueue<T, N> : 書き込み複数スレッド → 読み出し1スレッド（ReaderPool のワーカー群など）
+//  - 容量 N は 2 のべき乗。スロット配列は構築時に1回だけ確保する
+//  - 書き込み側と読み出し側の位置（インデックス）は別々のキャッシュラインに置く
+//    （互いの更新でキャッシュラインが行き来しない）
+//  - 満杯なら待たずに false を返して dropped() で数える（通信スレッドを止めない）
+//  - 読み出し側は pop_batch() でまとめて取り出す。空のときの待ち方（眠る・他の処理をする）は
+//    呼び出し側が決める
+//
+//   MpscQueue<TagRecord, 8192> q;
+//   // 通信スレッド
+//   q.try_push(TagRecord::make(reader, ant, tag, std::chrono::system_clock::now()));
+//   // 処理スレッド
+//   TagRecord buf[256];
+//   for (;;) {
+//       const size_t n = q.pop_batch(buf, 256);
+//       for (size_t i = 0; i < n; ++i) handle(buf[i]);
+//       if (n == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+//   }
+// =============================================
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+#include "tr3/inventory.hpp"   // TagInfo
+
+namespace tr3 {
+
+inline constexpr size_t CACHE_LINE = 64;
+
+// ---------------------------------------------
+// タグ1件（固定長 24 バイト、memcpy でそのまま運べる）
+// ---------------------------------------------
+struct TagRecord {
+    int64_t  time_us  = 0;          // 受信時刻（system_clock のエポックからのマイクロ秒）
+    uint32_t reader   = 0;          // リーダ識別番号（ReaderPool::add_reader の戻り値など）
+    uint8_t  antenna  = 0;          // 検出したアンテナ番号
+    uint8_t  dsfid    = 0;
+    uint16_t reserved = 0;
+    std::array<uint8_t, 8> uid{};   // 受信順（LSB → MSB）
+
+    static TagRecord make(uint32_t reader, uint8_t antenna, const TagInfo& t,
+                          std::chrono::system_clock::time_point time) {
+        TagRecord r;
+        r.time_us = std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+        r.reader  = reader;
+        r.antenna = antenna;
+        r.dsfid   = t.dsfid;
+        r.uid     = t.uid;
+        return r;
+    }
+
+    // UID を 64bit 整数として（uid[0] が最下位バイト。TagInfo::uid64 と同じ）
+    uint64_t uid64() const {
+        uint64_t v = 0;
+        for (int i = 7; i >= 0; --i) v = (v << 8) | uid[i];
+        return v;
+    }
+};
+static_assert(sizeof(TagRecord) == 24, "TagRecord は固定長 24 バイト");
+static_assert(std::is_trivially_copyable_v<TagRecord>);
+
+// ---------------------------------------------
+// 書き込み1・読み出し1
+//  - 書き込み側は tail、読み出し側は head だけを更新する
+//  - 相手側の位置は手元に控え（head_cache / tail_cache）、
+//    満杯／空に見えたときだけ読み直す（相手のキャッシュラインを読む回数を減らす）
+// ---------------------------------------------
+template <typename T, size_t N>
+class SpscQueue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue: N は 2 のべき乗");
+    static_assert(std::is_trivially_copyable_v<T>, "SpscQueue: T は trivially copyable");
+    static constexpr size_t MASK = N - 1;
+
+public:
+    SpscQueue() : buf_(new T[N]) {}
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    static constexpr size_t capacity() { return N; }
+
+    // 書き込み側（1スレッドのみ）。満杯なら false
+    bool try_push(const T& v) {
+        const size_t t = prod_.tail.load(std::memory_order_relaxed);
+        if (t - prod_.head_cache == N) {
+            prod_.head_cache = cons_.head.load(std::memory_order_acquire);
+            if (t - prod_.head_cache == N) {
+                prod_.dropped.store(prod_.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+        buf_[t & MASK] = v;
+        prod_.tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 読み出し側（1スレッドのみ）。最大 max 件を out へ取り出し、件数を返す
+    size_t pop_batch(T* out, size_t max) {
+        const size_t h = cons_.head.load(std::memory_order_relaxed);
+        size_t avail = cons_.tail_cache - h;
+        if (avail == 0) {
+            cons_.tail_cache = prod_.tail.load(std::memory_order_acquire);
+            avail = cons_.tail_cache - h;
+            if (avail == 0) return 0;
+        }
+        const size_t n = avail < max ? avail : max;
+        for (size_t i = 0; i < n; ++i) out[i] = buf_[(h + i) & MASK];
+        cons_.head.store(h + n, std::memory_order_release);
+        return n;
+    }
+
+    bool try_pop(T& out) { return pop_batch(&out, 1) == 1; }
+
+    // おおよその件数（どちらのスレッドからでも。目安用）
+    size_t size_approx() const {
+        return prod_.tail.load(std::memory_order_acquire) - cons_.head.load(std::memory_order_acquire);
+    }
+    // 満杯で捨てた件数
+    uint64_t dropped() const { return prod_.dropped.load(std::memory_order_relaxed); }
+
+private:
+    struct alignas(CACHE_LINE) Producer {
+        std::atomic<size_t>   tail{0};
+        size_t                head_cache = 0;
+        std::atomic<uint64_t> dropped{0};
+    };
+    struct alignas(CACHE_LINE) Consumer {
+        std::atomic<size_t> head{0};
+        size_t              tail_cache = 0;
+    };
+
+    Producer             prod_;
+    Consumer             cons_;
+    std::unique_ptr<T[]> buf_;
+};
+
+// ---------------------------------------------
+// 書き込み複数・読み出し1（log.cpp のリングと同じ Vyukov 型）
+//  - 各スロットは通し番号 seq を持つ。書き込み側は enq を CAS で進めてスロットを確保し、
+//    値を書いてから seq = pos + 1 を公開する
+//  - 読み出し側は seq == deq + 1 のスロットだけを取り出し、seq = deq + N に戻して再利用可能にする
+//    （書き込み途中のスロットがあればそこで止まり、後続は次の pop_batch で取り出す）
+// ---------------------------------------------
+template <typename T, size_t N>
+class MpscQueue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "MpscQueue: N は 2 のべき乗");
+    static_assert(std::is_trivially_copyable_v<T>, "MpscQueue: T は trivially copyable");
+    static constexpr size_t MASK = N - 1;
+
+public:
+    MpscQueue() : slots_(new Slot[N]) {
+        for (size_t i = 0; i < N; ++i) slots_[i].seq.store(i, std::memory_order_relaxed);
+    }
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    static constexpr size_t capacity() { return N; }
+
+    // 書き込み側（複数スレッドから可）。満杯なら false
+    bool try_push(const T& v) {
+        size_t pos = prod_.enq.load(std::memory_order_relaxed);
+        Slot* s;
+        for (;;) {
+            s = &slots_[pos & MASK];
+            const size_t seq = s->seq.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (prod_.enq.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                prod_.dropped.fetch_add(1, std::memory_order_relaxed);   // 満杯
+                return false;
+            } else {
+                pos = prod_.enq.load(std::memory_order_relaxed);
+            }
+        }
+        s->value = v;
+        s->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 読み出し側（1スレッドのみ）。最大 max 件を out へ取り出し、件数を返す
+    size_t pop_batch(T* out, size_t max) {
+        size_t deq = cons_.deq.load(std::memory_order_relaxed);
+        size_t n = 0;
+        while (n < max) {
+            Slot& s = slots_[deq & MASK];
+            if (s.seq.load(std::memory_order_acquire) != deq + 1) break;   // 空、または書き込み途中
+            out[n++] = s.value;
+            s.seq.store(deq + N, std::memory_order_release);
+            ++deq;
+        }
+        if (n) cons_.deq.store(deq, std::memory_order_relaxed);
+        return n;
+    }
+
+    bool try_pop(T& out) { return pop_batch(&out, 1) == 1; }
+
+    // おおよその件数（目安用。確保済みで書き込み途中のものを含む）
+    size_t size_approx() const {
+        return prod_.enq.load(std::memory_order_relaxed) - cons_.deq.load(std::memory_order_relaxed);
+    }
+    uint64_t dropped() const { return prod_.dropped.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        std::atomic<size_t> seq{0};
+        T                   value;
+    };
+    struct alignas(CACHE_LINE) Producer {
+        std::atomic<size_t>   enq{0};
+        std::atomic<uint64_t> dropped{0};
+    };
+    struct alignas(CACHE_LINE) Consumer {
+        std::atomic<size_t> deq{0};
+    };
+
+    Producer                prod_;
+    Consumer                cons_;
+    std::unique_ptr<Slot[]> slots_;
+};
+
+// ReaderPool のワーカー群 → 処理スレッド 用の既定の型
+using TagQueue = MpscQueue<TagRecord, 16384>;
+
+} // namespace tr3
@@ -0,0 +1,272 @@
+// =============================================
+// include/tr3/tag_sink.hpp
+// TR3シリーズ - タグレコードの送出（ファイル / Unix ソケット / TCP / UDP）
+// =============================================
+//
+// 読み取ったタグを外部（ファイル・集計プロセス・ログ収集など）へ流すためのもの。
+// 送り先が遅い／止まっていても、読取の通信スレッドは待たされない：
+//
+//   通信スレッド ── publish() ──▶ TagQueue（容量固定・ロックなし）
+//                                    │
+//                         送出スレッド（TagExporter 内部）
+//                                    │ TagEncoder で形式どおりに組み立て、
+//                                    │ batch_bytes を超えるか flush_ms 経ったらまとめて
+//                                    ▼
+//                              SinkTransport（ファイル・ソケット）
+//
+//  - 送り先が書けない間は、組み立て済みのまとまりを max_pending_bytes まで溜めて再試行する
+//  - それを超えたときの扱い（SinkPolicy）：
+//      DROP_NEWEST : 溜めるのをやめる → キューが満杯になり、新しいタグを捨てる
+//      DROP_OLDEST : 溜めたものを古い順に捨てて、新しいタグを残す
+//      BLOCK       : DROP_NEWEST と同じだが、publish() が最大 block_ms だけ空きを待つ。
+//                    待つのは1秒あたり合計 block_budget_ms まで（使い切ったら待たずに捨てる。
+//                    送り先が止まっても、通信スレッドが止まるのはこの時間まで）
+//  - 捨てた件数は stats() / collect_metrics() で数える（stop() の後は publish() した件数 =
+//    書けた件数 + dropped()。tr3_bench の [TagExporter] で送り先が遅い／止まっている場合を確認できる）
+//
+//   auto ex = std::make_unique<TagExporter>(make_sink("tcp:127.0.0.1:9100"), ExportConfig{});
+//   ex->publish(TagRecord::make(reader, ant, tag, std::chrono::system_clock::now()));
+//   pool.publish_to(&ex->queue());   // ReaderPool のワーカーから直接積む場合
+//
+// 送り先の指定（make_sink）：
+//   file:PATH          追記。rotate_bytes を超えたら PATH.1, PATH.2, …（keep 個まで）へ回す
+//   unix:PATH          Unix ドメインソケット（SOCK_STREAM。POSIX のみ）
+//   tcp:HOST:PORT      TCP（切断されたら待ち時間を倍々に伸ばしながら再接続）
+//   udp:HOST:PORT      UDP（1データグラム = 1件以上の完全なレコード。ヘッダなし）
+//
+// ファイル・接続の先頭には形式のヘッダ（バイナリのファイルヘッダ・CSV の見出し行）を付ける。
+// =============================================
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tr3/metrics.hpp"     // Counter / MetricsSnapshot
+#include "tr3/net.hpp"         // socket_t
+#include "tr3/tag_queue.hpp"   // TagRecord / TagQueue
+#include "tr3/tag_writer.hpp"  // TagFormat / TagEncoder
+
+namespace tr3 {
+
+// ---------------------------------------------
+// 送り先（送出スレッドだけが使う）
+// ---------------------------------------------
+class SinkTransport {
+public:
+    using clock = std::chrono::steady_clock;
+    virtual ~SinkTransport() = default;
+
+    // 書ける状態にする（ファイルを開く・接続する）。false = 今は無理（後で再試行）
+    virtual bool ready(clock::time_point now) = 0;
+    // 次の write が新しいファイル／接続の先頭か（true ならヘッダを先に書く）
+    virtual bool at_start() const = 0;
+    // n バイトをすべて書く。false = 失敗（ソケットは閉じ、次の ready で開き直す）
+    virtual bool write(const char* p, size_t n) = 0;
+    // 1回の write の上限（UDP のデータグラム長。0 = なし）
+    virtual size_t max_write() const { return 0; }
+    // ready() が false の後、次に試してよい時刻（送出スレッドが待つ長さを決める）
+    virtual clock::time_point retry_at() const { return {}; }
+    virtual void close() = 0;
+    virtual std::string describe() const = 0;
+};
+
+// ---------------------------------------------
+// ファイル（サイズで世代を回す）
+// ---------------------------------------------
+class RotatingFileSink : public SinkTransport {
+public:
+    // rotate_bytes = 0 なら回さない。keep = 残す古い世代の数（PATH.1 〜 PATH.keep）
+    explicit RotatingFileSink(std::string path, uint64_t rotate_bytes = 64ull << 20, int keep = 5)
+        : path_(std::move(path)), rotate_bytes_(rotate_bytes), keep_(keep) {}
+    ~RotatingFileSink() override { close(); }
+
+    bool ready(clock::time_point now) override;
+    bool at_start() const override { return size_ == 0; }
+    bool write(const char* p, size_t n) override;
+    clock::time_point retry_at() const override { return retry_at_; }
+    void close() override;
+    std::string describe() const override { return "file:" + path_; }
+
+private:
+    void rotate();
+
+    std::string path_;
+    uint64_t    rotate_bytes_;
+    int         keep_;
+    std::FILE*  fp_   = nullptr;
+    uint64_t    size_ = 0;
+    clock::time_point retry_at_{};
+};
+
+// ---------------------------------------------
+// ストリームソケット（TCP / Unix ドメイン）
+// ---------------------------------------------
+class StreamSocketSink : public SinkTransport {
+public:
+    static std::unique_ptr<StreamSocketSink> tcp(std::string host, uint16_t port);
+    static std::unique_ptr<StreamSocketSink> unix_socket(std::string path);
+    ~StreamSocketSink() override { close(); }
+
+    bool ready(clock::time_point now) override;
+    bool at_start() const override { return fresh_; }
+    bool write(const char* p, size_t n) override;
+    clock::time_point retry_at() const override { return retry_at_; }
+    void close() override { net::close_socket(sock_); }
+    std::string describe() const override;
+
+    int connect_timeout_ms = 1000;
+    int send_timeout_ms    = 1000;   // これより長く送れなければ切断扱い（相手が読んでいない）
+    int max_backoff_ms     = 30000;
+
+private:
+    StreamSocketSink() = default;
+
+    std::string   host_;
+    uint16_t      port_ = 0;
+    std::string   unix_path_;
+    net::socket_t sock_  = net::INVALID_SOCK;
+    bool          fresh_ = false;
+    int           backoff_ms_ = 0;
+    clock::time_point retry_at_{};
+};
+
+// ---------------------------------------------
+// UDP（1回の write = 1データグラム）
+// ---------------------------------------------
+class UdpSink : public SinkTransport {
+public:
+    UdpSink(std::string host, uint16_t port, size_t max_datagram = 1472)
+        : host_(std::move(host)), port_(port), max_datagram_(max_datagram) {}
+    ~UdpSink() override { close(); }
+
+    bool ready(clock::time_point now) override;
+    bool at_start() const override { return false; }   // データグラムごとに完結させる（ヘッダなし）
+    bool write(const char* p, size_t n) override;
+    size_t max_write() const override { return max_datagram_; }
+    clock::time_point retry_at() const override { return retry_at_; }
+    void close() override { net::close_socket(sock_); }
+    std::string describe() const override { return "udp:" + host_ + ":" + std::to_string(port_); }
+
+private:
+    std::string   host_;
+    uint16_t      port_;
+    size_t        max_datagram_;
+    net::socket_t sock_ = net::INVALID_SOCK;
+    clock::time_point retry_at_{};
+};
+
+// ------------------------------------------------------------
+// 関数名 : make_sink
+// 概要   : "file:PATH" / "unix:PATH" / "tcp:HOST:PORT" / "udp:HOST:PORT" から送り先を作る
+// 例外   : 書式が不正なら std::invalid_argument（接続・ファイルを開くのは送出スレッドが行う）
+// ------------------------------------------------------------
+std::unique_ptr<SinkTransport> make_sink(const std::string& uri, uint64_t rotate_bytes = 64ull << 20, int keep = 5);
+
+enum class SinkPolicy : uint8_t { DROP_NEWEST, DROP_OLDEST, BLOCK };
+
+// "drop-newest" / "drop-oldest" / "block" → SinkPolicy
+bool parse_sink_policy(const std::string& name, SinkPolicy& out);
+
+// TagExporter の設定
+struct ExportConfig {
+    TagFormat  format            = TagFormat::NDJSON;
+    size_t     batch_bytes       = 64 * 1024;         // この量を超えたらまとめて書く
+    int        flush_ms          = 200;               // 最初の1件からこの時間で書く
+    size_t     max_pending_bytes = 4 * 1024 * 1024;   // 書けない間に溜める上限
+    SinkPolicy policy            = SinkPolicy::DROP_NEWEST;
+    int        block_ms          = 50;                // BLOCK のとき publish() が1回に待つ上限
+    int        block_budget_ms   = 50;                // BLOCK のとき publish() が1秒あたりに待つ合計の上限
+};
+
+class TagExporter {
+public:
+    using clock = std::chrono::steady_clock;
+
+    // 計測値（送出スレッドだけが書く。キュー満杯で捨てた件数は queue().dropped()）
+    struct Stats {
+        Counter records_in;        // キューから取り出した件数
+        Counter dropped_backlog;   // 溜めすぎて捨てた件数（DROP_OLDEST）
+        Counter dropped_on_stop;   // stop() の最後の書き出しでも書けずに捨てた件数
+        Counter records_written;   // 送り先へ書けた件数
+        Counter bytes_written;
+        Counter batches_written;
+        Counter write_failures;    // 書けなかった回数（再試行する）
+    };
+
+    // 送出スレッドを起動する
+    explicit TagExporter(std::unique_ptr<SinkTransport> sink, ExportConfig cfg = {});
+    // stop() してから破棄
+    ~TagExporter();
+    TagExporter(const TagExporter&) = delete;
+    TagExporter& operator=(const TagExporter&) = delete;
+
+    // ------------------------------------------------------------
+    // 関数名 : publish
+    // 概要   : 1件をキューへ積む（通信スレッドから。複数スレッドから呼んでもよい）
+    // 戻り値 : false = 捨てた（キュー満杯。BLOCK なら block_ms 待っても空かなかったか、
+    //          この1秒の待ち時間を使い切っていた）
+    // ------------------------------------------------------------
+    bool publish(const TagRecord& r);
+
+    // ------------------------------------------------------------
+    // 関数名 : stop
+    // 概要   : キューに残っている分を組み立てて1回だけ書き出しを試み、送出スレッドを止める
+    // 備考   : 送出スレッドが空で待っている間は、戻るまで最大 flush_ms かかる
+    // ------------------------------------------------------------
+    void stop();
+
+    // ReaderPool::publish_to() に渡すキュー（ワーカーが直接積む。BLOCK の待ちは効かない）
+    TagQueue& queue() { return *q_; }
+
+    const Stats& stats() const { return stats_; }
+    // 捨てた件数の合計（キュー満杯 + 溜めすぎ + 停止時に書けなかった分）。
+    // stop() の後は「publish() した件数 = stats().records_written + dropped()」になる
+    uint64_t dropped() const { return q_->dropped() + stats_.dropped_backlog + stats_.dropped_on_stop; }
+    size_t   pending_bytes() const { return pending_bytes_.load(std::memory_order_relaxed); }
+    const SinkTransport& sink() const { return *sink_; }
+
+    // 計測値を tr3_export_* の名前で out へ追加する（labels に sink="..." を足す）
+    void collect_metrics(MetricsSnapshot& out, const std::string& labels = "") const;
+
+private:
+    struct Batch {
+        std::vector<char> bytes;
+        size_t            records = 0;
+    };
+
+    void run();
+    void encode(const TagRecord& r, clock::time_point now);
+    void seal_current();
+    void write_pending(clock::time_point now);
+    void recycle(Batch&& b);
+    void wait_for_space();
+
+    std::unique_ptr<SinkTransport> sink_;
+    ExportConfig                   cfg_;
+    std::unique_ptr<TagQueue>      q_;
+    TagEncoder                     enc_;
+    Stats                          stats_;
+
+    // 以下は送出スレッドだけが触る
+    Batch              cur_;                  // 組み立て中
+    clock::time_point  cur_first_{};          // cur_ の最初の1件の時刻
+    std::deque<Batch>  pending_;              // 書き出し待ち（古い順）
+    std::vector<Batch> spare_;                // 使い回す空のまとまり（確保済みの容量ごと）
+    std::vector<char>  scratch_;              // UDP で1件の長さを測る
+    std::vector<char>  header_;
+
+    std::atomic<size_t> pending_bytes_{0};
+    std::atomic<int64_t> block_window_us_{0};   // BLOCK の待ち時間を数える1秒の窓の始まり
+    std::atomic<int64_t> blocked_us_{0};        // その窓で publish() が待った合計
+    std::atomic<bool>   stop_{false};
+    std::thread         th_;
+};
+
+} // namespace tr3
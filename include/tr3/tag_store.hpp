@@ -0,0 +1,143 @@
+// =============================================
+// include/tr3/tag_store.hpp
+// TR3シリーズ - タグ読取の組み込みストア（UID 索引・時間区切りのセグメント）
+// =============================================
+//
+// 読み取ったタグ（TagRecord）を手元に溜め、「この UID を最後に見たのはいつ・どのアンテナか」
+// 「この時間帯に何件読んだか」を DB へ問い合わせずに答えるためのもの。
+//
+//  - 列指向：セグメントごとに time / uid / reader / antenna / dsfid を別々の配列に持つ
+//            （期間や UID での絞り込みは必要な列だけを順に読む）
+//  - セグメント：segment_span_us ごとの時間区切り（または segment_rows 件で満杯）で切り替える。
+//            各セグメントは最小／最大時刻を持ち、期間外のものは読まない。
+//            時刻が昇順に並んでいるセグメントは二分探索で開始位置を決める
+//  - 索引  ：UID（64bit）→ 最初／最後の読取・読取回数。開番地法（TagCache と同じ）で O(1)
+//  - 保持  ：閉じたセグメントが max_segments を超えたら古いものから捨てる（書き込み中のものは
+//            数えない。dir 指定時は保存してから捨てる。索引の LastSeen は残る）
+//  - 永続化：dir を指定すると、切り替えで閉じたセグメント（と破棄時の書き込み中のもの）を
+//            dir/seg-<最初の時刻>.tr3seg に書き、メモリマップで読み直してヒープを解放する。
+//            次に同じ dir で作ると既存のセグメントを読み込んで索引を作り直す
+//
+//   TagStore store({ 60'000'000, 65536, 1440, "/var/lib/tr3/store" });
+//   store.append(TagRecord::make(reader, ant, tag, std::chrono::system_clock::now()));
+//   if (const auto* s = store.last_seen(tag.uid64())) { ... s->last_us / s->antenna ... }
+//   TagStore::Query q; q.from_us = now_us - 5'000'000; q.antenna = 1;
+//   const size_t n = store.count(q);   // ANT#1 の直近5秒の読取件数
+//
+// セグメントファイル（ホストのバイト順。ヘッダの byte_order が違うものは読まない）：
+//   [0..7]   magic "TR3SEG\0\0"   [8..9] version 1   [10..11] 予約   [12..15] rows
+//   [16..23] min_us   [24..31] max_us   [32..35] byte_order 0x01020304   [36] sorted   [37..63] 予約
+//   [64..]   time(int64 × rows) / uid(uint64 × rows) / reader(uint32 × rows) / antenna(uint8 × rows) /
+//            dsfid(uint8 × rows)。各列は 8 バイト境界から始まる
+//
+// 単一スレッド用。
+// =============================================
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "tr3/tag_queue.hpp"   // TagRecord
+
+namespace tr3 {
+
+struct TagStoreError : std::runtime_error { using std::runtime_error::runtime_error; };
+
+// TagStore の設定
+struct TagStoreConfig {
+    int64_t     segment_span_us = 60'000'000;   // セグメント1つの時間幅（既定 1 分）
+    size_t      segment_rows    = 65536;        // セグメント1つの最大件数
+    size_t      max_segments    = 0;            // 保持する閉じたセグメント数（0 = 無制限。超えた分はファイルも消す）
+    std::string dir;                            // 永続化先（空 = メモリのみ）
+};
+
+class TagStore {
+public:
+    using Config = TagStoreConfig;
+
+    // UID ごとの要約（索引の1項目）
+    struct LastSeen {
+        uint64_t uid      = 0;
+        int64_t  first_us = 0;    // 最初の読取
+        int64_t  last_us  = 0;    // 最後の読取
+        uint32_t reads    = 0;    // 読取回数（0 = 空きスロット）
+        uint32_t reader   = 0;    // 最後に読んだリーダ
+        uint8_t  antenna  = 0;    // 最後に読んだアンテナ
+        uint8_t  dsfid    = 0;
+    };
+
+    // 読取の絞り込み条件（指定しない項目は全件）
+    struct Query {
+        int64_t                 from_us = std::numeric_limits<int64_t>::min();   // この時刻以上
+        int64_t                 to_us   = std::numeric_limits<int64_t>::max();   // この時刻未満
+        std::optional<uint64_t> uid;
+        int                     antenna = -1;
+        int64_t                 reader  = -1;
+    };
+
+    // ------------------------------------------------------------
+    // 関数名 : TagStore
+    // 概要   : cfg.dir があれば作成し、既存のセグメントファイルを読み込んで索引を作る
+    // 例外   : dir を作れないなら TagStoreError
+    // 備考   : 壊れたセグメントファイルは <名前>.bad へ退避して警告を出し、読み飛ばす
+    // ------------------------------------------------------------
+    explicit TagStore(Config cfg = {});
+    // 書き込み中のセグメントを（dir があれば）ファイルへ書いてから閉じる
+    ~TagStore();
+    TagStore(const TagStore&) = delete;
+    TagStore& operator=(const TagStore&) = delete;
+
+    // ------------------------------------------------------------
+    // 関数名 : append
+    // 概要   : 読取1件を書き込み中のセグメントへ追加し、索引を更新する
+    // 例外   : セグメントの切り替えでファイルへ書けなければ TagStoreError
+    //          （そのセグメントはメモリに残り、次の切り替えで再び書く）
+    // ------------------------------------------------------------
+    void append(const TagRecord& r);
+
+    // ------------------------------------------------------------
+    // 関数名 : seal
+    // 概要   : 書き込み中のセグメントを閉じる（dir があればファイルへ書いてマップし直す）
+    // ------------------------------------------------------------
+    void seal();
+
+    // UID の要約（未読なら nullptr。次の append まで有効）
+    const LastSeen* last_seen(uint64_t uid) const;
+    // 最後の読取が [from_us, to_us) のタグ（UID ごとに1件、順不同）
+    std::vector<LastSeen> seen_between(int64_t from_us, int64_t to_us) const;
+
+    // 条件に合う読取の件数
+    size_t count(const Query& q) const;
+    // 条件に合う読取を古いセグメントから順に out へ追加する（最大 limit 件）。戻り値は追加した件数
+    size_t select(const Query& q, std::vector<TagRecord>& out,
+                  size_t limit = std::numeric_limits<size_t>::max()) const;
+
+    size_t rows() const;                                      // 保持している読取の件数
+    size_t segment_count() const { return segs_.size(); }
+    size_t unique_tags() const { return index_size_; }        // 索引の UID 数
+    const Config& config() const { return cfg_; }
+
+private:
+    struct Segment;
+
+    void roll(int64_t start_us);
+    void persist(Segment& s);
+    void load_dir();
+    void enforce_retention();
+    void index_update(uint64_t uid, int64_t t, uint32_t reader, uint8_t antenna, uint8_t dsfid);
+    void index_grow();
+    template <typename Fn> void scan(const Query& q, Fn&& fn) const;
+
+    Config                                cfg_;
+    std::vector<std::unique_ptr<Segment>> segs_;     // 古い順。最後が書き込み中（active_ のとき）
+    Segment*                              active_ = nullptr;
+    std::vector<LastSeen>                 index_;    // 開番地法。容量は 2 のべき乗
+    size_t                                index_size_ = 0;
+};
+
+} // namespace tr3
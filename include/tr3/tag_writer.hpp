@@ -0,0 +1,129 @@
+// =============================================
+// include/tr3/tag_writer.hpp
+// TR3シリーズ - タグ読取結果のストリーム出力（NDJSON / CSV / バイナリ）
+// =============================================
+//
+// 常駐運用（main.cpp の --headless）で、読み取ったタグを1件ずつ標準出力または
+// ファイルへ流すためのもの。1件ごとに write(2) しないよう内部バッファに溜め、
+// 「flush_bytes を超えた」か「最後の書き出しから flush_ms 経った」ときにまとめて書き出す。
+//
+// 形式（1レコード = 1タグ）：
+//
+//   NDJSON : {"ts":"2026-10-16T07:46:02.748123Z","reader":0,"antenna":1,"dsfid":0,"uid":"E004010000000001"}
+//   CSV    : ts,reader,antenna,dsfid,uid   （空のファイル／標準出力の先頭に見出し行）
+//            2026-10-16T07:46:02.748123Z,0,1,0,E004010000000001
+//   バイナリ（リトルエンディアン）：
+//     ファイルヘッダ（16B）
+//       [0..7]   magic   "TR3TAG\0\0"
+//       [8..9]   version 1
+//       [10..11] レコード長 24
+//       [12..15] 予約（0）
+//     レコード（24B、TagRecord と同じ並び）
+//       [0..7]   time_us  system_clock のエポックからのマイクロ秒
+//       [8..11]  reader
+//       [12]     antenna
+//       [13]     dsfid
+//       [14..15] 予約（0）
+//       [16..23] uid      受信順（LSB → MSB）
+//
+// ts は UTC。uid は表示順（MSB → LSB）の16進。
+// ファイルは追記で開く（再起動しても前の出力を消さない）。単一スレッド用。
+//
+// 形式の組み立てだけが必要なとき（tag_sink.hpp の送出先など）は TagEncoder を使う。
+// =============================================
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "tr3/tag_queue.hpp"   // TagRecord
+
+namespace tr3 {
+
+struct TagWriterError : std::runtime_error { using std::runtime_error::runtime_error; };
+
+enum class TagFormat : uint8_t { NDJSON, CSV, BINARY };
+
+inline constexpr size_t   TAGFILE_HEADER  = 16;
+inline constexpr uint16_t TAGFILE_VERSION = 1;
+inline constexpr size_t   TAGFILE_RECORD  = 24;
+
+// "ndjson" / "json" / "csv" / "binary" / "bin" → TagFormat
+std::optional<TagFormat> parse_tag_format(std::string_view name);
+
+// ---------------------------------------------
+// 1件ずつ out の末尾へ形式どおりに組み立てる（TagWriter / TagExporter が使う）
+// ---------------------------------------------
+class TagEncoder {
+public:
+    explicit TagEncoder(TagFormat fmt = TagFormat::NDJSON) : fmt_(fmt) {}
+
+    // ストリームの先頭に置くもの（バイナリはファイルヘッダ、CSV は見出し行、NDJSON はなし）
+    void header(std::vector<char>& out) const;
+    void append(const TagRecord& r, std::vector<char>& out);
+
+    TagFormat format() const { return fmt_; }
+
+private:
+    void append_text(const TagRecord& r, std::vector<char>& out);
+    void append_binary(const TagRecord& r, std::vector<char>& out) const;
+    // "2026-10-16T07:46:02.748123Z"（秒までは1秒ごとに作り直す）
+    void append_time(int64_t time_us, std::vector<char>& out);
+
+    TagFormat fmt_;
+    int64_t   last_sec_ = INT64_MIN;        // sec_text_ の元になった秒
+    char      sec_text_[24] = {};           // "2026-10-16T07:46:02"
+};
+
+class TagWriter {
+public:
+    using clock = std::chrono::steady_clock;
+
+    TagWriter() = default;
+    ~TagWriter();
+    TagWriter(const TagWriter&) = delete;
+    TagWriter& operator=(const TagWriter&) = delete;
+
+    // ------------------------------------------------------------
+    // 関数名 : open
+    // 概要   : 出力先を開く（"-" は標準出力）。必要ならヘッダ／見出し行を書く
+    // 引数   : path        - 出力ファイル（追記）または "-"
+    //          fmt         - 出力形式
+    //          flush_bytes - この量を超えたら書き出す
+    //          flush_ms    - 溜めてからこの時間が経ったら書き出す（poll / write で確認）
+    // 例外   : 開けない／既存のバイナリファイルが別形式なら TagWriterError
+    // ------------------------------------------------------------
+    void open(const std::string& path, TagFormat fmt, size_t flush_bytes = 64 * 1024, int flush_ms = 1000);
+    void close();
+    bool is_open() const { return fp_ != nullptr; }
+
+    // 1件を形式に従って内部バッファへ追加する（必要なら書き出す）
+    void write(const TagRecord& r);
+
+    // 溜めてから flush_ms 経っていれば書き出す（読取ループから定期的に呼ぶ）
+    void poll(clock::time_point now = clock::now());
+
+    // 内部バッファを書き出して fflush する
+    // 例外：書き込み失敗（ディスクフル・パイプ切断など）で TagWriterError
+    void flush();
+
+    uint64_t records() const { return records_; }
+    TagFormat format() const { return enc_.format(); }
+
+private:
+    std::FILE*        fp_       = nullptr;
+    bool              owns_fp_  = false;   // 標準出力は閉じない
+    TagEncoder        enc_;
+    size_t            flush_bytes_ = 64 * 1024;
+    int               flush_ms_    = 1000;
+    std::vector<char> buf_;
+    clock::time_point first_pending_{};   // バッファが空でなくなった時刻
+    uint64_t          records_ = 0;
+};
+
+} // namespace tr3
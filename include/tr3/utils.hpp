@@ -52,14 +52,18 @@ inline std::string ts_now() {
 }
 
 // "020030..." を "02 00 30 ..." に
-inline std::string hex_spaced(const std::vector<uint8_t>& v) {
+inline std::string hex_spaced(const uint8_t* p, size_t n) {
     std::ostringstream oss;
     oss << std::uppercase << std::hex << std::setfill('0');
-    for (size_t i = 0; i < v.size(); ++i) {
+    for (size_t i = 0; i < n; ++i) {
         if (i) oss << ' ';
-        oss << std::setw(2) << (int)v[i];
+        oss << std::setw(2) << (int)p[i];
     }
     return oss.str();
 }
 
-} // namespace tr3
\ No newline at end of file
+inline std::string hex_spaced(const std::vector<uint8_t>& v) {
+    return hex_spaced(v.data(), v.size());
+}
+
+} // namespace tr3
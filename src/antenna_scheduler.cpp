@@ -0,0 +1,105 @@
+// =============================================
+// src/antenna_scheduler.cpp
+// TR3シリーズ - アンテナ巡回スケジューラ実装
+//
+//  - smooth WRR：各選択で cur[i] += weight[i]、最大の i を選び cur[i] -= 合計
+//    （weight 3:1 なら A A A B ではなく A A B A のように分散する）
+//  - 休止中のアンテナが選ばれたら、その番を消費して（skip_left を1減らして）選び直す
+// =============================================
+
+#include "tr3/antenna_scheduler.hpp"
+
+#include <algorithm>
+
+namespace tr3 {
+
+SchedulerConfig SchedulerConfig::uniform(int n) {
+    SchedulerConfig c;
+    for (int i = 0; i < n; ++i) {
+        AntennaConfig a;
+        a.port = static_cast<uint8_t>(i);
+        c.antennas.push_back(a);
+    }
+    return c;
+}
+
+AntennaScheduler::AntennaScheduler(SchedulerConfig cfg) : cfg_(std::move(cfg)) {
+    if (cfg_.antennas.empty()) cfg_.antennas.push_back(AntennaConfig{});
+    for (auto& a : cfg_.antennas) {
+        a.weight = std::max(0, a.weight);
+        a.dwell  = std::max(1, a.dwell);
+        total_weight_ += a.weight;
+    }
+    if (total_weight_ == 0) {                 // 全部 0 なら均等扱い
+        for (auto& a : cfg_.antennas) a.weight = 1;
+        total_weight_ = static_cast<int>(cfg_.antennas.size());
+    }
+    st_.resize(cfg_.antennas.size());
+    cur_.assign(cfg_.antennas.size(), 0);
+    backoff_.assign(cfg_.antennas.size(), 1);
+}
+
+int AntennaScheduler::find(uint8_t antenna) const {
+    for (size_t i = 0; i < cfg_.antennas.size(); ++i) {
+        if (cfg_.antennas[i].port == antenna) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+// ------------------------------------------------------------
+// 関数名 : next
+// ------------------------------------------------------------
+AntennaScheduler::Slot AntennaScheduler::next() {
+    const size_t n = cfg_.antennas.size();
+    int pick = -1;
+
+    // 休止中の番は消費して選び直す。全員休止中なら最後に選んだものを使う
+    for (size_t tries = 0; tries <= n * static_cast<size_t>(std::max(1, cfg_.max_skip) + 1); ++tries) {
+        int best = -1;
+        for (size_t i = 0; i < n; ++i) {
+            if (cfg_.antennas[i].weight == 0) continue;
+            cur_[i] += cfg_.antennas[i].weight;
+            if (best < 0 || cur_[i] > cur_[static_cast<size_t>(best)]) best = static_cast<int>(i);
+        }
+        cur_[static_cast<size_t>(best)] -= total_weight_;
+        pick = best;
+
+        AntennaStats& s = st_[static_cast<size_t>(best)];
+        if (s.skip_left <= 0) break;
+        --s.skip_left;
+        ++s.skipped;
+    }
+
+    Slot slot;
+    slot.antenna       = cfg_.antennas[static_cast<size_t>(pick)].port;
+    slot.dwell         = cfg_.antennas[static_cast<size_t>(pick)].dwell;
+    slot.switch_needed = pick != current_;
+    current_ = pick;
+    return slot;
+}
+
+// ------------------------------------------------------------
+// 関数名 : report
+// 概要   : タグなしが idle_after 回続いたら休止（番数は倍々、上限 max_skip）。
+//          休止明けの1回も空なら次の休止へ。タグが読めたら休止と倍率を元に戻す
+// ------------------------------------------------------------
+void AntennaScheduler::report(uint8_t antenna, int tags) {
+    const int i = find(antenna);
+    if (i < 0) return;
+    AntennaStats& s = st_[static_cast<size_t>(i)];
+    ++s.inventories;
+    if (tags > 0) {
+        s.tags     += static_cast<uint64_t>(tags);
+        s.empty_run = 0;
+        s.skip_left = 0;
+        backoff_[static_cast<size_t>(i)] = 1;
+        return;
+    }
+    if (cfg_.idle_after <= 0 || ++s.empty_run < cfg_.idle_after) return;
+    int& b = backoff_[static_cast<size_t>(i)];
+    s.skip_left = std::min(b, std::max(1, cfg_.max_skip));
+    b = std::min(b * 2, std::max(1, cfg_.max_skip));
+    s.empty_run = cfg_.idle_after - 1;   // 休止明けも空なら、すぐに倍の休止へ
+}
+
+} // namespace tr3
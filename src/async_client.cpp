@@ -0,0 +1,343 @@
+// =============================================
+// src/async_client.cpp
+// TR3シリーズ - 非同期（パイプライン）クライアント実装
+//
+// 役割：
+//  - submit()      : 要求をキューに積み、window の範囲で先行送信
+//  - on_readable() : 受信 → Parser::feed() → 送信順に応答を対応付け
+//  - on_writable() : 連結した送信バッファを書き出す
+//  - run_once()    : 上記を poll で駆動（単一接続用の簡易イベントループ）
+//
+// 注意：
+//  - 応答タイムアウト時は送信済みの要求をすべて失敗させる
+//    （どの応答が欠けたか判別できないため。未送信の要求はその後送信する）
+//  - TR3 の ACK は全コマンド共通で、遅れて届いた応答を次の要求の応答と区別できない。
+//    タイムアウト後は受信済みの分を捨て、しばらく（quiet_until_ まで）送信を止めて
+//    その間に届いたフレームも読み捨ててから未送信の要求を送る
+//  - コールバックは要求をキューから外してから呼ぶ（コールバック内で submit 可）
+// =============================================
+
+#include "tr3/async_client.hpp"
+#include "tr3/log.hpp"
+
+#include <memory>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+namespace tr3 {
+
+AsyncClient::AsyncClient() {
+    net::startup();
+    spare_tags_.reserve(8);
+}
+
+AsyncClient::~AsyncClient() {
+    net::close_socket(sock_);   // デストラクタではコールバックを呼ばない
+    net::cleanup();
+}
+
+// ------------------------------------------------------------
+// 関数名 : connect
+// ------------------------------------------------------------
+void AsyncClient::connect(const std::string& ip, uint16_t port, int timeout_ms) {
+    close();
+    sock_       = net::connect_tcp(ip, port, timeout_ms);
+    timeout_ms_ = timeout_ms;
+}
+
+// ------------------------------------------------------------
+// 関数名 : connect_async
+// ------------------------------------------------------------
+void AsyncClient::connect_async(const std::string& ip, uint16_t port, int timeout_ms) {
+    close();
+    timeout_ms_       = timeout_ms;
+    sock_             = net::connect_start(ip, port);
+    connecting_       = true;
+    connect_deadline_ = clock::now() + std::chrono::milliseconds(timeout_ms);
+}
+
+// ------------------------------------------------------------
+// 関数名 : finish_connect
+// 概要   : 接続中ソケットの結果を確定。失敗時はソケットを閉じ要求を失敗させる
+// ------------------------------------------------------------
+bool AsyncClient::finish_connect() {
+    try {
+        net::connect_finish(sock_);
+    } catch (const NetError&) {
+        connecting_ = false;
+        net::close_socket(sock_);
+        fail_all(std::current_exception(), true);
+        return false;
+    }
+    connecting_ = false;
+    return true;
+}
+
+// ------------------------------------------------------------
+// 関数名 : close
+// 概要   : ソケットを閉じ、未完了の要求をすべて失敗させる
+// ------------------------------------------------------------
+void AsyncClient::close() {
+    connecting_ = false;
+    net::close_socket(sock_);
+    tx_.clear();
+    tx_off_ = 0;
+    rx_.clear();
+    parser_.reset();
+    quiet_until_ = {};
+    if (pending()) {
+        fail_all(std::make_exception_ptr(NetError("connection closed")), true);
+    }
+}
+
+// ------------------------------------------------------------
+// 関数名 : submit（コールバック版）
+// ------------------------------------------------------------
+void AsyncClient::submit(ByteView frame, Callback cb) {
+    if (frame.size() > MAX_FRAME_LEN) throw std::length_error("AsyncClient::submit: frame too long");
+    Request r;
+    r.cmd        = frame.size() > 2 ? frame[2] : 0;
+    std::copy(frame.begin(), frame.end(), r.frame.bytes.begin());
+    r.frame.len  = frame.size();
+    r.cb         = std::move(cb);
+    r.result.cmd = r.cmd;
+    if (!spare_tags_.empty()) {
+        r.result.tags = std::move(spare_tags_.back());
+        spare_tags_.pop_back();
+    }
+    queued_.push_back(std::move(r));
+    pump_queue();
+}
+
+// ------------------------------------------------------------
+// 関数名 : submit（future 版）
+// 備考   : future の完了には run_once() 等での駆動が必要
+// ------------------------------------------------------------
+std::future<AsyncClient::Result> AsyncClient::submit(ByteView frame) {
+    auto prom = std::make_shared<std::promise<Result>>();
+    auto fut  = prom->get_future();
+    submit(frame, [prom](Result&& r) {
+        if (r.error) prom->set_exception(r.error);
+        else         prom->set_value(std::move(r));
+    });
+    return fut;
+}
+
+// ------------------------------------------------------------
+// 関数名 : pump_queue
+// 概要   : window に空きがあれば未送信要求を送信バッファへ移し、送れる分を送る
+// ------------------------------------------------------------
+void AsyncClient::pump_queue() {
+    if (!connected()) return;
+
+    const auto now = clock::now();
+    if (now < quiet_until_) return;             // タイムアウト後の読み捨て中
+    while (!queued_.empty() && inflight_.size() < window_) {
+        Request r = queued_.pop_front();
+        tx_.insert(tx_.end(), r.frame.data(), r.frame.data() + r.frame.size());
+        log::frame(log::Dir::SEND, r.frame);
+        if (capture_) capture_->write(CaptureDir::SEND, capture_id_, r.frame);
+        r.deadline = now + std::chrono::milliseconds(timeout_ms_);
+        inflight_.push_back(std::move(r));
+    }
+    if (wants_write()) on_writable();
+}
+
+// ------------------------------------------------------------
+// 関数名 : on_writable
+// 概要   : 送信バッファを送れるだけ送る（残りは次の書込可能イベントで）
+// ------------------------------------------------------------
+void AsyncClient::on_writable() {
+    if (connecting_) {
+        if (!finish_connect()) return;
+        pump_queue();
+        return;
+    }
+    while (connected() && wants_write()) {
+        long n;
+        try {
+            n = net::send_some(sock_, tx_.data() + tx_off_, tx_.size() - tx_off_);
+        } catch (const NetError&) {
+            net::close_socket(sock_);
+            fail_all(std::current_exception(), true);
+            return;
+        }
+        if (n < 0) return;                       // 送信バッファ満杯
+        tx_off_ += static_cast<size_t>(n);
+    }
+    if (!wants_write()) {
+        tx_.clear();
+        tx_off_ = 0;
+    }
+}
+
+// ------------------------------------------------------------
+// 関数名 : on_readable
+// 概要   : 届いている分をすべて受信し、完成フレームを順に dispatch する
+// ------------------------------------------------------------
+void AsyncClient::on_readable() {
+    if (connecting_ && !finish_connect()) return;   // 接続失敗はエラーイベントで届く
+    while (connected()) {
+        long n;
+        try {
+            n = net::recv_some(sock_, rx_.write_ptr(), rx_.write_len());
+            if (n == 0) throw NetError("connection closed by peer");
+        } catch (const NetError&) {
+            net::close_socket(sock_);
+            fail_all(std::current_exception(), true);
+            return;
+        }
+        if (n < 0) break;                        // 受信データなし
+        rx_.commit(static_cast<size_t>(n));
+
+        // 受信バッファ → フレーム → 要求へ対応付け
+        // （再同期で Parser 内に残った完成フレームもあるので、フレームが出る間は続ける）
+        for (;;) {
+            FrameView fv;
+            const auto r = parser_.feed(ByteView(rx_.read_ptr(), rx_.read_len()), fv);
+            if (r.frame) dispatch(fv);           // fv は rx_ を指すので consume 前に使い切る
+            rx_.consume(r.consumed);
+            if (!r.frame && rx_.empty()) break;
+        }
+    }
+    pump_queue();
+}
+
+// ------------------------------------------------------------
+// 関数名 : dispatch
+// 概要   : 受信フレーム1つを送信済み要求に対応付ける
+// 規則   :
+//   1) 先頭要求が Inventory2 のタグ受信中 → タグ応答(0x49)を tags に追加
+//      （タグ以外が来たら件数不足のまま完了させ、以降の規則で処理）
+//   2) タグ応答で対応する要求がない → on_unsolicited
+//   3) それ以外の応答 → 先頭要求の reply。Inventory2 の ACK「F0 NN」なら
+//      NN 件のタグ応答を待つ状態にする
+// ------------------------------------------------------------
+void AsyncClient::dispatch(const FrameView& fv) {
+    log::frame(log::Dir::RECV, fv.raw);
+    if (capture_) capture_->write(CaptureDir::RECV, capture_id_, fv.raw);
+    if (inflight_.empty() && clock::now() < quiet_until_) {
+        log::write(log::Level::DEBUG, "async: late frame after timeout discarded");
+        return;
+    }
+    Reply rep(fv.cmd, pool_->acquire(fv.raw));   // RAW をプールのスロットへ（DATA はその中のビュー）
+
+    if (!inflight_.empty() && inflight_.front().tags_left > 0) {
+        Request& r = inflight_.front();
+        if (fv.cmd == RES_TAG) {
+            r.result.tags.push_back(std::move(rep));
+            if (--r.tags_left == 0) complete_front();
+            return;
+        }
+        complete_front();                        // タグ件数不足のまま次の応答が来た
+    }
+
+    if (inflight_.empty() || fv.cmd == RES_TAG) {
+        if (unsolicited_) unsolicited_(std::move(rep));
+        return;
+    }
+
+    Request& r = inflight_.front();
+    const bool inv_ack = r.cmd == CMD_INVENTORY2 && fv.cmd == RES_ACK &&
+                         fv.data.size() == 2 && fv.data[0] == 0xF0;
+    r.result.reply = std::move(rep);
+    if (inv_ack && r.result.reply.data[1] > 0) {
+        r.tags_left = r.result.reply.data[1];
+        r.deadline  = clock::now() + std::chrono::milliseconds(timeout_ms_);
+        return;
+    }
+    complete_front();
+}
+
+// ------------------------------------------------------------
+// 関数名 : complete_front
+// 概要   : 先頭要求を完了させコールバックを呼ぶ
+// 備考   : コールバックが tags を持っていかなければ、空にして次の要求で使い回す
+// ------------------------------------------------------------
+void AsyncClient::complete_front() {
+    Request r = inflight_.pop_front();
+    if (r.cb) r.cb(std::move(r.result));
+    if (r.result.tags.capacity() > 0 && spare_tags_.size() < 8) {
+        r.result.tags.clear();                   // スロットはここでプールへ戻る
+        spare_tags_.push_back(std::move(r.result.tags));
+    }
+}
+
+// ------------------------------------------------------------
+// 関数名 : fail_all
+// 概要   : 送信済み（と指定時は未送信）の要求をすべて e で失敗させる
+// ------------------------------------------------------------
+void AsyncClient::fail_all(const std::exception_ptr& e, bool include_queued) {
+    RequestQueue victims;
+    victims.swap(inflight_);
+    if (include_queued) {
+        while (!queued_.empty()) victims.push_back(queued_.pop_front());
+    }
+    while (!victims.empty()) {
+        Request r = victims.pop_front();
+        r.result.error = e;
+        if (r.cb) r.cb(std::move(r.result));
+    }
+}
+
+// ------------------------------------------------------------
+// 関数名 : check_timeouts
+// 概要   : 先頭要求の応答期限切れを判定（送信順に処理されるので先頭だけ見ればよい）
+// 備考   : 期限切れ時は受信途中のデータを捨て、遅れて届く応答が次の要求に
+//          対応付けられないよう min(timeout, 200ms) の間は送信を止める
+// ------------------------------------------------------------
+void AsyncClient::check_timeouts(clock::time_point now) {
+    if (connecting_) {
+        if (now < connect_deadline_) return;
+        connecting_ = false;
+        net::close_socket(sock_);
+        fail_all(std::make_exception_ptr(NetError("connect() timeout")), true);
+        return;
+    }
+    if (quiet_until_ != clock::time_point{} && now >= quiet_until_) {
+        quiet_until_ = {};
+        pump_queue();
+    }
+    if (inflight_.empty() || now < inflight_.front().deadline) return;
+    rx_.clear();
+    parser_.reset();
+    quiet_until_ = now + std::chrono::milliseconds(std::min(timeout_ms_, 200));
+    fail_all(std::make_exception_ptr(TimeoutError("recv timeout")), false);
+}
+
+int AsyncClient::next_timeout_ms(clock::time_point now) const {
+    const bool quiet = quiet_until_ != clock::time_point{} && inflight_.empty();
+    if (!connecting_ && inflight_.empty() && !quiet) return -1;
+    const auto deadline = connecting_ ? connect_deadline_
+                        : quiet       ? quiet_until_
+                                      : inflight_.front().deadline;
+    const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count();
+    return left > 0 ? static_cast<int>(left) : 0;
+}
+
+// ------------------------------------------------------------
+// 関数名 : run_once
+// ------------------------------------------------------------
+size_t AsyncClient::run_once(int timeout_ms) {
+    if (sock_ == net::INVALID_SOCK) {
+        if (pending()) fail_all(std::make_exception_ptr(NetError("not connected")), true);
+        return 0;
+    }
+    pump_queue();
+
+    int wait = next_timeout_ms(clock::now());
+    if (wait < 0 || (timeout_ms >= 0 && timeout_ms < wait)) wait = timeout_ms;
+
+    const unsigned ev = net::wait_io(sock_, wants_write(), wait);
+    if (ev & net::IO_WRITABLE) on_writable();
+    if (ev & net::IO_READABLE) on_readable();
+    check_timeouts(clock::now());
+    return pending();
+}
+
+void AsyncClient::run_until_idle() {
+    while (run_once(-1) > 0) {}
+}
+
+} // namespace tr3
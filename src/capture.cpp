@@ -0,0 +1,268 @@
+// =============================================
+// src/capture.cpp
+// TR3シリーズ - バイナリキャプチャ実装
+//
+//  - 書き込み：fopen("ab") で追記。レコードは buf_ に連結し、64KB ごとに fwrite
+//  - 開くとき既存ファイルのレコードをたどり、末尾の不完全なレコード（書き込み中に
+//    落ちた・ディスクが一杯だった）は切り詰めてから追記する。書き込みに失敗したら
+//    最後の完全なレコードまで切り詰めてキャプチャを止める（壊れた末尾の後ろへ書かない）
+//  - 読み出し：POSIX は mmap、Windows は CreateFileMapping / MapViewOfFile
+//  - 数値はバイト単位で組み立て／分解する（ホストのエンディアンに依存しない）
+// =============================================
+
+#include "tr3/capture.hpp"
+#include "tr3/log.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+#ifdef _WIN32
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  include <windows.h>
+#else
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+namespace tr3 {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char   MAGIC[8]    = { 'T', 'R', '3', 'C', 'A', 'P', 0, 0 };
+constexpr size_t FLUSH_BYTES = 64 * 1024;
+
+size_t padded(size_t n) { return (n + 7) & ~static_cast<size_t>(7); }
+
+void put_le(std::vector<uint8_t>& out, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+}
+
+uint64_t get_le(const uint8_t* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; ++i) v |= static_cast<uint64_t>(p[i]) << (8 * i);
+    return v;
+}
+
+// ------------------------------------------------------------
+// 関数名 : complete_length
+// 概要   : ファイルヘッダの直後からレコードをたどり、最後の完全なレコード（詰め物まで）の終端を返す
+// 備考   : ヘッダが途中で切れている・長さが不正・本体か詰め物が足りないところで止める
+// ------------------------------------------------------------
+uint64_t complete_length(std::FILE* fp, uint64_t file_len) {
+    uint64_t pos = CAPTURE_FILE_HEADER;
+    uint8_t  head[CAPTURE_RECORD_HEADER];
+    while (pos + CAPTURE_RECORD_HEADER <= file_len) {
+        if (std::fseek(fp, static_cast<long>(pos), SEEK_SET) != 0 ||
+            std::fread(head, 1, sizeof(head), fp) != sizeof(head)) break;
+        const uint8_t dir = head[10];
+        const size_t  len = static_cast<size_t>(get_le(head + 12, 2));
+        if (len > MAX_FRAME_LEN || (dir != static_cast<uint8_t>(CaptureDir::SEND) &&
+                                    dir != static_cast<uint8_t>(CaptureDir::RECV))) break;
+        const uint64_t end = pos + CAPTURE_RECORD_HEADER + padded(len);
+        if (end > file_len) break;
+        pos = end;
+    }
+    return pos;
+}
+
+} // namespace
+
+// ====================================================================
+// CaptureWriter
+// ====================================================================
+CaptureWriter::~CaptureWriter() {
+    close();
+}
+
+// ------------------------------------------------------------
+// 関数名 : open
+// 備考   : 既存ファイルは形式を確認し、末尾の不完全なレコードを切り詰めてから追記する
+//          （そのまま後ろへ書くと、以降のレコードがすべて読めなくなる）
+// ------------------------------------------------------------
+void CaptureWriter::open(const std::string& path) {
+    close();
+
+    std::error_code ec;
+    uint64_t len = 0;
+    if (fs::exists(path, ec)) {
+        len = fs::file_size(path, ec);
+        if (ec) throw CaptureError("capture: cannot open " + path + ": " + ec.message());
+    }
+    if (len > 0) {
+        std::FILE* rd = std::fopen(path.c_str(), "rb");
+        if (!rd) throw CaptureError("capture: cannot open " + path);
+        uint8_t head[CAPTURE_FILE_HEADER] = {};
+        const bool ok = std::fread(head, 1, sizeof(head), rd) == sizeof(head) &&
+                        std::memcmp(head, MAGIC, sizeof(MAGIC)) == 0;
+        const uint64_t good = ok ? complete_length(rd, len) : 0;
+        std::fclose(rd);
+        if (!ok) throw CaptureError("capture: not a TR3 capture file: " + path);
+        if (good < len) {
+            fs::resize_file(path, good, ec);
+            if (ec) throw CaptureError("capture: cannot truncate " + path + ": " + ec.message());
+            log::write(log::Level::WARN, "capture: dropped " + std::to_string(len - good) +
+                                         " bytes of an incomplete record at the end of " + path);
+            len = good;
+        }
+    }
+
+    std::FILE* fp = std::fopen(path.c_str(), "ab");
+    if (!fp) throw CaptureError("capture: cannot open " + path);
+    if (len == 0) {
+        std::vector<uint8_t> head(MAGIC, MAGIC + sizeof(MAGIC));
+        put_le(head, CAPTURE_VERSION, 2);
+        head.resize(CAPTURE_FILE_HEADER, 0);
+        if (std::fwrite(head.data(), 1, head.size(), fp) != head.size() || std::fflush(fp) != 0) {
+            std::fclose(fp);
+            throw CaptureError("capture: cannot write " + path);
+        }
+        len = head.size();
+    }
+
+    std::lock_guard<std::mutex> lk(mu_);
+    fp_   = fp;
+    path_ = path;
+    size_ = len;
+    buf_.reserve(FLUSH_BYTES + CAPTURE_RECORD_HEADER + MAX_FRAME_LEN + 8);
+}
+
+void CaptureWriter::close() {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (!fp_) return;
+    flush_locked();
+    std::fclose(fp_);
+    fp_ = nullptr;
+}
+
+void CaptureWriter::write(CaptureDir dir, uint16_t reader, ByteView frame,
+                          std::chrono::system_clock::time_point ts) {
+    const int64_t ts_us = std::chrono::duration_cast<std::chrono::microseconds>(ts.time_since_epoch()).count();
+    const size_t  len   = std::min(frame.size(), MAX_FRAME_LEN);
+
+    std::lock_guard<std::mutex> lk(mu_);
+    if (!fp_) return;
+    put_le(buf_, static_cast<uint64_t>(ts_us), 8);
+    put_le(buf_, reader, 2);
+    buf_.push_back(static_cast<uint8_t>(dir));
+    buf_.push_back(0);
+    put_le(buf_, len, 2);
+    put_le(buf_, 0, 2);
+    buf_.insert(buf_.end(), frame.begin(), frame.begin() + len);
+    buf_.resize(buf_.size() + (padded(len) - len), 0);
+
+    if (buf_.size() >= FLUSH_BYTES) flush_locked();
+}
+
+void CaptureWriter::flush() {
+    std::lock_guard<std::mutex> lk(mu_);
+    flush_locked();
+}
+
+// ------------------------------------------------------------
+// 関数名 : flush_locked
+// 備考   : 書き込みに失敗したら（ディスクが一杯など）途中まで書けたレコードを切り詰め、
+//          キャプチャを止める（以降の write() は何もしない）
+// ------------------------------------------------------------
+void CaptureWriter::flush_locked() {
+    if (!fp_ || buf_.empty()) return;
+    const bool ok = std::fwrite(buf_.data(), 1, buf_.size(), fp_) == buf_.size() && std::fflush(fp_) == 0;
+    if (ok) {
+        size_ += buf_.size();
+        buf_.clear();
+        return;
+    }
+    std::fclose(fp_);   // stdio に残った分もここで書かれうるので、切り詰めは閉じた後
+    fp_ = nullptr;
+    buf_.clear();
+    std::error_code ec;
+    fs::resize_file(path_, size_, ec);
+    log::write(log::Level::ERR, "capture: write to " + path_ + " failed, capture stopped" +
+                                (ec ? " (cannot truncate: " + ec.message() + ")" : ""));
+}
+
+// ====================================================================
+// CaptureReader
+// ====================================================================
+CaptureReader::~CaptureReader() {
+    close();
+}
+
+void CaptureReader::open(const std::string& path) {
+    close();
+#ifdef _WIN32
+    HANDLE f = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (f == INVALID_HANDLE_VALUE) throw CaptureError("capture: cannot open " + path);
+    LARGE_INTEGER sz{};
+    GetFileSizeEx(f, &sz);
+    size_ = static_cast<size_t>(sz.QuadPart);
+    file_ = f;
+    if (size_ > 0) {
+        HANDLE m = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!m) { close(); throw CaptureError("capture: cannot map " + path); }
+        map_  = m;
+        base_ = static_cast<const uint8_t*>(MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0));
+        if (!base_) { close(); throw CaptureError("capture: cannot map " + path); }
+    }
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw CaptureError("capture: cannot open " + path);
+    struct stat st{};
+    ::fstat(fd, &st);
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ > 0) {
+        void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) { ::close(fd); size_ = 0; throw CaptureError("capture: cannot map " + path); }
+        base_ = static_cast<const uint8_t*>(p);
+    }
+    ::close(fd);   // マップは fd を閉じても有効
+#endif
+
+    if (size_ < CAPTURE_FILE_HEADER || std::memcmp(base_, MAGIC, sizeof(MAGIC)) != 0) {
+        close();
+        throw CaptureError("capture: not a TR3 capture file: " + path);
+    }
+    if (get_le(base_ + 8, 2) != CAPTURE_VERSION) {
+        close();
+        throw CaptureError("capture: unsupported version: " + path);
+    }
+    pos_ = CAPTURE_FILE_HEADER;
+}
+
+void CaptureReader::close() {
+#ifdef _WIN32
+    if (base_) UnmapViewOfFile(base_);
+    if (map_)  CloseHandle(static_cast<HANDLE>(map_));
+    if (file_) CloseHandle(static_cast<HANDLE>(file_));
+    map_ = file_ = nullptr;
+#else
+    if (base_) ::munmap(const_cast<uint8_t*>(base_), size_);
+#endif
+    base_ = nullptr;
+    size_ = 0;
+    pos_  = CAPTURE_FILE_HEADER;
+}
+
+bool CaptureReader::next(CaptureRecord& rec) {
+    if (!base_ || pos_ + CAPTURE_RECORD_HEADER > size_) return false;
+    const uint8_t* p = base_ + pos_;
+    const size_t len = static_cast<size_t>(get_le(p + 12, 2));
+    if (pos_ + CAPTURE_RECORD_HEADER + len > size_) return false;   // 書き込み途中の末尾
+
+    rec.ts_us  = static_cast<int64_t>(get_le(p, 8));
+    rec.reader = static_cast<uint16_t>(get_le(p + 8, 2));
+    rec.dir    = static_cast<CaptureDir>(p[10]);
+    rec.frame  = ByteView(p + CAPTURE_RECORD_HEADER, len);
+    pos_ = std::min(size_, pos_ + CAPTURE_RECORD_HEADER + padded(len));
+    return true;
+}
+
+} // namespace tr3
@@ -1,6 +1,6 @@
 // =============================================
 // src/client.cpp
-// TR3シリーズ - 通信クライアント実装（Windows専用サンプル）
+// TR3シリーズ - 通信クライアント実装（Windows / POSIX）
 //
 // ポリシー：
 //  - 既存挙動を変えない（最小変更）
@@ -8,44 +8,52 @@
 //  - 日本語コメントで「何を・なぜ」を明確化
 //
 // 役割：
-//  - Client::connect  : TCP接続の確立（ブロッキング接続）と受信タイムアウト設定
+//  - Client::connect  : TCP接続の確立（ノンブロッキング接続）と受信タイムアウト設定
 //  - Client::transact : 1コマンド送信 → 1フレーム受信（Parserで厳密構文解析）
 //  - Client::receive_only : 受信のみ（次フレームを1つ取り出す）
+//  - Client::transact_batch : 複数コマンドを send 1回で送信 → 応答を送信順に受信
 //  - Client::close    : ソケットクローズ
 //
 // 注意：
-//  - Windows専用（_WIN32）分岐。Linux等では例外を投げて終了します。
-//  - 受信は1バイト単位で recv() → Parser.push() し、完成フレームになったら返します。
-//  - 受信タイムアウト時は「リトライ回数（retries）」に応じて再送→再受信します。
+//  - OS依存部分は net.cpp に集約（WinSock / BSDソケット）。
+//  - ソケットはノンブロッキング。受信待ちは poll 系（net::wait_readable）で行う。
+//  - 受信は recv() 1回でカーネルに溜まっている分をまとめて受信バッファ（rx_）へ取り込み、
+//    そこから Parser.feed() で一括解析します。完成フレームの後ろに続くバイトは
+//    rx_ / parser_ に残り、次の transact / receive_only で使われます。
+//  - 応答タイムアウトはコマンドごとの実測 RTT から求め（rtt.hpp、TimeoutPolicy）、
+//    期限切れ時は「リトライ回数（retries）」に応じて待ち時間を伸ばしながら再送します。
+//    期限は絶対時刻で持つため、途中でフレームの一部が届いても待ち時間は延びません。
+//  - 送信の直前に、前の呼び出しの取り残し（期限切れの後に届いた応答・再送で重複した応答・
+//    タグ応答）を受信バッファとカーネルから読み捨てます。TR3 の応答は ACK（0x30）が共通で
+//    どのコマンドへの応答か区別できないため、送信後に届いた応答は送ったコマンドのものとみなします。
+//    送信後に届いたタグ応答は、応答待ちの間も読み捨てます。
+//  - 送受信フレーム数・バイト数・再送・タイムアウトの回数と、transact / Inventory2 の所要時間を
+//    Metrics（metrics.hpp）に記録します。書き込みは lock なしの relaxed 更新だけです。
+//  - [send]/[recv] のフレームダンプは log.hpp（非同期ログ、Level::FRAME）へ積むだけで、
+//    整形・出力は書き出しスレッドが行います（既定では無効）。
 // =============================================
 
+#include <algorithm>
 #include <chrono>
 #include <thread>
-#include <iostream>
 #include "tr3/client.hpp"
+#include "tr3/inventory.hpp"
+#include "tr3/log.hpp"
 #include "tr3/protocol.hpp"
-#include "tr3/utils.hpp"
 
 namespace tr3 {
 
 // ------------------------------------------------------------
 // コンストラクタ／デストラクタ
-//  - Windowsでは WinSock の初期化／後始末を行う
+//  - Windowsでは WinSock の初期化／後始末を行う（net::startup/cleanup）
 // ------------------------------------------------------------
 Client::Client() {
-#ifdef _WIN32
-    WSADATA wsa{};
-    if (WSAStartup(MAKEWORD(2,2), &wsa) != 0) {
-        throw NetError("WSAStartup failed");
-    }
-#endif
+    net::startup();
 }
 
 Client::~Client() {
     close();              // 念のため接続をクローズ
-#ifdef _WIN32
-    WSACleanup();         // WinSock後始末
-#endif
+    net::cleanup();       // WinSock後始末（POSIXでは何もしない）
 }
 
 // ------------------------------------------------------------
@@ -53,164 +61,381 @@ Client::~Client() {
 // 概要   : 指定IP/PORTにTCP接続し、受信タイムアウトを設定
 // 引数   : ip         - 接続先IP（例: "192.168.0.10"）
 //          port       - ポート番号（例: 9004）
-//          timeout_ms - 受信タイムアウト（ミリ秒）
+//          timeout_ms - 接続／受信タイムアウト（ミリ秒）
 // 例外   : ネットワーク系エラーで NetError を送出
-// 備考   : Windows以外は未サポート（例外送出）
+// 備考   : ソケットはノンブロッキング + TCP_NODELAY。
+//          受信タイムアウトは SO_RCVTIMEO ではなく poll の待ち時間として扱う
 // ------------------------------------------------------------
 void Client::connect(const std::string& ip, uint16_t port, int timeout_ms) {
-#ifdef _WIN32
-    // 1) ソケット生成（TCP）
-    sock_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (sock_ == INVALID_SOCKET) {
-        throw NetError("socket() failed");
+    close();
+    sock_       = net::connect_tcp(ip, port, timeout_ms);
+    timeout_ms_ = timeout_ms;
+    // RTT は接続（経路・リーダ）ごとに測り直す
+    for (auto& e : rtt_) e.reset();
+    gap_.reset();
+}
+
+// ------------------------------------------------------------
+// 関数名 : close
+// 概要   : ソケットをクローズ（接続を終了）
+// ------------------------------------------------------------
+void Client::close() {
+    net::close_socket(sock_);
+    rx_.clear();          // 前の接続の残りバイトは持ち越さない
+    parser_.reset();
+}
+
+// ------------------------------------------------------------
+// 関数名 : next_frame
+// 概要   : 受信バッファ（rx_）を Parser::feed() で一括解析し、完成フレームを1つ取り出す
+// 引数   : fv - 完成フレームのビュー（rx_ または parser_ の内部バッファを指す）
+// 戻り値 : true = フレーム完成, false = バッファを使い切った（続きは次の受信待ち）
+// 備考   : 完成フレームの直後のバイトは rx_ に残したまま返る。
+//          fv は次の fill_rx() / next_frame() までに使い切ること
+// ------------------------------------------------------------
+bool Client::next_frame(FrameView& fv) {
+    // rx_ が空でも、再同期で parser_ 内に残った完成フレームがあれば返る
+    for (;;) {
+        const auto r = parser_.feed(ByteView(rx_.read_ptr(), rx_.read_len()), fv);
+        rx_.consume(r.consumed);
+        if (r.frame) { ++metrics_.frames_received; return true; }
+        if (rx_.empty()) return false;
     }
+}
+
+// ------------------------------------------------------------
+// 関数名 : fill_rx
+// 概要   : 期限まで受信可能を待ち、溜まっている分をまとめて rx_ へ受信
+// 戻り値 : true = 受信した（または受信データなしで poll が戻った）, false = 期限切れ
+// 例外   : 切断／受信エラーで NetError
+// ------------------------------------------------------------
+bool Client::fill_rx(clock::time_point deadline) {
+    const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clock::now()).count();
+    if (left <= 0) return false;
+    if (!net::wait_readable(sock_, static_cast<int>(left))) return false;
 
-    // 2) 宛先アドレス設定
-    sockaddr_in addr{};
-    addr.sin_family = AF_INET;
-    addr.sin_port   = htons(port);
-    if (inet_pton(AF_INET, ip.c_str(), &addr.sin_addr) != 1) {
-        ::closesocket(sock_);
-        sock_ = INVALID_SOCKET;
-        throw NetError("inet_pton failed");
+    const long n = net::recv_some(sock_, rx_.write_ptr(), rx_.write_len());
+    if (n == 0) throw NetError("connection closed by peer");
+    if (n > 0) {
+        rx_.commit(static_cast<size_t>(n));
+        metrics_.bytes_received += static_cast<uint64_t>(n);
     }
+    // n < 0（データなし）は poll の誤検知扱いで待ちに戻る
+    return true;
+}
 
-    // 3) ブロッキング接続（失敗で例外）
-    if (::connect(sock_, (SOCKADDR*)&addr, sizeof(addr)) == SOCKET_ERROR) {
-        ::closesocket(sock_);
-        sock_ = INVALID_SOCKET;
-        throw NetError("connect() failed");
+// ------------------------------------------------------------
+// 関数名 : wait_frame
+// 概要   : 受信済みのバイトから、足りなければ期限まで受信して完成フレームを1つ取り出す
+// 戻り値 : true = フレーム完成, false = 期限切れ
+// ------------------------------------------------------------
+bool Client::wait_frame(FrameView& fv, clock::time_point deadline) {
+    while (!next_frame(fv)) {
+        if (!fill_rx(deadline)) return false;
     }
+    return true;
+}
 
-    // 4) 受信タイムアウト（SO_RCVTIMEO）設定
-    //    recv() が timeout_ms を超えてブロックした場合にタイムアウト扱いになる
-    DWORD tv = static_cast<DWORD>(timeout_ms);
-    setsockopt(sock_, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof(tv));
-#else
-    (void)ip; (void)port; (void)timeout_ms;
-    throw NetError("Windows only sample");
-#endif
+// ------------------------------------------------------------
+// 関数名 : send_frame
+// 概要   : [send] ログ・キャプチャを残して1フレーム送信
+// ------------------------------------------------------------
+void Client::send_frame(ByteView frame) {
+    log::frame(log::Dir::SEND, frame);
+    net::send_all(sock_, frame.data(), frame.size(), timeout_ms_);
+    ++metrics_.frames_sent;
+    metrics_.bytes_sent += frame.size();
+    if (capture_) capture_->write(CaptureDir::SEND, capture_id_, frame);
 }
 
 // ------------------------------------------------------------
-// 関数名 : close
-// 概要   : ソケットをクローズ（接続を終了）
+// 関数名 : discard_stale
+// 概要   : 送信前に、受信済み（カーネルに届いている分を含む）のフレームをすべて読み捨てる
+// 例外   : 切断で NetError
+// 備考   : 待たない。書きかけのフレームも捨てる（Parser をリセット）ので、
+//          その続きが後から届いても STX を探し直すだけで応答とは取り違えない
 // ------------------------------------------------------------
-void Client::close() {
-#ifdef _WIN32
-    if (sock_ != INVALID_SOCKET) {
-        ::closesocket(sock_);
-        sock_ = INVALID_SOCKET;
+void Client::discard_stale() {
+    FrameView fv;
+    uint64_t  n_frames = 0;
+    for (;;) {
+        while (next_frame(fv)) ++n_frames;
+        if (!net::wait_readable(sock_, 0)) break;
+        const long n = net::recv_some(sock_, rx_.write_ptr(), rx_.write_len());
+        if (n == 0) throw NetError("connection closed by peer");
+        if (n < 0) break;
+        rx_.commit(static_cast<size_t>(n));
+        metrics_.bytes_received += static_cast<uint64_t>(n);
+    }
+    parser_.reset();
+    if (n_frames) {
+        metrics_.stale_frames += n_frames;
+        log::write(log::Level::DEBUG, "client: " + std::to_string(n_frames) + " stale frame(s) discarded");
     }
-#endif
+}
+
+// ------------------------------------------------------------
+// 関数名 : command_timeout_ms
+// 概要   : コマンド cmd の1回目の応答タイムアウト
+// ------------------------------------------------------------
+int Client::command_timeout_ms(uint8_t cmd) const {
+    if (!policy_.adaptive) return timeout_ms_;
+    return rtt_[cmd].rto_ms(policy_.min_ms, timeout_ms_, policy_.initial_ms);
+}
+
+// ------------------------------------------------------------
+// 関数名 : make_reply
+// 概要   : 完成フレームのビューから Reply を作り、[recv] ログを出す
+// 備考   : 解析済みのビューをそのまま使う（RAW の再解析はしない）。
+//          受信バッファはこの後上書きされるので、RAW だけはプールのスロットへ写す
+// ------------------------------------------------------------
+Client::Reply Client::make_reply(const FrameView& fv) {
+    // RAW をプールのスロットへ写す（DATA はその中を指すビュー。ヒープ確保なし）
+    Reply rep(fv.cmd, pool_->acquire(fv.raw));
+
+    // 受信ログ（RAWのままを可視化。Level::FRAME 有効時のみ積み、整形は書き出しスレッド）
+    log::frame(log::Dir::RECV, fv.raw);
+    if (capture_) capture_->write(CaptureDir::RECV, capture_id_, fv.raw);
+
+    // Inventory2 の最後のタグ応答で1サイクルの所要時間を記録
+    if (fv.cmd == RES_TAG && inv_left_ > 0 && --inv_left_ == 0) {
+        metrics_.inventory_us.record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - inv_start_).count()));
+    }
+    return rep;
+}
+
+// ------------------------------------------------------------
+// 関数名 : track_inventory
+// 概要   : Inventory2 の ACK（F0 NN）を受けたら、最後のタグ応答までの計測を始める
+//          （タグなしならその場で記録）
+// ------------------------------------------------------------
+void Client::track_inventory(const FrameView& ack, clock::time_point sent, clock::time_point now) {
+    inv_left_ = 0;
+    const auto n = parse_uid_count(ack.data);
+    if (!n) return;
+    if (*n == 0) {
+        metrics_.inventory_us.record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(now - sent).count()));
+        return;
+    }
+    inv_start_ = sent;
+    inv_left_  = *n;
+}
+
+// ------------------------------------------------------------
+// 関数名 : collect_metrics
+// 概要   : 計測値と Parser の統計を Prometheus の名前で out へ追加する
+// ------------------------------------------------------------
+void Client::collect_metrics(MetricsSnapshot& out, const std::string& labels) const {
+    const Parser::Stats& ps = parser_.stats();
+    out.counter("tr3_frames_sent_total",      "Frames sent to the reader.",                 labels, metrics_.frames_sent);
+    out.counter("tr3_frames_received_total",  "Complete frames received from the reader.",  labels, metrics_.frames_received);
+    out.counter("tr3_bytes_sent_total",       "Bytes sent to the reader.",                  labels, metrics_.bytes_sent);
+    out.counter("tr3_bytes_received_total",   "Bytes received from the reader.",            labels, metrics_.bytes_received);
+    out.counter("tr3_retries_total",          "Commands resent after a reply timeout.",     labels, metrics_.retries);
+    out.counter("tr3_timeouts_total",         "Reply timeouts reported to the caller.",     labels, metrics_.timeouts);
+    out.counter("tr3_stale_frames_total",     "Late or duplicate replies discarded.",       labels, metrics_.stale_frames);
+    out.counter("tr3_checksum_errors_total",  "Frames rejected for a SUM mismatch.",        labels, ps.checksum_errors);
+    out.counter("tr3_format_errors_total",    "Frames rejected for a bad ETX/CR position.", labels, ps.format_errors);
+    out.counter("tr3_resyncs_total",          "Parser resynchronizations on a bad frame.",  labels, ps.resyncs);
+    out.counter("tr3_dropped_bytes_total",    "Received bytes that were not part of a frame.", labels, ps.dropped_bytes);
+    out.histogram("tr3_transact_seconds",        "Command send to reply.",                       labels, metrics_.transact_us.snapshot(), 1e-6);
+    out.histogram("tr3_inventory_cycle_seconds", "Inventory2 send to the last tag reply.",       labels, metrics_.inventory_us.snapshot(), 1e-6);
 }
 
 // ------------------------------------------------------------
 // 関数名 : transact
 // 概要   : 1コマンド送信 → 1フレーム受信 を行う
-// 引数   : frame   - 送信フレーム（protocol::Frame::encode() 済み）
-//          retries - 受信タイムアウト時の再送回数（0で再送なし）
-// 戻り値 : Reply   - 解析済み CMD, DATA, 受信RAW
-// 例外   : 送受信失敗/タイムアウトで NetError を送出
+// 引数   : frame      - 送信フレーム（encode 済み。送信中は呼び出し側のバッファを直接使う）
+//          retries    - 応答タイムアウト時の再送回数（0で再送なし）
+//          timeout_ms - 再送を含む全体の期限（-1 = 期限なし。各回の応答タイムアウトのみ）
+// 戻り値 : Reply      - 解析済み CMD, DATA, 受信RAW
+// 例外   : 応答タイムアウトで TimeoutError、送受信失敗/切断で NetError を送出
 // 挙動   :
-//   1) [send] ログを出して全体フレームを送信
-//   2) 1バイトずつ recv → Parser.push() で構文解析
-//   3) タイムアウト（n==0 or WSAETIMEDOUT）時は retries が残っていれば再送→受信継続
-//   4) 完成フレームになったら RAW を確保し、Decoded に変換して [recv] ログ出力
-// ------------------------------------------------------------
-Client::Reply Client::transact(const std::vector<uint8_t>& frame, int retries) {
-#ifdef _WIN32
-    // 送信ログ
-    std::cout << tr3::ts_now() << "  [send]  " << tr3::hex_spaced(frame) << "\n";
-
-    // 送信
-    int sent = send(sock_, (const char*)frame.data(), (int)frame.size(), 0);
-    if (sent == SOCKET_ERROR) {
-        throw NetError("send() failed");
-    }
+//   1) 前の呼び出しの取り残しを読み捨て（discard_stale）、[send] ログを出して全体フレームを送信
+//   2) 足りなければ recv でまとめて受信（送信後に届いたタグ応答は読み捨てる）
+//   3) 応答タイムアウト（command_timeout_ms、再送ごとに backoff 倍）で
+//      retries が残っていれば再送→受信継続。全体の期限を過ぎたら打ち切り。
+//      Inventory2 は再送しない（再送するとリーダがもう1巡読み、ACK とタグ応答が重複して届く）
+//   4) 再送しなかった応答だけを RTT の標本にする（Karn）
+//   5) 完成フレームのビューから Reply を作り [recv] ログ出力
+// ------------------------------------------------------------
+Client::Reply Client::transact(ByteView frame, int retries, int timeout_ms) {
+    if (sock_ == net::INVALID_SOCK) throw NetError("not connected");
+    const uint8_t cmd = frame.size() > 2 ? frame[2] : 0;
+
+    const auto start    = clock::now();
+    const auto call_end = timeout_ms >= 0 ? start + std::chrono::milliseconds(timeout_ms) : clock::time_point::max();
+    double     wait_ms  = command_timeout_ms(cmd);
+    bool       resent   = false;
+    inv_left_ = 0;   // 前の Inventory2 のタグ応答の計測は打ち切る
+    if (cmd == CMD_INVENTORY2) retries = 0;
+
+    auto attempt_end = std::min(call_end, start + std::chrono::milliseconds(static_cast<int64_t>(wait_ms)));
 
-    // 受信：1バイトずつ Parser に積んで、完成フレームを待つ
-    Parser p;
-    std::vector<uint8_t> raw;
+    discard_stale();
+    send_frame(frame);
+
+    FrameView fv;
     for (;;) {
-        char c;
-        int n = recv(sock_, &c, 1, 0);
-        if (n == 1) {
-            // 1バイト受信 → 状態機械に投入
-            if (p.push((uint8_t)c)) {
-                // 完成フレーム（STX..CR）をRAWとして取得
-                raw = p.take_raw();   // ★ 先にRAWを確保してから解析へ
-                break;
-            }
-        } else if (n == 0 || (n == SOCKET_ERROR && WSAGetLastError() == WSAETIMEDOUT)) {
-            // タイムアウトまたは切断
-            if (retries-- > 0) {
-                // 指定回数の範囲で再送 → 受信継続
-                int sent2 = send(sock_, (const char*)frame.data(), (int)frame.size(), 0);
-                if (sent2 == SOCKET_ERROR) {
-                    throw NetError("send(retry) failed");
-                }
+        if (wait_frame(fv, attempt_end)) {
+            if (fv.cmd == RES_TAG) {
+                // 前の Inventory のタグ応答が遅れて届いたもの（この要求の応答ではない）
+                ++metrics_.stale_frames;
+                log::write(log::Level::DEBUG, "client: stale tag frame discarded");
                 continue;
             }
-            // リトライなし／尽きた → タイムアウト扱い
-            throw NetError("recv timeout");
+            break;
         }
-        // それ以外のエラーは SO_RCVTIMEO によってここに来にくい想定
+        if (retries-- <= 0 || clock::now() >= call_end) {
+            ++metrics_.timeouts;
+            throw TimeoutError("recv timeout");
+        }
+        ++metrics_.retries;
+        // 待ち時間を伸ばして再送 → 受信継続
+        wait_ms = std::min(wait_ms * policy_.backoff, static_cast<double>(timeout_ms_));
+        resent  = true;
+        attempt_end = std::min(call_end, clock::now() + std::chrono::milliseconds(static_cast<int64_t>(wait_ms)));
+        send_frame(frame);
     }
 
-    // 受信RAW → Decoded に変換（addr/cmd/dataを取り出す）
-    Parser p2;
-    for (auto b : raw) p2.push(b);
-    Decoded d = p2.take();
-
-    // 受信ログ（RAWのままを可視化）
-    std::cout << tr3::ts_now() << "  [recv]  " << tr3::hex_spaced(raw) << "\n";
-
-    // 呼び出し側がデータ本体とRAWの両方を扱えるように返却
-    return Reply{ d.cmd, d.data, std::move(raw) };
-#else
-    throw NetError("Windows only sample");
-#endif
+    const auto end = clock::now();
+    if (!resent) {
+        rtt_[cmd].sample(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    metrics_.transact_us.record(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()));
+    if (cmd == CMD_INVENTORY2) track_inventory(fv, start, end);
+    return make_reply(fv);
 }
 
 // ------------------------------------------------------------
 // 関数名 : receive_only
 // 概要   : 受信のみ（次に到着したフレーム1つを取り出す）
-// 引数   : timeout_ms（未使用。SO_RCVTIMEOに従ってブロック/タイムアウト）
+// 引数   : timeout_ms - 待ち時間の上限（-1 = これまでの待ち時間の実測から求める）
 // 戻り値 : Reply（CMD, DATA, RAW）
-// 例外   : タイムアウトで NetError("recv timeout (receive_only)")
+// 例外   : タイムアウトで TimeoutError("recv timeout (receive_only)")、切断で NetError
+// 備考   : 受信済みで待たずに取り出せたフレームは待ち時間の標本にしない
 // ------------------------------------------------------------
-Client::Reply Client::receive_only(int /*timeout_ms*/) {
-#ifdef _WIN32
-    Parser p;
-    std::vector<uint8_t> raw;
+Client::Reply Client::receive_only(int timeout_ms) {
+    if (sock_ == net::INVALID_SOCK) throw NetError("not connected");
 
-    for (;;) {
-        char c;
-        int n = recv(sock_, &c, 1, 0);
-        if (n == 1) {
-            if (p.push((uint8_t)c)) {
-                raw = p.take_raw();   // フレーム完成
-                break;
-            }
-        } else if (n == 0 || (n == SOCKET_ERROR && WSAGetLastError() == WSAETIMEDOUT)) {
-            // タイムアウトまたは切断
-            throw NetError("recv timeout (receive_only)");
-        }
+    // 直前の受信で取り込み済みのフレームがあれば recv せずに返る
+    FrameView fv;
+    if (next_frame(fv)) return make_reply(fv);
+
+    if (timeout_ms < 0) {
+        timeout_ms = policy_.adaptive ? gap_.rto_ms(policy_.min_ms, timeout_ms_, policy_.initial_ms)
+                                      : timeout_ms_;
+    }
+    const auto start = clock::now();
+    if (!wait_frame(fv, start + std::chrono::milliseconds(timeout_ms))) {
+        ++metrics_.timeouts;
+        throw TimeoutError("recv timeout (receive_only)");
+    }
+    gap_.sample(std::chrono::duration<double, std::milli>(clock::now() - start).count());
+    return make_reply(fv);
+}
+
+// ------------------------------------------------------------
+// 関数名 : transact_batch
+// 概要   : batch の全フレームを1回の send で送信し、応答を送信順に対応付けて受け取る
+// 引数   : batch      - 送信するコマンド列
+//          timeout_ms - 全体の期限（-1 = 各コマンドの command_timeout_ms の合計）
+// 戻り値 : batch と同じ順・同じ数の BatchReply
+// 例外   : 期限切れで TimeoutError("recv timeout (batch)")、送受信失敗/切断で NetError
+// 挙動   :
+//   1) 前の呼び出し（期限切れで打ち切ったバッチなど）の取り残しを読み捨て（discard_stale）、
+//      連続バッファ（batch.bytes()）をそのまま send_all 1回で送る。
+//      TCP_NODELAY でもフレームごとに分かれず、通常1セグメントで届く
+//   2) 応答（RES_TAG 以外）を受け取るたびに次のコマンドへ対応付ける。
+//      最初の応答より前に届いたタグ応答は前の呼び出しの取り残しとして読み捨てる
+//   3) Inventory2 の ACK（F0 NN）の後は NN 件のタグ応答をその応答に付ける。
+//      件数に満たないうちに別の応答が来たら、それを次のコマンドの応答とする
+//   4) RTT の標本にするのは最初の応答だけ（2件目以降の経過時間には前のコマンドの
+//      処理時間が積み重なり、そのコマンド単独の往復時間ではないため）
+// ------------------------------------------------------------
+std::vector<Client::BatchReply> Client::transact_batch(const CommandBatch& batch, int timeout_ms) {
+    std::vector<BatchReply> out;
+    transact_batch(batch, out, timeout_ms);
+    return out;
+}
+
+// ------------------------------------------------------------
+// 関数名 : transact_batch（結果の入れ物を使い回す版）
+// 備考   : out の要素とタグ応答の vector は容量ごと使い回す（定常状態ではヒープ確保しない）
+// ------------------------------------------------------------
+void Client::transact_batch(const CommandBatch& batch, std::vector<BatchReply>& out, int timeout_ms) {
+    if (sock_ == net::INVALID_SOCK) throw NetError("not connected");
+    out.resize(batch.count());
+    for (auto& br : out) {
+        br.reply = Reply();   // 前回のスロットはプールへ返す
+        br.tags.clear();
     }
+    if (batch.empty()) return;
 
-    // RAW → Decoded へ
-    Parser p2;
-    for (auto b : raw) p2.push(b);
-    Decoded d = p2.take();
+    if (timeout_ms < 0) {
+        timeout_ms = 0;
+        for (size_t i = 0; i < batch.count(); ++i) timeout_ms += command_timeout_ms(batch.cmd(i));
+    }
+    discard_stale();
+    const auto start    = clock::now();
+    const auto deadline = start + std::chrono::milliseconds(timeout_ms);
 
-    // 受信ログ
-    std::cout << tr3::ts_now() << "  [recv]  " << tr3::hex_spaced(raw) << "\n";
+    for (size_t i = 0; i < batch.count(); ++i) log::frame(log::Dir::SEND, batch.frame(i));
+    const ByteView all = batch.bytes();
+    net::send_all(sock_, all.data(), all.size(), timeout_ms_);
+    metrics_.frames_sent += batch.count();
+    metrics_.bytes_sent  += all.size();
+    inv_left_ = 0;
+    if (capture_) {
+        for (size_t i = 0; i < batch.count(); ++i) capture_->write(CaptureDir::SEND, capture_id_, batch.frame(i));
+    }
 
-    return Reply{ d.cmd, d.data, std::move(raw) };
-#else
-    throw NetError("Windows only sample");
-#endif
+    FrameView fv;
+    size_t got       = 0;   // 応答を受け取ったコマンド数
+    int    tags_left = 0;   // 直前の Inventory2 に続くタグ応答の残り件数
+    while (got < batch.count() || tags_left > 0) {
+        if (!wait_frame(fv, deadline)) {
+            ++metrics_.timeouts;
+            throw TimeoutError("recv timeout (batch)");
+        }
+
+        if (fv.cmd == RES_TAG) {
+            if (tags_left > 0) {
+                out[got - 1].tags.push_back(make_reply(fv));
+                --tags_left;
+            } else {
+                ++metrics_.stale_frames;
+                log::write(log::Level::DEBUG, "client: stale tag frame discarded");
+            }
+            continue;
+        }
+        if (got == batch.count()) {
+            // 全応答がそろった後にタグ応答の代わりに来た応答（対応するコマンドがない）
+            log::write(log::Level::DEBUG, "client: unexpected frame after batch discarded");
+            break;
+        }
+
+        // RTT は最初の応答だけ（以降は前のコマンドの処理時間を含む）。所要時間の記録は全件
+        const uint8_t cmd = batch.cmd(got);
+        const auto    end = clock::now();
+        if (got == 0) rtt_[cmd].sample(std::chrono::duration<double, std::milli>(end - start).count());
+        metrics_.transact_us.record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()));
+
+        tags_left = 0;
+        if (cmd == CMD_INVENTORY2) track_inventory(fv, start, end);
+        BatchReply& br = out[got++];
+        br.reply = make_reply(fv);
+        if (cmd == CMD_INVENTORY2) {
+            if (auto n = parse_uid_count(br.reply.data)) {
+                tags_left = *n;
+                br.tags.reserve(static_cast<size_t>(*n));
+            }
+        }
+    }
 }
 
 } // namespace tr3
@@ -0,0 +1,60 @@
+// =============================================
+// src/frame_pool.cpp
+// TR3シリーズ - 受信フレーム用のバッファプール実装
+//
+//  - 空きスロットは先頭 8 バイトに次の空きスロットのアドレスを書いた単方向リスト
+//  - チャンクはプールの破棄まで解放しない（貸し出し中のスロットは FrameBlock が
+//    プールを持っているので、プールより先に消えることはない）
+// =============================================
+
+#include "tr3/frame_pool.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace tr3 {
+
+// ------------------------------------------------------------
+// 関数名 : acquire
+// ------------------------------------------------------------
+FrameBlock FramePool::acquire(ByteView bytes) {
+    if (bytes.size() > SLOT_SIZE) throw std::length_error("FramePool: フレームがスロットより長い");
+
+    uint8_t* p = nullptr;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (!free_) {
+            chunks_.emplace_back(new uint8_t[SLOT_SIZE * CHUNK_SLOTS]);
+            uint8_t* base = chunks_.back().get();
+            for (size_t i = CHUNK_SLOTS; i-- > 0; ) {
+                uint8_t* s = base + i * SLOT_SIZE;
+                std::memcpy(s, &free_, sizeof(free_));
+                free_ = s;
+            }
+        }
+        p = free_;
+        std::memcpy(&free_, p, sizeof(free_));
+        ++in_use_;
+    }
+    if (!bytes.empty()) std::memcpy(p, bytes.data(), bytes.size());
+    return FrameBlock(shared_from_this(), p, bytes.size());
+}
+
+void FramePool::release(uint8_t* p) {
+    std::lock_guard<std::mutex> lk(mu_);
+    std::memcpy(p, &free_, sizeof(free_));
+    free_ = p;
+    --in_use_;
+}
+
+size_t FramePool::capacity() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return chunks_.size() * CHUNK_SLOTS;
+}
+
+size_t FramePool::in_use() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return in_use_;
+}
+
+} // namespace tr3
@@ -0,0 +1,69 @@
+// =============================================
+// src/inventory_stream.cpp
+// TR3シリーズ - 連続 Inventory（ストリーミング）実装
+//
+// 流れ：
+//   run() → depth 個の Inventory2 を submit
+//         → 完了コールバックで ACK/タグを解析して on_tag へ
+//         → 停止要求がなければ次の Inventory2 を補充
+//         → 未完了がなくなったら戻る
+// =============================================
+
+#include "tr3/inventory_stream.hpp"
+
+namespace tr3 {
+
+// ------------------------------------------------------------
+// 関数名 : run
+// 備考   : cycles() / tags() は呼ぶたびに 0 から数え直す（直前の run() の結果）
+// ------------------------------------------------------------
+void InventoryStream::run(uint64_t max_cycles) {
+    stop_       = false;
+    max_cycles_ = max_cycles;
+    submitted_  = 0;
+    cycles_.store(0, std::memory_order_relaxed);
+    tags_.store(0, std::memory_order_relaxed);
+    error_      = nullptr;
+
+    for (int i = 0; i < depth_; ++i) submit_one();
+    cli_.run_until_idle();
+
+    if (error_) std::rethrow_exception(error_);
+}
+
+// ------------------------------------------------------------
+// 関数名 : submit_one
+// 概要   : Inventory2 を1つ投入（停止要求・サイクル上限・エラー時は投入しない）
+// ------------------------------------------------------------
+void InventoryStream::submit_one() {
+    if (stop_ || error_) return;
+    if (max_cycles_ && submitted_ >= max_cycles_) return;
+    ++submitted_;
+
+    FrameBuffer fb;
+    cli_.submit(cmd::inventory2(fb, addr_), [this](AsyncClient::Result&& r) {
+        if (r.error) {
+            if (!error_) error_ = r.error;
+            return;
+        }
+
+        // タグ応答（ACK「F0 NN」に続く NN 件）を解析。NACK 等はタグ 0 件のサイクル扱い
+        int got = 0;
+        for (const auto& t : r.tags) {
+            if (auto tag = parse_tag(t.cmd, t.data)) {
+                ++got;
+                if (on_tag_) on_tag_(*tag);
+            }
+        }
+        // 書き手は run() のスレッドだけなので read-modify-write は要らない（Counter と同じ）
+        tags_.store(tags_.load(std::memory_order_relaxed) + static_cast<uint64_t>(got),
+                    std::memory_order_relaxed);
+        const uint64_t done = cycles_.load(std::memory_order_relaxed) + 1;
+        cycles_.store(done, std::memory_order_relaxed);
+        if (on_cycle_) on_cycle_(done, got);
+
+        submit_one();
+    });
+}
+
+} // namespace tr3
@@ -0,0 +1,284 @@
+// =============================================
+// src/log.cpp
+// TR3シリーズ - 非同期ログ実装
+//
+// リングバッファ：
+//  - 固定長スロットの配列（容量は 2 のべき乗）。各スロットは通し番号 seq を持つ
+//  - 書き込み側（複数スレッド）は enq_ を CAS で進めてスロットを確保し、
+//    レコードを書いてから seq = pos + 1 を公開する（満杯なら捨てる）
+//  - 書き出しスレッド（1本）は seq == deq_ + 1 のスロットだけを取り出し、
+//    seq = deq_ + 容量 に戻して再利用可能にする
+//
+// 書き出し：
+//  - 取り出したレコードをその場で整形（時刻は秒単位で localtime をキャッシュ）
+//  - リングが空になったら fflush し、短く眠って再確認する
+// =============================================
+
+#include "tr3/log.hpp"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace tr3::log {
+
+namespace {
+
+using sys_clock = std::chrono::system_clock;
+
+constexpr size_t RING_SLOTS = 4096;   // 2 のべき乗
+constexpr size_t MAX_BYTES  = MAX_FRAME_LEN;
+constexpr auto   FLUSH_WAIT = std::chrono::seconds(1);   // flush() が待つ上限
+
+// 1件ぶんのバイナリレコード
+struct Record {
+    int64_t  ts_us = 0;               // system_clock のエポックからのマイクロ秒
+    uint16_t len   = 0;               // bytes の有効長
+    Level    level = Level::INFO;
+    Dir      dir   = Dir::NONE;       // NONE = テキスト
+    std::array<uint8_t, MAX_BYTES> bytes;
+};
+
+struct Slot {
+    std::atomic<size_t> seq{0};
+    Record              rec;
+};
+
+const char* level_tag(Level lv) {
+    switch (lv) {
+    case Level::FRAME: return "[frame]";
+    case Level::DEBUG: return "[debug]";
+    case Level::INFO:  return "[info] ";
+    case Level::WARN:  return "[warn] ";
+    case Level::ERR:   return "[error]";
+    default:           return "[log]  ";
+    }
+}
+
+// ------------------------------------------------------------
+// 整形（書き出しスレッド／同期モードの呼び出し側でのみ実行）
+// ------------------------------------------------------------
+class Formatter {
+public:
+    // レコード1件を1行にして fp へ
+    void print(std::FILE* fp, const Record& r) {
+        char line[32 + 3 * MAX_BYTES];
+        size_t n = stamp(line, r.ts_us);
+
+        const char* tag = r.dir == Dir::SEND ? "[send]" : r.dir == Dir::RECV ? "[recv]" : level_tag(r.level);
+        n += static_cast<size_t>(std::snprintf(line + n, sizeof(line) - n, "  %s  ", tag));
+
+        if (r.dir == Dir::NONE) {
+            std::memcpy(line + n, r.bytes.data(), r.len);
+            n += r.len;
+        } else {
+            static const char HEX[] = "0123456789ABCDEF";
+            for (size_t i = 0; i < r.len; ++i) {
+                if (i) line[n++] = ' ';
+                line[n++] = HEX[r.bytes[i] >> 4];
+                line[n++] = HEX[r.bytes[i] & 0x0F];
+            }
+        }
+        line[n++] = '\n';
+        std::fwrite(line, 1, n, fp);
+    }
+
+private:
+    // "MM/DD HH:MM:SS.mmm"（utils.hpp の ts_now と同じ形式）
+    size_t stamp(char* out, int64_t ts_us) {
+        const int64_t sec = ts_us / 1000000;
+        const int     ms  = static_cast<int>((ts_us / 1000) % 1000);
+        if (sec != cached_sec_) {
+            const std::time_t tt = static_cast<std::time_t>(sec);
+            std::tm lt{};
+#if defined(_WIN32)
+            localtime_s(&lt, &tt);
+#else
+            localtime_r(&tt, &lt);
+#endif
+            std::snprintf(cached_, sizeof(cached_), "%02d/%02d %02d:%02d:%02d",
+                          lt.tm_mon + 1, lt.tm_mday, lt.tm_hour, lt.tm_min, lt.tm_sec);
+            cached_sec_ = sec;
+        }
+        return static_cast<size_t>(std::snprintf(out, 32, "%s.%03d", cached_, ms));
+    }
+
+    int64_t cached_sec_ = -1;
+    char    cached_[24] = {};
+};
+
+// ------------------------------------------------------------
+// ロガー本体（プロセスに1つ。書き出しスレッドは最初の記録で起動）
+// ------------------------------------------------------------
+class Logger {
+public:
+    Logger() : slots_(new Slot[RING_SLOTS]) {
+        for (size_t i = 0; i < RING_SLOTS; ++i) slots_[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    ~Logger() {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        done_cv_.notify_all();
+        if (writer_.joinable()) writer_.join();
+        drain();                                  // 起動前／停止後に積まれた分
+        std::fflush(out_.load());
+    }
+
+    void set_output(std::FILE* fp) { flush(); out_.store(fp ? fp : stdout); }
+    void set_synchronous(bool on)  { flush(); sync_.store(on); }
+
+    void push(Level lv, Dir dir, const uint8_t* p, size_t n) {
+        if (n > MAX_BYTES) n = MAX_BYTES;
+        const int64_t ts = std::chrono::duration_cast<std::chrono::microseconds>(
+            sys_clock::now().time_since_epoch()).count();
+
+        if (sync_.load(std::memory_order_relaxed)) {
+            Record r;
+            r.ts_us = ts; r.level = lv; r.dir = dir; r.len = static_cast<uint16_t>(n);
+            std::memcpy(r.bytes.data(), p, n);
+            std::lock_guard<std::mutex> lk(mu_);
+            sync_fmt_.print(out_.load(), r);
+            std::fflush(out_.load());
+            return;
+        }
+
+        ensure_writer();
+
+        // スロット確保（Vyukov 型 MPMC の書き込み側）
+        size_t pos = enq_.load(std::memory_order_relaxed);
+        Slot* s;
+        for (;;) {
+            s = &slots_[pos & (RING_SLOTS - 1)];
+            const size_t seq = s->seq.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enq_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);   // 満杯
+                return;
+            } else {
+                pos = enq_.load(std::memory_order_relaxed);
+            }
+        }
+        s->rec.ts_us = ts;
+        s->rec.level = lv;
+        s->rec.dir   = dir;
+        s->rec.len   = static_cast<uint16_t>(n);
+        std::memcpy(s->rec.bytes.data(), p, n);
+        s->seq.store(pos + 1, std::memory_order_release);
+    }
+
+    // 書き出しスレッドが現在の enq_ まで処理し終えるのを待つ
+    // （書き出しスレッドが停止済み、または出力先が詰まって FLUSH_WAIT を過ぎたら諦めて戻る）
+    void flush() {
+        const size_t target = enq_.load(std::memory_order_acquire);
+        if (!writer_started_.load(std::memory_order_acquire)) return;
+        const auto give_up = std::chrono::steady_clock::now() + FLUSH_WAIT;
+        std::unique_lock<std::mutex> lk(mu_);
+        cv_.notify_all();
+        while (!stop_ && done_.load(std::memory_order_acquire) < target) {
+            if (done_cv_.wait_until(lk, give_up) == std::cv_status::timeout) break;
+        }
+    }
+
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    void ensure_writer() {
+        if (writer_started_.load(std::memory_order_acquire)) return;
+        std::lock_guard<std::mutex> lk(mu_);
+        if (writer_started_.load(std::memory_order_relaxed) || stop_) return;
+        writer_ = std::thread([this] { run(); });
+        writer_started_.store(true, std::memory_order_release);
+    }
+
+    // 取り出せる分をすべて書き出す（戻値：書き出した件数）
+    size_t drain() {
+        std::FILE* fp = out_.load();
+        size_t count = 0;
+        for (;;) {
+            Slot& s = slots_[deq_ & (RING_SLOTS - 1)];
+            const size_t seq = s.seq.load(std::memory_order_acquire);
+            if (seq != deq_ + 1) break;           // 未公開（空、または書き込み途中）
+            fmt_.print(fp, s.rec);
+            s.seq.store(deq_ + RING_SLOTS, std::memory_order_release);
+            ++deq_;
+            ++count;
+            done_.store(deq_, std::memory_order_release);
+        }
+        if (count) std::fflush(fp);
+        return count;
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lk(mu_);
+        while (!stop_) {
+            lk.unlock();
+            const size_t n = drain();
+            lk.lock();
+            if (n) done_cv_.notify_all();        // flush() 待ちへ（done_ は mu_ を取る前に更新済み）
+            if (n == 0 && !stop_) cv_.wait_for(lk, std::chrono::milliseconds(2));
+        }
+    }
+
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<size_t>     enq_{0};            // 書き込み側の次の位置
+    size_t                  deq_ = 0;           // 書き出しスレッドの次の位置
+    std::atomic<size_t>     done_{0};           // 書き出し済み件数（flush 用）
+    std::atomic<uint64_t>   dropped_{0};
+
+    std::atomic<std::FILE*> out_{stdout};
+    std::atomic<bool>       sync_{false};
+    Formatter               fmt_;               // 書き出しスレッド専用
+    Formatter               sync_fmt_;          // 同期モード用（mu_ で保護）
+
+    std::mutex              mu_;
+    std::condition_variable cv_;
+    std::condition_variable done_cv_;           // done_ が進んだ（flush 待ち用）
+    bool                    stop_ = false;
+    std::atomic<bool>       writer_started_{false};
+    std::thread             writer_;
+};
+
+Logger& logger() {
+    static Logger inst;
+    return inst;
+}
+
+} // namespace
+
+bool parse_level(std::string_view name, Level& out) {
+    if      (name == "frame") out = Level::FRAME;
+    else if (name == "debug") out = Level::DEBUG;
+    else if (name == "info")  out = Level::INFO;
+    else if (name == "warn")  out = Level::WARN;
+    else if (name == "error") out = Level::ERR;
+    else if (name == "off")   out = Level::OFF;
+    else return false;
+    return true;
+}
+
+void set_output(std::FILE* fp)   { logger().set_output(fp); }
+void set_synchronous(bool on)    { logger().set_synchronous(on); }
+
+void frame_record(Dir dir, ByteView raw) {
+    logger().push(Level::FRAME, dir, raw.data(), raw.size());
+}
+
+void text_record(Level lv, std::string_view msg) {
+    logger().push(lv, Dir::NONE, reinterpret_cast<const uint8_t*>(msg.data()), msg.size());
+}
+
+void flush()        { logger().flush(); }
+uint64_t dropped()  { return logger().dropped(); }
+
+} // namespace tr3::log
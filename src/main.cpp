@@ -5,7 +5,15 @@
 // ポリシー：
 //  - 既存挙動を変えない（最小変更）
 //  - 読取回数は「引数で既定値→プロンプトで最終決定」
+//  - 第2引数にファイル名を与えると送受信フレームをバイナリキャプチャ（tr3_replay で再生可）
+//  - 通信が切れたら自動で再接続し、ROM確認・コマンドモード設定をやり直して
+//    中断したアンテナから読取を続ける（SupervisedClient）
+//  - アンテナの巡回順とブザーは AntennaScheduler に従う（タグなしが続くアンテナは番を飛ばす）
+//  - アンテナ切替・Inventory2・ブザーは CommandBatch で1回の送信にまとめる
 //  - プロンプトはすべて日本語のまま
+//  - 第1引数が "--" で始まるときは常駐（headless）モード：設定はフラグ／設定ファイルから取り、
+//    プロンプトも config.txt の書き換えもせず、停止されるまで最大速度で読み取って
+//    タグを NDJSON / CSV / バイナリで標準出力またはファイルへ流す（run_headless）
 //  - 通信プロトコル層（protocol.hpp/cpp）は変更しない
 // =============================================
 
@@ -21,20 +29,36 @@
 #include <array>
 #include <optional>
 #include <fstream>
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+#include <memory>
 
 #ifndef NOMINMAX
 #define NOMINMAX 1
 #endif
 
 // Windowsの古いwinsock.hとの競合を避けるため、必ずwinsock2.hを先にinclude
+#ifdef _WIN32
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #include <windows.h>
+#endif
 
 // ↓ 既存のクライアント／プロトコル／ユーティリティをそのまま利用
 #include "tr3/client.hpp"
+#include "tr3/supervised_client.hpp"   // 自動再接続
+#include "tr3/antenna_scheduler.hpp"   // アンテナ巡回（重み・休止・ブザー）
+#include "tr3/command_batch.hpp"       // コマンドの一括送信
 #include "tr3/protocol.hpp"
 #include "tr3/utils.hpp"
+#include "tr3/command_catalog.hpp"   // コマンド一覧・応答のデコード（RomInfo / InventoryAck / TagInfo）
+#include "tr3/log.hpp"         // [send]/[recv] フレームダンプ
+#include "tr3/capture.hpp"     // バイナリキャプチャ
+#include "tr3/metrics.hpp"     // 通信の統計
+#include "tr3/tag_writer.hpp"  // タグ出力（常駐モード）
+#include "tr3/tag_store.hpp"   // 読取の記録（UID ごとの集計）
+#include "tr3/tag_sink.hpp"    // タグの送出（常駐モード。ファイル・ソケット）
 
 // ---------------------------------------------
 // 時刻文字列（mm/dd HH:MM:SS.mmm）
@@ -70,52 +94,336 @@ static std::string hex_str(const std::vector<uint8_t>& v) {
     return oss.str();
 }
 
+// =============================================
+// 常駐（headless）モード
+// =============================================
+//
+//   tr3xm_lan --ip 192.168.0.2 [--port 9004] [--config tr3.conf] ...
+//
+// 設定ファイルは「キー = 値」の行（# 以降はコメント）。キーはフラグ名から "--" を除いたもの。
+// 同じ項目はコマンドラインのフラグが優先する。
+// SIGINT / SIGTERM で読取を止め、出力を書き出してから終了する（終了コード 0）。
 // ---------------------------------------------
-// ROMバージョン応答の簡易パーサ
-//  仕様：先頭0x90、以降に ASCII 数字/記号が並ぶ想定
-// ---------------------------------------------
-struct RomInfo {
-    int         major{};
-    int         minor{};
-    int         patch{};
-    std::string series;
-    std::string code;
+struct HeadlessOptions {
+    std::string ip          = "192.168.0.2";
+    uint16_t    port        = 9004;
+    uint32_t    reader_id   = 0;                  // 出力レコードの reader（複数台の出力を突き合わせる用）
+    int         antennas    = 1;
+    tr3::BuzzerMode buzzer  = tr3::BuzzerMode::OFF;
+    int         timeout_ms  = 2000;               // 接続タイムアウト兼、応答タイムアウトの上限
+    uint64_t    rounds      = 0;                  // 読取回数（1巡単位。0 = 停止されるまで）
+    tr3::TagFormat format   = tr3::TagFormat::NDJSON;
+    std::string output      = "-";                // "-" = 標準出力
+    size_t      flush_bytes = 64 * 1024;
+    int         flush_ms    = 1000;
+    std::string capture;                          // 送受信フレームのキャプチャ（空 = しない）
+    std::string metrics;                          // Prometheus 形式の統計ファイル（空 = 出さない）
+    int         metrics_interval_s = 10;
+    std::string store;                            // 読取を残す TagStore のディレクトリ（空 = 残さない）
+    size_t      store_keep  = 0;                  // 残すセグメント数（1 分ごと。0 = 無制限）
+    std::string export_uri;                       // 送出先 file:/unix:/tcp:/udp:（空 = 送らない）
+    tr3::TagFormat  export_format = tr3::TagFormat::NDJSON;
+    tr3::SinkPolicy export_policy = tr3::SinkPolicy::DROP_NEWEST;
+    uint64_t    export_rotate_mb = 64;            // file: の世代を回すサイズ（0 = 回さない）
+    int         export_keep = 5;                  // file: の古い世代を残す数
+    tr3::log::Level log_level = tr3::log::Level::INFO;   // ログは標準エラーへ
 };
 
-static RomInfo parse_rom(const std::vector<uint8_t>& d) {
-    RomInfo r;
-    if (d.size() >= 10 && d[0] == 0x90) {
-        auto dig = [](uint8_t c){ return (c>='0' && c<='9') ? c - '0' : 0; };
-        r.major  = dig(d[1]);
-        r.minor  = dig(d[2]) * 10 + dig(d[3]);
-        r.patch  = dig(d[4]);
-        r.series = { char(d[5]), char(d[6]), char(d[7]) };
-        r.code   = { char(d[8]), char(d[9]) };
+static const char* HEADLESS_USAGE =
+    "usage: tr3xm_lan --ip ADDR [--port 9004] [--config FILE] [--reader-id 0]\n"
+    "                 [--antennas 1] [--buzzer off|each|tag] [--timeout-ms 2000] [--rounds 0]\n"
+    "                 [--format ndjson|csv|binary] [--output -|FILE] [--flush-bytes 65536] [--flush-ms 1000]\n"
+    "                 [--capture FILE] [--metrics FILE] [--metrics-interval-s 10]\n"
+    "                 [--store DIR] [--store-keep 0]\n"
+    "                 [--export file:PATH|unix:PATH|tcp:HOST:PORT|udp:HOST:PORT] [--export-format ndjson|csv|binary]\n"
+    "                 [--export-policy drop-newest|drop-oldest|block] [--export-rotate-mb 64] [--export-keep 5]\n"
+    "                 [--log-level frame|debug|info|warn|error|off]\n";
+
+// ------------------------------------------------------------
+// 関数名 : set_headless_option
+// 概要   : キー（フラグ名から "--" を除いたもの）と値を opt に反映する
+// 例外   : 不明なキー／値なら std::invalid_argument
+// ------------------------------------------------------------
+static void set_headless_option(HeadlessOptions& opt, const std::string& key, const std::string& val) {
+    using namespace tr3;
+    auto bad = [&]() { return std::invalid_argument("invalid value for " + key + ": " + val); };
+    if      (key == "ip")          opt.ip = val;
+    else if (key == "port")        opt.port = static_cast<uint16_t>(std::stoi(val));
+    else if (key == "reader-id")   opt.reader_id = static_cast<uint32_t>(std::stoul(val));
+    else if (key == "antennas")    opt.antennas = std::max(1, std::min(256, std::stoi(val)));
+    else if (key == "timeout-ms")  opt.timeout_ms = std::max(1, std::stoi(val));
+    else if (key == "rounds")      opt.rounds = std::stoull(val);
+    else if (key == "output")      opt.output = val;
+    else if (key == "flush-bytes") opt.flush_bytes = static_cast<size_t>(std::stoull(val));
+    else if (key == "flush-ms")    opt.flush_ms = std::max(0, std::stoi(val));
+    else if (key == "capture")     opt.capture = val;
+    else if (key == "metrics")     opt.metrics = val;
+    else if (key == "metrics-interval-s") opt.metrics_interval_s = std::max(1, std::stoi(val));
+    else if (key == "store")       opt.store = val;
+    else if (key == "store-keep")  opt.store_keep = static_cast<size_t>(std::stoull(val));
+    else if (key == "export")      opt.export_uri = val;
+    else if (key == "export-rotate-mb") opt.export_rotate_mb = std::stoull(val);
+    else if (key == "export-keep") opt.export_keep = std::max(0, std::stoi(val));
+    else if (key == "buzzer") {
+        if      (val == "off")  opt.buzzer = BuzzerMode::OFF;
+        else if (val == "each") opt.buzzer = BuzzerMode::EACH;
+        else if (val == "tag")  opt.buzzer = BuzzerMode::ON_TAG;
+        else throw bad();
+    } else if (key == "format") {
+        auto f = parse_tag_format(val);
+        if (!f) throw bad();
+        opt.format = *f;
+    } else if (key == "export-format") {
+        auto f = parse_tag_format(val);
+        if (!f) throw bad();
+        opt.export_format = *f;
+    } else if (key == "export-policy") {
+        if (!parse_sink_policy(val, opt.export_policy)) throw bad();
+    } else if (key == "log-level") {
+        if (!log::parse_level(val, opt.log_level)) throw bad();
+    } else {
+        throw std::invalid_argument("unknown option: " + key);
     }
-    return r;
 }
 
-// ---------------------------------------------
-// Inventory ACK（タグ件数通知）
-//  フォーマット例：F0 NN
-// ---------------------------------------------
-static std::optional<int> parse_uid_count(const std::vector<uint8_t>& d) {
-    if (d.size() == 2 && d[0] == 0xF0) return (int)d[1];
-    return std::nullopt;
+// ------------------------------------------------------------
+// 関数名 : load_headless_config
+// 概要   : 「キー = 値」形式の設定ファイルを読む
+// 例外   : 開けない／書式不正で std::invalid_argument
+// ------------------------------------------------------------
+static void load_headless_config(HeadlessOptions& opt, const std::string& path) {
+    std::ifstream in(path);
+    if (!in) throw std::invalid_argument("cannot open config: " + path);
+    auto trim = [](std::string v) {
+        const auto b = v.find_first_not_of(" \t\r");
+        const auto e = v.find_last_not_of(" \t\r");
+        return b == std::string::npos ? std::string() : v.substr(b, e - b + 1);
+    };
+    std::string line;
+    for (int no = 1; std::getline(in, line); ++no) {
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) continue;
+        const auto eq = line.find('=');
+        if (eq == std::string::npos) {
+            throw std::invalid_argument(path + ":" + std::to_string(no) + ": expected key = value");
+        }
+        set_headless_option(opt, trim(line.substr(0, eq)), trim(line.substr(eq + 1)));
+    }
 }
 
-// ---------------------------------------------
-// Inventory タグ応答（1タグ）
-//  CMD=0x49, DATA= [DSFID][UID(8B)]
-// ---------------------------------------------
-struct TagInfo { uint8_t dsfid{}; std::array<uint8_t,8> uid; };
-
-static std::optional<TagInfo> parse_tag(uint8_t cmd, const std::vector<uint8_t>& d) {
-    if (cmd != 0x49 || d.size() != 9) return std::nullopt;
-    TagInfo t;
-    t.dsfid = d[0];
-    for (int i = 0; i < 8; ++i) t.uid[i] = d[1 + i];
-    return t;
+// ------------------------------------------------------------
+// 関数名 : parse_headless_args
+// 概要   : --config を先に読み、残りのフラグで上書きする
+// ------------------------------------------------------------
+static HeadlessOptions parse_headless_args(int argc, char** argv) {
+    HeadlessOptions opt;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::string(argv[i]) == "--config") load_headless_config(opt, argv[i + 1]);
+    }
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        if (a.rfind("--", 0) != 0) throw std::invalid_argument("unexpected argument: " + a);
+        if (i + 1 >= argc) throw std::invalid_argument("missing value for " + a);
+        const std::string val = argv[++i];
+        if (a != "--config") set_headless_option(opt, a.substr(2), val);
+    }
+    return opt;
+}
+
+static std::atomic<bool> g_stop_requested{false};
+
+extern "C" void on_stop_signal(int) {
+    g_stop_requested.store(true);
+}
+
+// ------------------------------------------------------------
+// 関数名 : run_headless
+// 概要   : 常駐モード本体。停止されるまで（または rounds 巡）読み取り、タグを出力し続ける
+// 戻り値 : プロセスの終了コード（0 = 正常停止, 1 = 出力できない等, 2 = 引数不正）
+// 備考   : 対話版と同じく SupervisedClient（自動再接続）+ AntennaScheduler + CommandBatch。
+//          対話版と違いサイクル間で待たず、ログは非同期（標準エラー）で出す
+// ------------------------------------------------------------
+static int run_headless(int argc, char** argv) {
+    using namespace tr3;
+
+    HeadlessOptions opt;
+    try {
+        opt = parse_headless_args(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] " << e.what() << "\n" << HEADLESS_USAGE;
+        return 2;
+    }
+
+    log::set_output(stderr);
+    log::set_level(opt.log_level);
+
+    TagWriter out;
+    CaptureWriter capture;
+    std::unique_ptr<TagStore> store;
+    std::unique_ptr<TagExporter> exporter;   // 送り先が遅くても読取は待たない（満杯なら policy どおり捨てる）
+    try {
+        out.open(opt.output, opt.format, opt.flush_bytes, opt.flush_ms);
+        if (!opt.capture.empty()) capture.open(opt.capture);
+        if (!opt.store.empty()) {
+            TagStoreConfig stc;
+            stc.dir          = opt.store;
+            stc.max_segments = opt.store_keep;
+            store = std::make_unique<TagStore>(stc);
+        }
+        if (!opt.export_uri.empty()) {
+            ExportConfig ec;
+            ec.format = opt.export_format;
+            ec.policy = opt.export_policy;
+            exporter  = std::make_unique<TagExporter>(
+                make_sink(opt.export_uri, opt.export_rotate_mb << 20, opt.export_keep), ec);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] " << e.what() << "\n";
+        return 1;
+    }
+
+    SessionConfig sc;
+    sc.ip         = opt.ip;
+    sc.port       = opt.port;
+    sc.timeout_ms = opt.timeout_ms;
+    // リーダが止まっている間も読取ループへ戻り、出力のまとめ書きと統計ファイルを更新する
+    sc.connect_wait_ms = std::max(100, std::min(opt.flush_ms, 1000));
+    SupervisedClient sup(sc);
+    sup.on_status([&](const std::string& m) {
+        log::write(log::Level::INFO, "reader " + std::to_string(opt.reader_id) + " " + opt.ip + ":" +
+                                     std::to_string(opt.port) + ": " + m);
+    });
+    if (capture.is_open()) sup.client().set_capture(&capture, static_cast<uint16_t>(opt.reader_id));
+
+    // 停止シグナル → 再接続待ちも含めて止める（シグナルハンドラではフラグを立てるだけ）
+    std::signal(SIGINT,  on_stop_signal);
+    std::signal(SIGTERM, on_stop_signal);
+#ifndef _WIN32
+    // 読み手のいなくなったパイプへの書き込みは SIGPIPE で落とさず、TagWriterError（終了コード 1）にする
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+    std::atomic<bool> done{false};
+    std::thread watcher([&] {
+        while (!done.load()) {
+            if (g_stop_requested.load()) { sup.stop(); return; }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    });
+
+    const std::string labels = "reader=\"" + std::to_string(opt.reader_id) + "\"";
+    auto write_metrics = [&]() {
+        if (opt.metrics.empty()) return;
+        MetricsSnapshot ms;
+        sup.collect_metrics(ms, labels);
+        ms.counter("tr3_tags_written_total", "Tag records written to the output.", labels, out.records());
+        if (exporter) exporter->collect_metrics(ms, labels);
+        if (!write_file_atomic(opt.metrics, ms.to_prometheus())) {
+            log::write(log::Level::WARN, "cannot write metrics: " + opt.metrics);
+        }
+    };
+
+    SchedulerConfig plan = SchedulerConfig::uniform(opt.antennas);
+    plan.buzzer = opt.buzzer;
+    AntennaScheduler sched(plan);
+    const bool   buzz_each = plan.buzzer == BuzzerMode::EACH;
+    CommandBatch batch;
+    int          rc = 0;
+    auto         next_metrics = std::chrono::steady_clock::now();
+    uint64_t     ant_gen = 0;   // リーダのアンテナがスケジューラの想定どおりと分かっている接続の世代
+    std::vector<SupervisedClient::BatchReply> reps;   // 応答の入れ物（使い回す）
+
+    // 出力のまとめ書きの期限と統計ファイルの更新。読取1回ごと（失敗・再接続待ちの後も）に呼ぶ
+    auto housekeeping = [&]() {
+        const auto now = std::chrono::steady_clock::now();
+        out.poll(now);
+        if (now >= next_metrics) {
+            write_metrics();
+            next_metrics = now + std::chrono::seconds(opt.metrics_interval_s);
+        }
+    };
+
+    try {
+        for (uint64_t r = 0; (opt.rounds == 0 || r < opt.rounds) && !sup.stopped(); ++r) {
+            for (int k = 0; k < sched.round_length() && !sup.stopped(); ++k) {
+                auto slot = sched.next();
+                for (int d = 0; d < slot.dwell && !sup.stopped(); ) {
+                    try {
+                        // 前の呼び出しの中で再接続されていれば、アンテナは既定に戻っている
+                        if (sup.generation() != ant_gen) slot.switch_needed = true;
+                        batch.clear();
+                        if (slot.switch_needed) batch.add(catalog::switch_antenna(slot.antenna).frame());
+                        const size_t inv = batch.count();
+                        batch.add(catalog::INVENTORY2.frame());
+                        if (buzz_each) batch.add(catalog::BUZZER_ON.frame());
+
+                        sup.transact_batch(batch, reps);
+                        if (sup.generation() != ant_gen && !slot.switch_needed) {
+                            // 送信の直前に再接続された（切替なしで既定のアンテナを読んだ）→ 結果を捨てて切替から
+                            continue;
+                        }
+                        ant_gen = sup.generation();
+                        if (slot.switch_needed && !reply_as<catalog::SwitchAnt>(reps[0].reply.cmd, reps[0].reply.data)) {
+                            // 切替を拒否された（NACK など）→ 前のアンテナのまま読んだ結果なので捨て、次の回で切り替え直す
+                            log::write(log::Level::WARN, "ANT#" + std::to_string(slot.antenna) + ": antenna switch rejected");
+                            ++d;
+                            housekeeping();
+                            continue;
+                        }
+                        slot.switch_needed = false;
+
+                        const auto now = std::chrono::system_clock::now();
+                        int got = 0;
+                        for (const auto& t : reps[inv].tags) {
+                            const Response res = decode_reply(t.cmd, t.data);
+                            if (const auto* tag = std::get_if<TagInfo>(&res)) {
+                                const TagRecord rec = TagRecord::make(opt.reader_id, slot.antenna, *tag, now);
+                                out.write(rec);
+                                if (store) store->append(rec);
+                                if (exporter) exporter->publish(rec);
+                                ++got;
+                            }
+                        }
+                        sched.report(slot.antenna, got);
+                        if (!buzz_each && sched.want_buzzer(got)) sup.transact(catalog::BUZZER_ON.frame());
+                        ++d;
+                    } catch (const NetError& e) {
+                        if (sup.stopped()) break;
+                        if (!sup.connected()) slot.switch_needed = true;
+                        // 再接続待ちの間は接続失敗が on_status で出るので、ここでは繰り返さない
+                        log::write(sup.connected() ? log::Level::WARN : log::Level::DEBUG,
+                                   std::string("ANT#") + std::to_string(slot.antenna) + ": " + e.what());
+                    }
+                    // リーダが止まって同じ滞在をやり直し続けている間も、出力と統計は遅らせない
+                    housekeeping();
+                }
+            }
+        }
+    } catch (const TagWriterError& e) {
+        // 出力先が使えない（パイプ切断・ディスクフルなど）→ 異常終了させて監視側に再起動させる
+        log::write(log::Level::ERR, e.what());
+        rc = 1;
+    } catch (const TagStoreError& e) {
+        log::write(log::Level::ERR, e.what());
+        rc = 1;
+    }
+
+    done = true;
+    watcher.join();
+    try { out.close(); } catch (const TagWriterError& e) { log::write(log::Level::ERR, e.what()); rc = 1; }
+    try { if (store) store->seal(); } catch (const TagStoreError& e) { log::write(log::Level::ERR, e.what()); rc = 1; }
+    if (exporter) {
+        exporter->stop();
+        if (exporter->pending_bytes() || exporter->dropped()) {
+            log::write(log::Level::WARN, "export " + exporter->sink().describe() + ": " +
+                                         std::to_string(exporter->dropped()) + " tags dropped, " +
+                                         std::to_string(exporter->pending_bytes()) + " bytes not sent");
+        }
+    }
+    write_metrics();
+    sup.client().close();
+    log::write(log::Level::INFO, "stopped: " + std::to_string(out.records()) + " tags written");
+    log::flush();
+    return rc;
 }
 
 // ------------------------------------------------------------
@@ -126,9 +434,20 @@ static std::optional<TagInfo> parse_tag(uint8_t cmd, const std::vector<uint8_t>&
 int main(int argc, char** argv) {
     using namespace tr3;
 
+    // 常駐モード（フラグ指定）。対話版の引数（読取回数・キャプチャファイル名）は "--" で始まらない
+    if (argc >= 2 && std::string(argv[1]).rfind("--", 0) == 0) {
+        return run_headless(argc, argv);
+    }
+
     try {
+#ifdef _WIN32
         // コンソール出力をUTF-8に（日本語ログの文字化け防止）
         SetConsoleOutputCP(CP_UTF8);
+#endif
+
+        // 対話版は送受信フレームを表示する。案内表示と順序が入れ替わらないよう同期出力にする
+        log::set_level(log::Level::FRAME);
+        log::set_synchronous(true);
 
         // ---- 設定ファイルから前回値を復元 ----
         std::string ip   = "192.168.0.2";
@@ -149,23 +468,31 @@ int main(int argc, char** argv) {
         // ---- 設定の保存（次回の既定値）----
         { std::ofstream cfgOut("config.txt"); cfgOut << ip << "\n" << port; }
 
-        // ---- 接続 ----
+        // ---- 接続（切断時は自動再接続。接続のたびに ROM確認 → コマンドモード設定）----
+        SessionConfig sc;
+        sc.ip         = ip;
+        sc.port       = static_cast<uint16_t>(port);
+        sc.timeout_ms = 5000;
+        SupervisedClient sup(sc);
+        sup.on_status([](const std::string& m) { std::cout << now_str() << "  [LOG]   " << m << "\n"; });
+
+        // ---- キャプチャ（任意：第2引数。接続時の ROM確認から記録する）----
+        CaptureWriter capture;
+        if (argc >= 3) {
+            capture.open(argv[2]);
+            sup.client().set_capture(&capture);
+            std::cout << "[LOG] キャプチャ出力: " << argv[2] << "\n";
+        }
+
         std::cout << "[接続中] " << ip << ":" << port << "\n";
-        Client cli;
-        cli.connect(ip, static_cast<uint16_t>(port), /*timeout_ms*/ 5000);
+        std::cout << now_str() << "  [cmt]   /* ROMバージョンの読み取り・コマンドモード設定 */\n";
+        sup.ensure_connected();
         std::cout << "[LOG] 接続成功\n";
 
-        // ---- ROMバージョン読み取り ----
-        std::cout << now_str() << "  [cmt]   /* ROMバージョンの読み取り */\n";
-        auto rep0 = cli.transact(cmd::check_rom_version());
-        RomInfo info = parse_rom(rep0.data);
-        std::cout << now_str() << "  [cmt]   ROMバージョン : "
-                  << info.major << "." << std::setw(2) << std::setfill('0') << info.minor
-                  << "." << info.patch << " " << info.series << info.code << "\n";
-
-        // ---- コマンドモード設定 ----
-        std::cout << now_str() << "  [cmt]   /* コマンドモード設定 */\n";
-        cli.transact(cmd::set_command_mode());
+        // ---- ROMバージョン（接続時の setup 応答の1つ目）----
+        const auto& romRep = sup.setup_replies().front();
+        const RomInfo info = reply_as<catalog::RomVersion>(romRep.cmd, romRep.data).value_or(RomInfo{});
+        std::cout << now_str() << "  [cmt]   ROMバージョン : " << info.to_string() << "\n";
 
         // ---- 読取回数・アンテナ数 ----
         //  既定値：reads は「引数 argv[1] があればそれを採用（1未満なら1）」→ その後プロンプトで最終決定
@@ -179,52 +506,120 @@ int main(int argc, char** argv) {
         std::getline(std::cin, s);
         if (!s.empty()) reads = std::stoi(s);
 
-        std::cout << "接続アンテナ数を入力してください（最大3）：";
+        std::cout << "接続アンテナ数を入力してください（Enterで 1）：";
         std::getline(std::cin, s);
         int ants = 1;
-        if (!s.empty()) ants = std::max(1, std::min(3, std::stoi(s)));
+        if (!s.empty()) ants = std::max(1, std::min(256, std::stoi(s)));   // ANT#0〜#255
 
-        // ---- 読取ループ（読取回数 × アンテナ数）----
+        std::cout << "ブザー（1=毎回 / 2=タグ読取時のみ / 0=鳴らさない、Enterで 1）：";
+        std::getline(std::cin, s);
+        SchedulerConfig plan = SchedulerConfig::uniform(ants);
+        plan.buzzer = s == "0" ? BuzzerMode::OFF : s == "2" ? BuzzerMode::ON_TAG : BuzzerMode::EACH;
+        AntennaScheduler sched(plan);   // タグなしが続くアンテナは番を飛ばす
+
+        // ---- 読取ループ（読取回数 × 1巡）----
+        //  1巡 = スケジューラが決める round_length() 回の選択（均等設定ならアンテナ数）
+        //  送信フレームはコマンド一覧（catalog）で組み立てる（アンテナ切替以外はコンパイル時に組み立て済み）
+        //  1回の Inventory2 ぶんのコマンドは CommandBatch にまとめて送る（バッファは使い回す）
+        CommandBatch batch;
+        TagStore     store;   // 読み取ったタグを UID ごとに集計（終了時に一覧を表示）
+        const bool   buzz_each = plan.buzzer == BuzzerMode::EACH;
+        uint64_t     ant_gen = 0;   // リーダのアンテナがスケジューラの想定どおりと分かっている接続の世代
+        std::vector<SupervisedClient::BatchReply> reps;   // 応答の入れ物（使い回す）
         for (int i = 0; i < reads; ++i) {
             std::cout << "\n-- 読取 " << (i + 1) << "/" << reads << " --\n";
 
-            for (int a = 0; a < ants; ++a) {
-                // アンテナ切替
-                std::cout << "[アンテナ切替] ANT#" << a << "\n";
-                cli.transact(cmd::switch_antenna(static_cast<uint8_t>(a)));
-
-                // Inventory2（タグ探索）
-                std::cout << now_str() << "  [cmt]   /* Inventory2 */\n";
-                auto repI = cli.transact(cmd::inventory2());
-
-                // 先頭応答で UID 数を把握（ACK：F0 NN）
-                if (auto n = parse_uid_count(repI.data)) {
-                    std::cout << now_str() << "  [cmt]   UID数 : " << *n << "\n";
-
-                    // 続くタグ応答（*n 件）を逐次受信・表示
-                    for (int k = 0; k < *n; ++k) {
-                        auto repTag = cli.receive_only();
-                        if (auto t = parse_tag(repTag.cmd, repTag.data)) {
-                            // DSFID
-                            std::cout << now_str() << "  [cmt]   DSFID : "
-                                      << std::hex << std::uppercase
-                                      << std::setw(2) << std::setfill('0') << (int)t->dsfid
-                                      << std::dec << "\n";
-                            // UID（LSB→MSB を表示順にMSB→LSBへ並べ替え）
-                            std::vector<uint8_t> uid(t->uid.begin(), t->uid.end());
-                            std::reverse(uid.begin(), uid.end());
-                            std::cout << now_str() << "  [cmt]   UID   : " << hex_str(uid) << "\n";
+            for (int k = 0; k < sched.round_length(); ++k) {
+                auto slot = sched.next();
+                for (int d = 0; d < slot.dwell; ) {
+                    try {
+                        // アンテナ切替（直前と同じアンテナなら省略）・Inventory2・ブザー（毎回鳴らす設定のとき）を
+                        // 1回の送信にまとめる。応答は送信順に返る。
+                        // 前の呼び出しの中で再接続されていれば、アンテナは既定に戻っているので切り替え直す
+                        if (sup.generation() != ant_gen) slot.switch_needed = true;
+                        batch.clear();
+                        if (slot.switch_needed) {
+                            std::cout << "[アンテナ切替] ANT#" << int(slot.antenna) << "\n";
+                            batch.add(catalog::switch_antenna(slot.antenna).frame());
                         }
+                        std::cout << now_str() << "  [cmt]   /* Inventory2 */\n";
+                        const size_t inv = batch.count();
+                        batch.add(catalog::INVENTORY2.frame());
+                        if (buzz_each) batch.add(catalog::BUZZER_ON.frame());
+
+                        sup.transact_batch(batch, reps);
+                        if (sup.generation() != ant_gen && !slot.switch_needed) {
+                            // 送信の直前に再接続された（切替なしで既定のアンテナを読んだ）→ 結果を捨てて切替から
+                            std::cout << now_str() << "  [WARN]  再接続 → ANT#" << int(slot.antenna) << " へ切り替え直し\n";
+                            continue;
+                        }
+                        ant_gen = sup.generation();
+                        if (slot.switch_needed && !reply_as<catalog::SwitchAnt>(reps[0].reply.cmd, reps[0].reply.data)) {
+                            // 切替を拒否された（NACK など）→ 前のアンテナのまま読んだ結果なので捨て、次の回で切り替え直す
+                            std::cout << now_str() << "  [WARN]  ANT#" << int(slot.antenna) << " への切替が拒否されました\n";
+                            ++d;
+                            continue;
+                        }
+                        slot.switch_needed = false;
+                        const auto& repI = reps[inv];
+
+                        // 先頭応答で UID 数を把握（ACK：F0 NN）。続くタグ応答は repI.tags に届いている
+                        int got = 0;
+                        if (auto ack = reply_as<catalog::Inventory2>(repI.reply.cmd, repI.reply.data)) {
+                            std::cout << now_str() << "  [cmt]   UID数 : " << int(ack->count) << "\n";
+
+                            for (const auto& repTag : repI.tags) {
+                                const Response res = decode_reply(repTag.cmd, repTag.data);
+                                if (const auto* t = std::get_if<TagInfo>(&res)) {
+                                    ++got;
+                                    store.append(TagRecord::make(0, slot.antenna, *t, std::chrono::system_clock::now()));
+                                    // DSFID
+                                    std::cout << now_str() << "  [cmt]   DSFID : "
+                                              << std::hex << std::uppercase
+                                              << std::setw(2) << std::setfill('0') << (int)t->dsfid
+                                              << std::dec << "\n";
+                                    // UID（LSB→MSB を表示順にMSB→LSBへ並べ替え）
+                                    std::vector<uint8_t> uid(t->uid.begin(), t->uid.end());
+                                    std::reverse(uid.begin(), uid.end());
+                                    std::cout << now_str() << "  [cmt]   UID   : " << hex_str(uid) << "\n";
+                                }
+                            }
+                        }
+                        sched.report(slot.antenna, got);
+
+                        // タグが読めたときだけ鳴らす設定は、結果を見てから別に送る
+                        if (!buzz_each && sched.want_buzzer(got)) sup.transact(catalog::BUZZER_ON.frame());
+                        ++d;
+                    } catch (const NetError& e) {
+                        // 同じアンテナからやり直す（切断なら次の transact で再接続・再設定されるので切替から）
+                        if (!sup.connected()) slot.switch_needed = true;
+                        std::cout << now_str() << "  [WARN]  " << e.what() << " → ANT#" << int(slot.antenna) << " から再開\n";
                     }
                 }
+            }
+        }
 
-                // 読み取りごとにブザーを鳴らす（任意演出）
-                cli.transact(cmd::buzzer(0x01));
+        // ---- 読取結果（UID ごとの読取回数・最後に読めたアンテナ。最初に読めた順）----
+        {
+            auto seen = store.seen_between(INT64_MIN, INT64_MAX);
+            std::sort(seen.begin(), seen.end(), [](const auto& a, const auto& b) { return a.first_us < b.first_us; });
+            std::cout << "\n[読取結果] " << seen.size() << " タグ / " << store.rows() << " 回\n";
+            for (const auto& e : seen) {
+                std::vector<uint8_t> uid(8);
+                for (int b = 0; b < 8; ++b) uid[b] = static_cast<uint8_t>(e.uid >> (8 * (7 - b)));   // MSB→LSB
+                std::cout << "  UID " << hex_str(uid) << "  " << e.reads << " 回  最終 ANT#" << int(e.antenna) << "\n";
             }
         }
 
+        // ---- 通信の統計（送受信数・再送・タイムアウト・所要時間）----
+        {
+            MetricsSnapshot ms;
+            sup.collect_metrics(ms);
+            std::cout << "\n[統計]\n" << ms.to_text();
+        }
+
         // ---- 切断 ----
-        cli.close();
+        sup.client().close();
         std::cout << "[終了] 接続を閉じました\n";
 
         // ---- 終了待機（ログ確認用）----
@@ -0,0 +1,244 @@
+// =============================================
+// src/metrics.cpp
+// TR3シリーズ - 計測値の集計と出力（テキスト / Prometheus）
+//
+//  - ヒストグラムのバケット番号：v の最上位ビット位置 msb から
+//    shift = msb - 4、番号 = (shift + 1) · 16 + (v >> shift) − 16
+//    （0〜15 はそのまま。番号が増えるほど値も単調に増える）
+//  - Prometheus の le はバケットをそのまま出すと 500 行を超えるので、
+//    2 のべき乗の境界（16, 32, 64, … 未満）でまとめて累積件数を出す
+// =============================================
+
+#include "tr3/metrics.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <sstream>
+
+#ifdef _WIN32
+#  ifndef NOMINMAX
+#    define NOMINMAX 1
+#  endif
+#  include <windows.h>
+#  include <intrin.h>
+#  include <io.h>          // _commit / _fileno
+#else
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+namespace tr3 {
+
+namespace {
+
+// 最上位ビットの位置（v > 0）
+int msb64(uint64_t v) {
+#if defined(_MSC_VER)
+    unsigned long i;
+    _BitScanReverse64(&i, v);
+    return static_cast<int>(i);
+#else
+    return 63 - __builtin_clzll(v);
+#endif
+}
+
+std::string fmt_double(double v, const char* f = "%.9g") {
+    char b[48];
+    std::snprintf(b, sizeof(b), f, v);
+    return b;
+}
+
+// "name{labels}" / "name{labels,extra}"
+std::string series(const std::string& name, const std::string& labels, const std::string& extra = "") {
+    std::string s = name;
+    if (labels.empty() && extra.empty()) return s;
+    s += '{';
+    s += labels;
+    if (!labels.empty() && !extra.empty()) s += ',';
+    s += extra;
+    s += '}';
+    return s;
+}
+
+} // namespace
+
+// ------------------------------------------------------------
+// Histogram
+// ------------------------------------------------------------
+size_t Histogram::index_of(uint64_t v) {
+    if (v < SUB) return static_cast<size_t>(v);
+    const int msb = msb64(v);
+    if (msb > MAX_MSB) return BUCKETS - 1;
+    const int shift = msb - SUB_BITS;
+    return static_cast<size_t>(shift + 1) * SUB + static_cast<size_t>((v >> shift) - SUB);
+}
+
+uint64_t Histogram::lower_bound(size_t index) {
+    if (index < SUB) return index;
+    const size_t shift = index / SUB - 1;
+    return static_cast<uint64_t>(SUB + index % SUB) << shift;
+}
+
+uint64_t Histogram::upper_bound(size_t index) {
+    if (index < SUB) return index + 1;
+    return lower_bound(index) + (uint64_t{1} << (index / SUB - 1));
+}
+
+HistogramSnapshot Histogram::snapshot() const {
+    HistogramSnapshot s;
+    s.counts.resize(BUCKETS);
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        s.counts[i] = counts_[i].load(std::memory_order_relaxed);
+        s.count += s.counts[i];   // 書き込みと並行でもバケットの合計と食い違わないように数え直す
+    }
+    s.sum = sum_.load(std::memory_order_relaxed);
+    s.max = max_.load(std::memory_order_relaxed);
+    return s;
+}
+
+uint64_t HistogramSnapshot::percentile(double q) const {
+    if (count == 0) return 0;
+    if (q < 0.0) q = 0.0;
+    if (q > 1.0) q = 1.0;
+    uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count) + 0.5);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            const uint64_t hi = Histogram::upper_bound(i) - 1;
+            return hi < max ? hi : max;
+        }
+    }
+    return max;
+}
+
+// ------------------------------------------------------------
+// MetricsSnapshot
+// ------------------------------------------------------------
+void MetricsSnapshot::counter(const std::string& name, const std::string& help,
+                              const std::string& labels, uint64_t value) {
+    counters_.push_back(CounterItem{ name, help, labels, value });
+}
+
+void MetricsSnapshot::histogram(const std::string& name, const std::string& help, const std::string& labels,
+                                const HistogramSnapshot& h, double unit_seconds) {
+    histograms_.push_back(HistogramItem{ name, help, labels, h, unit_seconds });
+}
+
+std::string MetricsSnapshot::to_text() const {
+    std::ostringstream o;
+    for (const auto& c : counters_) {
+        o << series(c.name, c.labels) << " " << c.value << "\n";
+    }
+    for (const auto& h : histograms_) {
+        const double ms = h.unit * 1000.0;
+        o << series(h.name, h.labels) << " count=" << h.h.count;
+        if (h.h.count) {
+            o << " mean="  << fmt_double(h.h.mean() * ms, "%.3f")
+              << "ms p50=" << fmt_double(static_cast<double>(h.h.percentile(0.50)) * ms, "%.3f")
+              << "ms p90=" << fmt_double(static_cast<double>(h.h.percentile(0.90)) * ms, "%.3f")
+              << "ms p99=" << fmt_double(static_cast<double>(h.h.percentile(0.99)) * ms, "%.3f")
+              << "ms max=" << fmt_double(static_cast<double>(h.h.max) * ms, "%.3f") << "ms";
+        }
+        o << "\n";
+    }
+    return o.str();
+}
+
+// ------------------------------------------------------------
+// 関数名 : to_prometheus
+// 概要   : text exposition format 0.0.4。同じ name は最初に現れた位置でまとめ、
+//          # HELP / # TYPE を1回だけ出す
+// ------------------------------------------------------------
+std::string MetricsSnapshot::to_prometheus() const {
+    std::ostringstream o;
+
+    std::vector<bool> done(counters_.size(), false);
+    for (size_t i = 0; i < counters_.size(); ++i) {
+        if (done[i]) continue;
+        const auto& name = counters_[i].name;
+        o << "# HELP " << name << " " << counters_[i].help << "\n"
+          << "# TYPE " << name << " counter\n";
+        for (size_t j = i; j < counters_.size(); ++j) {
+            if (done[j] || counters_[j].name != name) continue;
+            done[j] = true;
+            o << series(name, counters_[j].labels) << " " << counters_[j].value << "\n";
+        }
+    }
+
+    std::vector<bool> hdone(histograms_.size(), false);
+    for (size_t i = 0; i < histograms_.size(); ++i) {
+        if (hdone[i]) continue;
+        const auto& name = histograms_[i].name;
+        o << "# HELP " << name << " " << histograms_[i].help << "\n"
+          << "# TYPE " << name << " histogram\n";
+        for (size_t j = i; j < histograms_.size(); ++j) {
+            if (hdone[j] || histograms_[j].name != name) continue;
+            hdone[j] = true;
+            const auto& it = histograms_[j];
+
+            // 2 のべき乗の境界ごとに累積件数（max を含む境界まで）
+            uint64_t cum = 0;
+            size_t   b   = 0;
+            for (int k = Histogram::SUB_BITS; k <= Histogram::MAX_MSB + 1; ++k) {
+                const uint64_t edge = uint64_t{1} << k;
+                while (b < it.h.counts.size() && Histogram::upper_bound(b) <= edge) cum += it.h.counts[b++];
+                // 値は整数なので「edge 未満」=「edge - 1 以下」
+                o << series(name + "_bucket", it.labels,
+                            "le=\"" + fmt_double(static_cast<double>(edge - 1) * it.unit) + "\"")
+                  << " " << cum << "\n";
+                if (edge > it.h.max) break;
+            }
+            o << series(name + "_bucket", it.labels, "le=\"+Inf\"") << " " << it.h.count << "\n"
+              << series(name + "_sum", it.labels) << " " << fmt_double(static_cast<double>(it.h.sum) * it.unit) << "\n"
+              << series(name + "_count", it.labels) << " " << it.h.count << "\n";
+        }
+    }
+    return o.str();
+}
+
+// ------------------------------------------------------------
+// 関数名 : write_file_atomic
+// 備考   : 一時ファイルは書き込み・close の結果まで確認し、ディスクへ同期（fsync）してから
+//          置き換える（ディスクが一杯・電源断のあとに、途中までの／空のファイルが
+//          正しい名前で見えないように）。失敗したら一時ファイルを消す
+// ------------------------------------------------------------
+bool write_file_atomic(const std::string& path, const std::string& content) {
+    const std::string tmp = path + ".tmp";
+#ifdef _WIN32
+    std::FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+    bool ok = std::fwrite(content.data(), 1, content.size(), f) == content.size() &&
+              std::fflush(f) == 0 && _commit(_fileno(f)) == 0;
+    ok = std::fclose(f) == 0 && ok;
+    if (ok) ok = MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    bool ok = true;
+    for (size_t off = 0; ok && off < content.size();) {
+        const ssize_t n = ::write(fd, content.data() + off, content.size() - off);
+        if (n > 0)                      off += static_cast<size_t>(n);
+        else if (n < 0 && errno == EINTR) continue;
+        else                            ok = false;
+    }
+    ok = ok && ::fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    if (ok) ok = std::rename(tmp.c_str(), path.c_str()) == 0;
+    if (ok) {
+        // rename 自体も残るよう、ディレクトリも同期する（失敗しても置き換えは済んでいる）
+        const auto slash = path.find_last_of('/');
+        const std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+        const int dfd = ::open(dir.c_str(), O_RDONLY | O_CLOEXEC);
+        if (dfd >= 0) {
+            ::fsync(dfd);
+            ::close(dfd);
+        }
+    }
+#endif
+    if (!ok) std::remove(tmp.c_str());
+    return ok;
+}
+
+} // namespace tr3
@@ -0,0 +1,427 @@
+// =============================================
+// src/net.cpp
+// TR3シリーズ - ソケット層実装（Windows / POSIX）
+//
+// 役割：
+//  - OS差分（WinSock / BSDソケット）をここに閉じ込める
+//  - Client 側は「ノンブロッキング + poll 待ち」の共通インターフェースだけを使う
+// =============================================
+
+#include "tr3/net.hpp"
+
+#include <chrono>
+#include <string>
+
+#ifdef _WIN32
+#  include <mstcpip.h>   // SIO_KEEPALIVE_VALS
+#else
+#  include <sys/types.h>
+#  include <sys/socket.h>
+#  include <netinet/in.h>
+#  include <netinet/tcp.h>
+#  include <arpa/inet.h>
+#  include <sys/un.h>
+#  include <poll.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <cerrno>
+#  include <cstring>
+#endif
+
+namespace tr3 {
+namespace net {
+
+namespace {
+
+#ifdef _WIN32
+using pollfd_t = WSAPOLLFD;
+inline int os_poll(pollfd_t* fds, unsigned long n, int timeout_ms) { return WSAPoll(fds, n, timeout_ms); }
+inline int last_error() { return WSAGetLastError(); }
+inline bool would_block(int e) { return e == WSAEWOULDBLOCK; }
+inline bool interrupted(int e) { return e == WSAEINTR; }
+constexpr int SEND_FLAGS = 0;
+#else
+using pollfd_t = pollfd;
+inline int os_poll(pollfd_t* fds, unsigned long n, int timeout_ms) { return ::poll(fds, static_cast<nfds_t>(n), timeout_ms); }
+inline int last_error() { return errno; }
+inline bool would_block(int e) { return e == EAGAIN || e == EWOULDBLOCK || e == EINPROGRESS; }
+inline bool interrupted(int e) { return e == EINTR; }
+#  ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;   // 切断済みソケットへの send で SIGPIPE を出さない
+#  else
+constexpr int SEND_FLAGS = 0;
+#  endif
+#endif
+
+// ------------------------------------------------------------
+// 関数名 : wait_event
+// 概要   : 単一ソケットに対する poll。EINTR は残り時間で再試行する
+// 戻り値 : 発生イベント（revents。エラー/切断も含む）。0 = タイムアウト
+// ------------------------------------------------------------
+short wait_event(socket_t s, short events, int timeout_ms) {
+    using clock = std::chrono::steady_clock;
+    const auto deadline = clock::now() + std::chrono::milliseconds(timeout_ms < 0 ? 0 : timeout_ms);
+    for (;;) {
+        pollfd_t pfd{};
+        pfd.fd     = s;
+        pfd.events = events;
+
+        int wait = timeout_ms;
+        if (timeout_ms >= 0) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clock::now()).count();
+            wait = left > 0 ? static_cast<int>(left) : 0;
+        }
+
+        const int r = os_poll(&pfd, 1, wait);
+        if (r > 0)  return pfd.revents ? pfd.revents : events;
+        if (r == 0) return 0;
+        if (!interrupted(last_error())) throw NetError("poll() failed");
+    }
+}
+
+} // namespace
+
+// ------------------------------------------------------------
+// startup / cleanup
+// ------------------------------------------------------------
+void startup() {
+#ifdef _WIN32
+    WSADATA wsa{};
+    if (WSAStartup(MAKEWORD(2,2), &wsa) != 0) {
+        throw NetError("WSAStartup failed");
+    }
+#endif
+}
+
+void cleanup() {
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+// ------------------------------------------------------------
+// ソケットオプション
+// ------------------------------------------------------------
+void set_nonblocking(socket_t s) {
+#ifdef _WIN32
+    u_long on = 1;
+    if (ioctlsocket(s, FIONBIO, &on) == SOCKET_ERROR) throw NetError("ioctlsocket(FIONBIO) failed");
+#else
+    const int fl = fcntl(s, F_GETFL, 0);
+    if (fl < 0 || fcntl(s, F_SETFL, fl | O_NONBLOCK) < 0) throw NetError("fcntl(O_NONBLOCK) failed");
+#endif
+}
+
+void set_nodelay(socket_t s) {
+    int on = 1;
+    if (setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&on), sizeof(on)) != 0) {
+        throw NetError("setsockopt(TCP_NODELAY) failed");
+    }
+}
+
+void set_keepalive(socket_t s, int idle_s, int interval_s, int count) {
+#ifdef _WIN32
+    // Windows は回数を指定できない（OS 既定の 10 回）
+    (void)count;
+    tcp_keepalive ka{};
+    ka.onoff             = 1;
+    ka.keepalivetime     = static_cast<ULONG>(idle_s) * 1000;
+    ka.keepaliveinterval = static_cast<ULONG>(interval_s) * 1000;
+    DWORD ret = 0;
+    if (WSAIoctl(s, SIO_KEEPALIVE_VALS, &ka, sizeof(ka), nullptr, 0, &ret, nullptr, nullptr) != 0) {
+        throw NetError("WSAIoctl(SIO_KEEPALIVE_VALS) failed");
+    }
+#else
+    int on = 1;
+    if (setsockopt(s, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on)) != 0) {
+        throw NetError("setsockopt(SO_KEEPALIVE) failed");
+    }
+#  if defined(TCP_KEEPIDLE)
+    setsockopt(s, IPPROTO_TCP, TCP_KEEPIDLE, &idle_s, sizeof(idle_s));
+#  elif defined(TCP_KEEPALIVE)
+    setsockopt(s, IPPROTO_TCP, TCP_KEEPALIVE, &idle_s, sizeof(idle_s));    // macOS
+#  endif
+#  ifdef TCP_KEEPINTVL
+    setsockopt(s, IPPROTO_TCP, TCP_KEEPINTVL, &interval_s, sizeof(interval_s));
+#  endif
+#  ifdef TCP_KEEPCNT
+    setsockopt(s, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
+#  endif
+#endif
+}
+
+void close_socket(socket_t& s) {
+    if (s == INVALID_SOCK) return;
+#ifdef _WIN32
+    ::closesocket(s);
+#else
+    ::close(s);
+#endif
+    s = INVALID_SOCK;
+}
+
+// ------------------------------------------------------------
+// 関数名 : connect_start
+// 挙動   : ソケット生成 → ノンブロッキング化 → connect()（完了を待たない）
+// ------------------------------------------------------------
+socket_t connect_start(const std::string& ip, uint16_t port) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons(port);
+    if (inet_pton(AF_INET, ip.c_str(), &addr.sin_addr) != 1) {
+        throw NetError("inet_pton failed");
+    }
+
+    socket_t s = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == INVALID_SOCK) {
+        throw NetError("socket() failed");
+    }
+
+    try {
+        set_nonblocking(s);
+        if (::connect(s, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 &&
+            !would_block(last_error())) {
+            throw NetError("connect() failed");
+        }
+    } catch (...) {
+        close_socket(s);
+        throw;
+    }
+    return s;
+}
+
+// ------------------------------------------------------------
+// 関数名 : connect_finish
+// 挙動   : SO_ERROR で接続結果を確認し、TCP_NODELAY を設定
+// ------------------------------------------------------------
+void connect_finish(socket_t s) {
+    int err = 0;
+#ifdef _WIN32
+    int len = sizeof(err);
+#else
+    socklen_t len = sizeof(err);
+#endif
+    if (getsockopt(s, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&err), &len) != 0 || err != 0) {
+        throw NetError("connect() failed");
+    }
+    set_nodelay(s);
+}
+
+// ------------------------------------------------------------
+// 関数名 : connect_tcp
+// 挙動   :
+//   1) connect_start（ソケット生成・ノンブロッキング化・connect）
+//   2) 書込可能になるまで poll で待つ
+//   3) connect_finish（SO_ERROR 確認・TCP_NODELAY 設定）
+// ------------------------------------------------------------
+socket_t connect_tcp(const std::string& ip, uint16_t port, int timeout_ms) {
+    socket_t s = connect_start(ip, port);
+    try {
+        if (!wait_writable(s, timeout_ms)) throw NetError("connect() timeout");
+        connect_finish(s);
+    } catch (...) {
+        close_socket(s);
+        throw;
+    }
+    return s;
+}
+
+// ------------------------------------------------------------
+// 関数名 : connect_unix
+// 挙動   : connect_tcp と同じ手順（Unix ドメインなので TCP_NODELAY は設定しない）
+// ------------------------------------------------------------
+socket_t connect_unix(const std::string& path, int timeout_ms) {
+#ifdef _WIN32
+    (void)path;
+    (void)timeout_ms;
+    throw NetError("unix domain sockets are not supported on this platform");
+#else
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) throw NetError("unix socket path too long");
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    socket_t s = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s == INVALID_SOCK) throw NetError("socket() failed");
+    try {
+        set_nonblocking(s);
+        if (::connect(s, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+            if (!would_block(last_error())) throw NetError("connect() failed");
+            if (!wait_writable(s, timeout_ms)) throw NetError("connect() timeout");
+            int err = 0;
+            socklen_t len = sizeof(err);
+            if (getsockopt(s, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0) throw NetError("connect() failed");
+        }
+    } catch (...) {
+        close_socket(s);
+        throw;
+    }
+    return s;
+#endif
+}
+
+// ------------------------------------------------------------
+// 関数名 : connect_udp
+// ------------------------------------------------------------
+socket_t connect_udp(const std::string& ip, uint16_t port) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons(port);
+    if (inet_pton(AF_INET, ip.c_str(), &addr.sin_addr) != 1) {
+        throw NetError("inet_pton failed");
+    }
+
+    socket_t s = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == INVALID_SOCK) {
+        throw NetError("socket() failed");
+    }
+    try {
+        set_nonblocking(s);
+        if (::connect(s, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) throw NetError("connect() failed");
+    } catch (...) {
+        close_socket(s);
+        throw;
+    }
+    return s;
+}
+
+// ------------------------------------------------------------
+// 関数名 : listen_tcp
+// ------------------------------------------------------------
+socket_t listen_tcp(const std::string& ip, uint16_t port, int backlog) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons(port);
+    if (inet_pton(AF_INET, ip.c_str(), &addr.sin_addr) != 1) {
+        throw NetError("inet_pton failed");
+    }
+
+    socket_t s = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == INVALID_SOCK) {
+        throw NetError("socket() failed");
+    }
+    try {
+        int on = 1;
+        setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&on), sizeof(on));
+        if (::bind(s, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) throw NetError("bind() failed");
+        if (::listen(s, backlog) != 0) throw NetError("listen() failed");
+        set_nonblocking(s);
+    } catch (...) {
+        close_socket(s);
+        throw;
+    }
+    return s;
+}
+
+// ------------------------------------------------------------
+// 関数名 : accept_tcp
+// ------------------------------------------------------------
+socket_t accept_tcp(socket_t listener, int timeout_ms) {
+    for (;;) {
+        if (!wait_readable(listener, timeout_ms)) return INVALID_SOCK;
+        socket_t c = ::accept(listener, nullptr, nullptr);
+        if (c == INVALID_SOCK) {
+            const int e = last_error();
+            if (interrupted(e) || would_block(e)) continue;
+            throw NetError("accept() failed");
+        }
+        try {
+            set_nonblocking(c);
+            set_nodelay(c);
+        } catch (...) {
+            close_socket(c);
+            throw;
+        }
+        return c;
+    }
+}
+
+// ------------------------------------------------------------
+// 関数名 : local_port
+// ------------------------------------------------------------
+uint16_t local_port(socket_t s) {
+    sockaddr_in addr{};
+#ifdef _WIN32
+    int len = sizeof(addr);
+#else
+    socklen_t len = sizeof(addr);
+#endif
+    if (getsockname(s, reinterpret_cast<sockaddr*>(&addr), &len) != 0) throw NetError("getsockname() failed");
+    return ntohs(addr.sin_port);
+}
+
+bool wait_readable(socket_t s, int timeout_ms) { return wait_event(s, POLLIN,  timeout_ms) != 0; }
+bool wait_writable(socket_t s, int timeout_ms) { return wait_event(s, POLLOUT, timeout_ms) != 0; }
+
+unsigned wait_io(socket_t s, bool want_write, int timeout_ms) {
+    const short ev = wait_event(s, static_cast<short>(POLLIN | (want_write ? POLLOUT : 0)), timeout_ms);
+    unsigned m = 0;
+    if (ev & (POLLIN | POLLERR | POLLHUP)) m |= IO_READABLE;
+    if (ev & POLLOUT)                      m |= IO_WRITABLE;
+    return m;
+}
+
+// ------------------------------------------------------------
+// 関数名 : send_all
+// 備考   : 短いフレームなので通常は1回の send で完了する
+// ------------------------------------------------------------
+void send_all(socket_t s, const uint8_t* p, size_t n, int timeout_ms) {
+    while (n > 0) {
+#ifdef _WIN32
+        const int r = ::send(s, reinterpret_cast<const char*>(p), static_cast<int>(n), SEND_FLAGS);
+#else
+        const ssize_t r = ::send(s, p, n, SEND_FLAGS);
+#endif
+        if (r > 0) {
+            p += r;
+            n -= static_cast<size_t>(r);
+            continue;
+        }
+        const int e = last_error();
+        if (r < 0 && interrupted(e)) continue;
+        if (r < 0 && would_block(e)) {
+            if (!wait_writable(s, timeout_ms)) throw NetError("send() timeout");
+            continue;
+        }
+        throw NetError("send() failed");
+    }
+}
+
+// ------------------------------------------------------------
+// 関数名 : send_some
+// ------------------------------------------------------------
+long send_some(socket_t s, const uint8_t* p, size_t n) {
+    for (;;) {
+#ifdef _WIN32
+        const int r = ::send(s, reinterpret_cast<const char*>(p), static_cast<int>(n), SEND_FLAGS);
+#else
+        const ssize_t r = ::send(s, p, n, SEND_FLAGS);
+#endif
+        if (r >= 0) return static_cast<long>(r);
+        const int e = last_error();
+        if (interrupted(e)) continue;
+        if (would_block(e)) return -1;
+        throw NetError("send() failed");
+    }
+}
+
+// ------------------------------------------------------------
+// 関数名 : recv_some
+// ------------------------------------------------------------
+long recv_some(socket_t s, uint8_t* p, size_t n) {
+    for (;;) {
+#ifdef _WIN32
+        const int r = ::recv(s, reinterpret_cast<char*>(p), static_cast<int>(n), 0);
+#else
+        const ssize_t r = ::recv(s, p, n, 0);
+#endif
+        if (r >= 0) return static_cast<long>(r);
+        const int e = last_error();
+        if (interrupted(e)) continue;
+        if (would_block(e)) return -1;
+        throw NetError("recv() failed");
+    }
+}
+
+} // namespace net
+} // namespace tr3
@@ -10,11 +10,13 @@
 //   src/protocol.cpp
 // 相対パスでインクルード（Ctrl+Shift+B でビルドする想定）
 #include "../include/tr3/protocol.hpp"
+#include "../include/tr3/simd.hpp"
 
 #include <stdexcept>   // runtime_error
 #include <cstddef>     // size_t
 #include <utility>     // std::move
 #include <algorithm>   // std::copy
+#include <cstring>     // std::memchr
 
 namespace tr3 {
 
@@ -23,29 +25,12 @@ namespace tr3 {
 // 概要 : フィールド(addr/cmd/data)から STX〜CR の完全フレームを生成
 // 形式 : [STX][ADDR][CMD][LEN][DATA...][ETX][SUM][CR]
 // 注意 : SUM は STX〜ETX の総和の下位1バイト（SUM自身とCRは含めない）
+//        ヒープを使わない経路は encode_to() / encode_frame()
 // ====================================================================
 std::vector<uint8_t> Frame::encode() const {
-    std::vector<uint8_t> out;
-    out.reserve(HEADER_LEN + data.size() + FOOTER_LEN);
-
-    // ---- ヘッダ部 ----
-    out.push_back(STX);                                // STX(0x02)
-    out.push_back(addr);                               // アドレス(通常0x00)
-    out.push_back(cmd);                                // コマンド
-    out.push_back(static_cast<uint8_t>(data.size()));  // データ長(LEN)
-
-    // ---- データ部 ----
-    out.insert(out.end(), data.begin(), data.end());
-
-    // ---- フッタ部 ----
-    out.push_back(ETX);                                // ETX(0x03)
-
-    // SUM: STX〜ETXの総和の下位1B（SUM/CRは含めない）
-    const uint8_t sum = calc_sum(out);
-    out.push_back(sum);
-
-    out.push_back(CR);                                 // CR(0x0D)
-
+    // 出力長ちょうどで1回だけ確保し、encode_frame で直接書き込む
+    std::vector<uint8_t> out(HEADER_LEN + data.size() + FOOTER_LEN);
+    encode_frame(out.data(), addr, cmd, data.data(), data.size());
     return out;
 }
 
@@ -53,140 +38,271 @@ std::vector<uint8_t> Frame::encode() const {
 // Frame::calc_sum
 // 概要 : 引数の配列（STX〜ETX を想定）の総和を取り、下位1Bを返す
 // 例外 : なし（配列長0のときは 0 を返す）
+// 実装 : simd::sum_bytes（SSE2 / AVX2 の psadbw 集計）
 // ====================================================================
 uint8_t Frame::calc_sum(const std::vector<uint8_t>& stx_to_etx) {
-    uint32_t sum = 0;
-    for (uint8_t b : stx_to_etx) {
-        sum += b;
-    }
+    return calc_sum(ByteView(stx_to_etx));
+}
+
+uint8_t Frame::calc_sum(ByteView stx_to_etx) {
+    const uint32_t sum = simd::sum_bytes(stx_to_etx.data(), stx_to_etx.size());
     return static_cast<uint8_t>(sum & 0xFF);
 }
 
 // ====================================================================
-// Parser::push
-// 概要 : 受信バイトを1つ積み、状態機械で構文解析を進める
-// 戻値 : true  = 完成フレームが内部バッファに揃った（take/take_raw 可）
-//        false = まだ未完成（次のバイト待ち）
-// 解析順序:
-//   1) STX探索
-//   2) ヘッダ（ADDR/CMD/LEN）の読込 → LEN確定
-//   3) ペイロード（DATA + ETX/SUM/CR）を所要バイト数だけ蓄積
-//   4) ETX/CR/総和(SUM)で最終検証（NGならリセットし再同期）
+// Parser::check_frame
+// 概要 : 完全フレーム（STX〜CR）の末尾CR / ETX位置 / SUM を検証
+// 戻値 : OK / FORMAT（ETX・CR 不正）/ CHECKSUM（SUM 不一致）
 // ====================================================================
-bool Parser::push(uint8_t byte) {
-    buf_.push_back(byte);
+Parser::Check Parser::check_frame(ByteView raw) {
+    const size_t sz = raw.size();
+    if (sz < static_cast<size_t>(HEADER_LEN + FOOTER_LEN)) return Check::FORMAT;
+    if (raw[sz - 1] != CR || raw[sz - 3] != ETX) return Check::FORMAT;
+    // SUM: STX〜ETX（SUM/CRは含めない）
+    return raw[sz - 2] == Frame::calc_sum(ByteView(raw.data(), sz - 2)) ? Check::OK : Check::CHECKSUM;
+}
 
-    switch (st_) {
-    case State::SEEK_STX:
-        if (byte == STX) {
-            // STX 検出 → ヘッダ収集へ
-            buf_.clear();
-            buf_.push_back(byte);
-            st_   = State::HEADER;
-            need_ = HEADER_LEN - 1; // STX以外のヘッダ残数(ADDR,CMD,LEN)
-        } else {
-            // ゴミバイトは破棄して STX を待つ
+// ====================================================================
+// Parser::view_of
+// 概要 : 検証済みの完全フレームから addr/cmd/data のビューを作る
+// ====================================================================
+FrameView Parser::view_of(ByteView raw) {
+    FrameView v;
+    v.addr = raw[1];
+    v.cmd  = raw[2];
+    v.data = ByteView(raw.data() + HEADER_LEN, raw[3]);
+    v.raw  = raw;
+    return v;
+}
+
+void Parser::count_error(Check c) {
+    if (c == Check::CHECKSUM) ++stats_.checksum_errors;
+    else                      ++stats_.format_errors;
+    ++stats_.resyncs;   // 呼び出し側は必ず STX 1バイトを捨てて探し直す
+}
+
+// ====================================================================
+// Parser::rescan
+// 概要 : buf_ に溜まったバイトから次の状態を決める
+// 手順 :
+//   1) 先頭を次の STX に合わせる（手前のバイトは dropped_bytes）
+//   2) ヘッダ未満 → HEADER、フレーム長未満 → PAYLOAD（不足分を need_ へ）
+//   3) フレーム長ぶん揃っていれば検証。OK → FOOTER（完成）
+//   4) 不正 → 先頭の STX 1バイトだけ捨てて 1) へ
+//      （偽の STX の後ろに本物の STX があっても失わない）
+// ====================================================================
+bool Parser::rescan() {
+    for (;;) {
+        const auto* hit = static_cast<const uint8_t*>(buf_.empty() ? nullptr : std::memchr(buf_.data(), STX, buf_.size()));
+        if (!hit) {
+            stats_.dropped_bytes += buf_.size();
             buf_.clear();
+            st_   = State::SEEK_STX;
+            need_ = 0;
+            return false;
+        }
+        const size_t k = static_cast<size_t>(hit - buf_.data());
+        if (k > 0) {
+            stats_.dropped_bytes += k;
+            buf_.erase(buf_.begin(), buf_.begin() + static_cast<std::ptrdiff_t>(k));
         }
-        break;
-
-    case State::HEADER:
-        if (--need_ == 0) {
-            // ヘッダ4バイトが揃ったので LEN を取得
-            if (buf_.size() < static_cast<size_t>(HEADER_LEN)) {
-                // 理論上到達しないが保険
-                reset();
-                break;
-            }
-            const uint8_t len = buf_[3];
 
-            // DATA(len) + フッタ(ETX,SUM,CR=3B) を待つ
-            need_ = static_cast<size_t>(len) + FOOTER_LEN;
+        if (buf_.size() < static_cast<size_t>(HEADER_LEN)) {
+            st_   = State::HEADER;
+            need_ = HEADER_LEN - buf_.size();
+            return false;
+        }
+        const size_t total = HEADER_LEN + static_cast<size_t>(buf_[3]) + FOOTER_LEN;
+        if (buf_.size() < total) {
             st_   = State::PAYLOAD;
+            need_ = total - buf_.size();
+            return false;
         }
-        break;
-
-    case State::PAYLOAD:
-        if (--need_ == 0) {
-            // ここまでで [STX..CR] の必要バイト数が揃っているはず
-            const size_t sz = buf_.size();
-            if (sz < static_cast<size_t>(HEADER_LEN + FOOTER_LEN)) {
-                // ありえないが保険
-                reset();
-                break;
-            }
 
-            // 最低限のフォーマット検証（末尾CR, ETX位置）
-            const bool cr_ok  = (buf_[sz - 1] == CR);
-            const bool etx_ok = (buf_[sz - 3] == ETX);
+        const Check c = check_frame(ByteView(buf_.data(), total));
+        if (c == Check::OK) {
+            st_        = State::FOOTER;
+            need_      = 0;
+            frame_len_ = total;
+            ++stats_.frames;
+            return true;
+        }
+        // 不正フレーム：STX 1バイトだけ捨てて再同期
+        count_error(c);
+        ++stats_.dropped_bytes;
+        buf_.erase(buf_.begin());
+    }
+}
 
-            if (cr_ok && etx_ok) {
-                // SUM 検証: 期待SUM=末尾から2番目, 計算SUM=STX〜ETX合計
-                const uint8_t sum_expect = buf_[sz - 2];
+// ====================================================================
+// Parser::drop_frame
+// 概要 : 取り出し済み（または取り出されなかった）完成フレームを buf_ から除く
+// 備考 : 再同期で溜めた後続バイトは残し、次の push()/feed() で解析を続ける
+// ====================================================================
+void Parser::drop_frame() {
+    buf_.erase(buf_.begin(), buf_.begin() + static_cast<std::ptrdiff_t>(std::min(frame_len_, buf_.size())));
+    frame_len_ = 0;
+    st_        = State::SEEK_STX;
+    need_      = 0;                  // 残りバイトがあれば次の判定で rescan() する
+}
 
-                // STX〜ETX（SUM/CRは含めない）
-                const uint8_t sum_calc =
-                    Frame::calc_sum(std::vector<uint8_t>(buf_.begin(), buf_.end() - 2));
+// ====================================================================
+// Parser::feed
+// 概要 : 入力バッファをまとめて解析し、最初の完成フレームで止まる
+// 解析順序:
+//   0) 前回返したフレームを除き、再同期で残ったバイトがあれば先に解析
+//   1) STX探索（memchr で一括スキャン。libc の実装がすでに SIMD 化されており、
+//      tr3_bench では simd::find_byte より速い）
+//   2) 入力内にフレームが丸ごとあれば、その場で検証してビューを返す（コピーなし）
+//   3) 入力末尾で途切れたフレームは内部バッファへ一括コピーし、次の feed() で続きを待つ
+//   4) ETX/CR/SUM 不正のフレームは STX 1バイトだけ捨てて次の STX を探す
+// ====================================================================
+Parser::FeedResult Parser::feed(ByteView in, FrameView& out) {
+    const uint8_t* p = in.data();
+    const size_t   n = in.size();
+    size_t i = 0;
+
+    // 前回 feed() で返したフレームは取り出し済みとみなす
+    if (st_ == State::FOOTER) {
+        drop_frame();
+        if (!buf_.empty() && rescan()) {
+            out = view_of(ByteView(buf_.data(), frame_len_));
+            return { 0, true };
+        }
+    }
+
+    while (i < n) {
+        if (st_ == State::SEEK_STX) {
+            const auto* hit = static_cast<const uint8_t*>(std::memchr(p + i, STX, n - i));
+            if (!hit) {                                // STX なし → 全部ゴミ
+                stats_.dropped_bytes += n - i;
+                return { n, false };
+            }
+            const size_t at = static_cast<size_t>(hit - p);
+            stats_.dropped_bytes += at - i;
+            i = at;
 
-                if (sum_expect == sum_calc) {
-                    // 完成フレーム
-                    st_ = State::FOOTER; // 一応FOOTERへ（呼び出し側は take* で取り出す）
-                    return true;
+            // 高速経路：フレームが入力内に収まっている
+            if (n - i >= static_cast<size_t>(HEADER_LEN)) {
+                const size_t total = HEADER_LEN + static_cast<size_t>(p[i + 3]) + FOOTER_LEN;
+                if (n - i >= total) {
+                    const ByteView raw(p + i, total);
+                    const Check c = check_frame(raw);
+                    if (c == Check::OK) {
+                        ++stats_.frames;
+                        out = view_of(raw);
+                        return { i + total, true };
+                    }
+                    // 不正フレーム → STX 1バイトだけ捨てて次の STX へ
+                    count_error(c);
+                    ++stats_.dropped_bytes;
+                    ++i;
+                    continue;
                 }
             }
 
-            // どれかが不正 → 受信位置を再同期（STX 探索へ）
-            reset();
+            // 低速経路：入力をまたぐフレームを内部バッファで組み立てる
+            buf_.clear();
+            buf_.push_back(STX);
+            ++i;
+            st_   = State::HEADER;
+            need_ = HEADER_LEN - 1;
+            continue;
         }
-        break;
 
-    case State::FOOTER:
-        // take()/take_raw() 後に reset() される前提。
-        // 念のため受信継続で来た場合はリセットして再同期。
-        reset();
-        break;
+        // HEADER / PAYLOAD：判定に必要なバイト数までまとめてコピー
+        const size_t take = std::min(need_, n - i);
+        buf_.insert(buf_.end(), p + i, p + i + take);
+        i     += take;
+        need_ -= take;
+        if (need_ > 0) break;                         // 入力を使い切った
+
+        if (rescan()) {
+            out = view_of(ByteView(buf_.data(), frame_len_));
+            return { i, true };
+        }
+        // rescan() 後：未完成なら need_ > 0、全部捨てたら SEEK_STX
+    }
+
+    return { i, false };
+}
+
+// ====================================================================
+// Parser::push
+// 概要 : 受信バイトを1つ積み、状態機械で構文解析を進める
+// 戻値 : true  = 完成フレームが内部バッファに揃った（take/take_raw 可）
+//        false = まだ未完成（次のバイト待ち）
+// 解析順序:
+//   1) STX探索（STX 以外は積まずに捨てる）
+//   2) ヘッダ（ADDR/CMD/LEN）・ペイロード（DATA + ETX/SUM/CR）の所要バイト数を need_ で数える
+//   3) 揃ったら rescan() で検証。NG なら溜めたバイトから次の STX を探して再同期
+// ====================================================================
+bool Parser::push(uint8_t byte) {
+    // 取り出されなかった完成フレームは捨て、このバイトから続ける
+    if (st_ == State::FOOTER) drop_frame();
+
+    if (st_ == State::SEEK_STX && buf_.empty()) {
+        if (byte != STX) {
+            // ゴミバイトは破棄して STX を待つ
+            ++stats_.dropped_bytes;
+            return false;
+        }
+        buf_.push_back(byte);
+        st_   = State::HEADER;
+        need_ = HEADER_LEN - 1;      // STX以外のヘッダ残数(ADDR,CMD,LEN)
+        return false;
     }
 
-    return false;
+    buf_.push_back(byte);
+    if (need_ > 1) {
+        --need_;
+        return false;
+    }
+    return rescan();
+}
+
+// ====================================================================
+// Parser::resume
+// 概要 : 取り出し済みフレームの後ろに残ったバイトを解析し直す
+// ====================================================================
+bool Parser::resume() {
+    if (st_ == State::FOOTER) drop_frame();
+    if (buf_.empty() || need_ > 0) return false;
+    return rescan();
 }
 
 // ====================================================================
 // Parser::take
 // 概要 : 直近で完成したフレームを構造化して返す（addr/cmd/data）
 // 例外 : 未完成の状態で呼ばれた場合は runtime_error
-// 備考 : バッファはクリア・状態はSEEK_STXへ戻す（再利用想定）
+// 備考 : 再同期で溜めた後続バイトは残し、状態はSEEK_STXへ戻す
 // ====================================================================
 Decoded Parser::take() {
-    if (buf_.size() < static_cast<size_t>(HEADER_LEN + FOOTER_LEN)) {
+    if (st_ != State::FOOTER) {
         throw std::runtime_error("Parser::take: フレーム未完成です");
     }
 
-    Decoded d;
-    d.addr = buf_[1];
-    d.cmd  = buf_[2];
+    const FrameView v = view_of(ByteView(buf_.data(), frame_len_));
+    Decoded d = v.to_decoded();
 
-    // DATA 部のみを抽出（LEN バイト）
-    const size_t data_len = static_cast<size_t>(buf_[3]);
-    const size_t data_beg = static_cast<size_t>(HEADER_LEN);
-    const size_t data_end = data_beg + data_len;
-    if (buf_.size() < data_end + FOOTER_LEN) {
-        throw std::runtime_error("Parser::take: データ長不一致です");
-    }
-    d.data.assign(buf_.begin() + data_beg, buf_.begin() + data_end);
-
-    // 使い終えたのでリセット
-    reset();
+    // 使い終えたので取り除く
+    drop_frame();
     return d;
 }
 
 // ====================================================================
 // Parser::take_raw
 // 概要 : 直近の完成フレームの生データ（STX〜CR）を返す
-// 注意 : 取り出し後は内部状態をリセット
+// 注意 : 取り出し後は内部状態をリセット（未完成時は溜まっているバイトをそのまま返す）
 // ====================================================================
 std::vector<uint8_t> Parser::take_raw() {
-    std::vector<uint8_t> raw = buf_;
-    reset();
+    if (st_ != State::FOOTER) {
+        std::vector<uint8_t> raw = buf_;
+        reset();
+        return raw;
+    }
+    std::vector<uint8_t> raw(buf_.begin(), buf_.begin() + static_cast<std::ptrdiff_t>(frame_len_));
+    drop_frame();
     return raw;
 }
 
@@ -196,9 +312,12 @@ std::vector<uint8_t> Parser::take_raw() {
 // 用途 : フォーマット不正/タイムアウト後の再同期など
 // ====================================================================
 void Parser::reset() {
+    if (st_ == State::FOOTER) drop_frame();
+    stats_.dropped_bytes += buf_.size();
     buf_.clear();
-    st_   = State::SEEK_STX;
-    need_ = 0;
+    st_        = State::SEEK_STX;
+    need_      = 0;
+    frame_len_ = 0;
 }
 
 } // namespace tr3
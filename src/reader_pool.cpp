@@ -0,0 +1,358 @@
+// =============================================
+// src/reader_pool.cpp
+// TR3シリーズ - 複数リーダの一括制御（イベントループ）実装
+//
+// 構成：
+//  - Poller      : epoll（Linux）／poll・WSAPoll（その他）の薄いラッパ
+//  - Reader      : リーダ1台ぶんの状態機械（接続 → 初期設定 → サイクル巡回）
+//  - worker_main : 担当リーダのタイマー処理 → ソケット登録の同期 → 待ち → 送受信
+//
+// 状態遷移（Reader::State）：
+//   DISCONNECTED --(reconnect_ms 経過)--> SETUP（接続 + ROM確認 + コマンドモード）
+//   SETUP --(初期設定完了)--> IDLE
+//   IDLE  --(cycle_interval_ms 経過)--> CYCLE（スケジューラの1巡ぶん切替 + Inventory2）
+//   CYCLE --(そのサイクルの Inventory2 がすべて完了)--> IDLE
+//   いずれもエラー（切断/タイムアウト/NACK 以外の異常）で DISCONNECTED へ
+// =============================================
+
+#include "tr3/reader_pool.hpp"
+#include "tr3/async_client.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <unordered_map>
+
+#ifdef __linux__
+#  include <sys/epoll.h>
+#  include <unistd.h>
+#elif !defined(_WIN32)
+#  include <poll.h>
+#endif
+
+namespace tr3 {
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+constexpr int MAX_WAIT_MS = 100;   // stop() の反映と時刻処理のための最大待ち時間
+
+// ------------------------------------------------------------
+// Poller
+//  - ソケットごとに「読込（常時）＋書込（必要時）」を監視する
+//  - key はイベント発生時にそのまま返す（Reader*）
+// ------------------------------------------------------------
+class Poller {
+public:
+    struct Event { void* key; bool readable; bool writable; };
+
+#ifdef __linux__
+    Poller() : ep_(::epoll_create1(EPOLL_CLOEXEC)) {
+        if (ep_ < 0) throw NetError("epoll_create1 failed");
+    }
+    ~Poller() { ::close(ep_); }
+
+    void add(net::socket_t fd, void* key, bool want_write) { ctl(EPOLL_CTL_ADD, fd, key, want_write); }
+    void modify(net::socket_t fd, void* key, bool want_write) { ctl(EPOLL_CTL_MOD, fd, key, want_write); }
+    void remove(net::socket_t fd) {
+        epoll_event ev{};
+        ::epoll_ctl(ep_, EPOLL_CTL_DEL, fd, &ev);   // クローズ済みなら自動削除済み（エラーは無視）
+    }
+
+    void wait(std::vector<Event>& out, int timeout_ms) {
+        epoll_event evs[64];
+        out.clear();
+        const int n = ::epoll_wait(ep_, evs, 64, timeout_ms);
+        for (int i = 0; i < n; ++i) {
+            out.push_back(Event{ evs[i].data.ptr,
+                                 (evs[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) != 0,
+                                 (evs[i].events & EPOLLOUT) != 0 });
+        }
+    }
+
+private:
+    void ctl(int op, net::socket_t fd, void* key, bool want_write) {
+        epoll_event ev{};
+        ev.events   = EPOLLIN | (want_write ? EPOLLOUT : 0u);
+        ev.data.ptr = key;
+        if (::epoll_ctl(ep_, op, fd, &ev) != 0) throw NetError("epoll_ctl failed");
+    }
+    int ep_;
+#else
+#  ifdef _WIN32
+    using pollfd_t = WSAPOLLFD;
+    static int os_poll(pollfd_t* p, size_t n, int t) { return WSAPoll(p, static_cast<ULONG>(n), t); }
+#  else
+    using pollfd_t = pollfd;
+    static int os_poll(pollfd_t* p, size_t n, int t) { return ::poll(p, static_cast<nfds_t>(n), t); }
+#  endif
+
+    void add(net::socket_t fd, void* key, bool want_write)    { entries_[fd] = Entry{ key, want_write }; }
+    void modify(net::socket_t fd, void* key, bool want_write) { entries_[fd] = Entry{ key, want_write }; }
+    void remove(net::socket_t fd) { entries_.erase(fd); }
+
+    void wait(std::vector<Event>& out, int timeout_ms) {
+        out.clear();
+        fds_.clear();
+        keys_.clear();
+        for (const auto& kv : entries_) {
+            pollfd_t p{};
+            p.fd     = kv.first;
+            p.events = static_cast<short>(POLLIN | (kv.second.want_write ? POLLOUT : 0));
+            fds_.push_back(p);
+            keys_.push_back(kv.second.key);
+        }
+        if (fds_.empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+            return;
+        }
+        if (os_poll(fds_.data(), fds_.size(), timeout_ms) <= 0) return;
+        for (size_t i = 0; i < fds_.size(); ++i) {
+            const short re = fds_[i].revents;
+            if (!re) continue;
+            out.push_back(Event{ keys_[i], (re & (POLLIN | POLLERR | POLLHUP)) != 0, (re & POLLOUT) != 0 });
+        }
+    }
+
+private:
+    struct Entry { void* key; bool want_write; };
+    std::unordered_map<net::socket_t, Entry> entries_;
+    std::vector<pollfd_t> fds_;
+    std::vector<void*>    keys_;
+#endif
+};
+
+} // namespace
+
+// ------------------------------------------------------------
+// Reader
+//  - リーダ1台ぶんの接続と巡回スケジュール
+//  - 担当ワーカースレッドからのみ操作される
+// ------------------------------------------------------------
+struct ReaderPool::Reader {
+    enum class State { DISCONNECTED, SETUP, IDLE, CYCLE };
+
+    uint32_t     id{};
+    ReaderConfig cfg;
+    ReaderPool*  pool{};
+    AsyncClient  cli;
+    AntennaScheduler sched;
+    int          cycle_left = 0;                     // このサイクルで未完了の Inventory2 数
+
+    Reader(uint32_t id_, const ReaderConfig& c, ReaderPool* p)
+        : id(id_), cfg(c), pool(p), sched(schedule_of(c)) {}
+
+    // schedule.antennas 未指定なら ANT#0 〜 antennas-1 の均等巡回（休止・ブザー設定は引き継ぐ）
+    static SchedulerConfig schedule_of(const ReaderConfig& c) {
+        if (!c.schedule.antennas.empty()) return c.schedule;
+        SchedulerConfig s = c.schedule;
+        s.antennas = SchedulerConfig::uniform(std::max(1, c.antennas)).antennas;
+        return s;
+    }
+
+    State             st = State::DISCONNECTED;
+    clock::time_point next_at{};                     // 次の再接続／サイクル開始時刻
+
+    net::socket_t reg_fd    = net::INVALID_SOCK;     // Poller に登録中のソケット
+    bool          reg_write = false;
+    bool          reg_dirty = false;                 // 新しいソケット（同じ fd 番号でも再登録が必要）
+
+    void status(const std::string& msg) {
+        if (pool->on_status_) pool->on_status_(id, msg);
+    }
+
+    // エラー発生 → 切断して再接続待ちへ
+    void fail(const std::exception_ptr& e) {
+        if (st == State::DISCONNECTED) return;
+        st      = State::DISCONNECTED;
+        next_at = clock::now() + std::chrono::milliseconds(cfg.reconnect_ms);
+        std::string msg = "error";
+        try { std::rethrow_exception(e); } catch (const std::exception& ex) { msg = ex.what(); } catch (...) {}
+        status("disconnected: " + msg);
+        cli.close();
+    }
+
+    // 接続開始 + 初期設定コマンドを先行投入
+    void begin_connect() {
+        try {
+            cli.set_window(static_cast<size_t>(std::max(2, sched.round_length() * 2)));
+            sched.invalidate_current();              // 接続し直したら最初に必ずアンテナ切替
+            cli.connect_async(cfg.ip, cfg.port, cfg.timeout_ms);
+            reg_dirty = true;
+        } catch (const NetError&) {
+            next_at = clock::now() + std::chrono::milliseconds(cfg.reconnect_ms);
+            return;
+        }
+        st = State::SETUP;
+        FrameBuffer fb;
+        cli.submit(cmd::check_rom_version(fb, cfg.addr), [this](AsyncClient::Result&& r) {
+            if (r.error) fail(r.error);
+        });
+        cli.submit(cmd::set_command_mode(fb, cfg.addr), [this](AsyncClient::Result&& r) {
+            if (r.error) { fail(r.error); return; }
+            st      = State::IDLE;
+            next_at = clock::now();
+            status("connected");
+        });
+    }
+
+    // 1サイクル（スケジューラの1巡ぶんの切替 + Inventory2 + ブザー）を先行投入
+    void begin_cycle() {
+        st = State::CYCLE;
+        cycle_left = 0;
+        FrameBuffer fb;
+        for (int k = 0; k < sched.round_length(); ++k) {
+            const auto slot = sched.next();
+            const uint8_t ant = slot.antenna;
+            if (slot.switch_needed) {
+                cli.submit(cmd::switch_antenna(fb, ant, cfg.addr), [this](AsyncClient::Result&& r) {
+                    if (r.error) fail(r.error);
+                });
+            }
+            for (int d = 0; d < slot.dwell; ++d) {
+                ++cycle_left;
+                cli.submit(cmd::inventory2(fb, cfg.addr), [this, ant](AsyncClient::Result&& r) {
+                    if (r.error) { fail(r.error); return; }
+                    const int n = static_cast<int>(r.tags.size());
+                    sched.report(ant, n);
+                    if (pool->on_tag_ || pool->queue_) {
+                        const auto now = std::chrono::system_clock::now();
+                        for (const auto& t : r.tags) {
+                            if (auto tag = parse_tag(t.cmd, t.data)) {
+                                if (pool->on_tag_) pool->on_tag_(TagEvent{ id, ant, *tag, now });
+                                if (pool->queue_)  pool->queue_->try_push(TagRecord::make(id, ant, *tag, now));
+                            }
+                        }
+                    }
+                    if (sched.want_buzzer(n)) {
+                        FrameBuffer bz;
+                        cli.submit(cmd::buzzer(bz, 0x01, cfg.addr), [](AsyncClient::Result&&) {});
+                    }
+                    if (--cycle_left == 0 && st == State::CYCLE) {
+                        st      = State::IDLE;
+                        next_at = clock::now() + std::chrono::milliseconds(cfg.cycle_interval_ms);
+                    }
+                });
+            }
+        }
+    }
+
+    // 時刻処理（再接続・サイクル開始・タイムアウト判定）
+    void tick(clock::time_point now) {
+        if (st == State::DISCONNECTED) {
+            if (now >= next_at) begin_connect();
+        } else if (st == State::IDLE) {
+            if (now >= next_at) begin_cycle();
+        }
+        cli.check_timeouts(now);
+    }
+
+    // 次に tick が必要になるまでのミリ秒
+    int wake_ms(clock::time_point now) const {
+        int ms = cli.next_timeout_ms(now);
+        if (st == State::DISCONNECTED || st == State::IDLE) {
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(next_at - now).count();
+            const int t = left > 0 ? static_cast<int>(left) : 0;
+            ms = (ms < 0) ? t : std::min(ms, t);
+        }
+        return ms;
+    }
+};
+
+// ------------------------------------------------------------
+// ReaderPool
+// ------------------------------------------------------------
+ReaderPool::ReaderPool(size_t workers) : workers_(workers ? workers : 1) {}
+
+ReaderPool::~ReaderPool() {
+    stop();
+}
+
+uint32_t ReaderPool::add_reader(const ReaderConfig& cfg) {
+    readers_.push_back(std::make_unique<Reader>(static_cast<uint32_t>(readers_.size()), cfg, this));
+    return readers_.back()->id;
+}
+
+void ReaderPool::start() {
+    if (running_.exchange(true)) return;
+    const size_t n = std::min(workers_, std::max<size_t>(1, readers_.size()));
+    for (auto& r : readers_) r->cli.set_capture(capture_, static_cast<uint16_t>(r->id));
+    for (size_t i = 0; i < n; ++i) {
+        threads_.emplace_back([this, i, n] { worker_main(i, n); });
+    }
+}
+
+void ReaderPool::stop() {
+    running_ = false;
+    for (auto& t : threads_) {
+        if (t.joinable()) t.join();
+    }
+    threads_.clear();
+}
+
+// ------------------------------------------------------------
+// 関数名 : worker_main
+// 概要   : ワーカースレッド本体（担当 = id % nthreads == index のリーダ）
+// 手順   :
+//   1) 時刻処理（再接続・サイクル開始・タイムアウト）
+//   2) ソケット登録の同期（削除を先に行ってから追加／変更。
+//      クローズ済み fd 番号が別リーダで再利用される場合に備える）
+//   3) 次の期限まで（最大 MAX_WAIT_MS）待ち、イベントを AsyncClient へ渡す
+// ------------------------------------------------------------
+void ReaderPool::worker_main(size_t index, size_t nthreads) {
+    std::vector<Reader*> mine;
+    for (size_t i = index; i < readers_.size(); i += nthreads) mine.push_back(readers_[i].get());
+
+    Poller poller;
+    std::vector<Poller::Event> events;
+
+    while (running_.load()) {
+        // 1) 時刻処理
+        auto now = clock::now();
+        for (Reader* r : mine) r->tick(now);
+
+        // 2) 登録の同期（削除 → 追加/変更）
+        for (Reader* r : mine) {
+            if (r->reg_fd != net::INVALID_SOCK && (r->reg_dirty || r->reg_fd != r->cli.handle())) {
+                poller.remove(r->reg_fd);
+                r->reg_fd = net::INVALID_SOCK;
+            }
+        }
+        for (Reader* r : mine) {
+            const net::socket_t fd = r->cli.handle();
+            if (fd == net::INVALID_SOCK) continue;
+            const bool ww = r->cli.wants_write();
+            if (r->reg_fd == net::INVALID_SOCK) {
+                poller.add(fd, r, ww);
+            } else if (ww != r->reg_write) {
+                poller.modify(fd, r, ww);
+            } else {
+                continue;
+            }
+            r->reg_fd    = fd;
+            r->reg_write = ww;
+            r->reg_dirty = false;
+        }
+
+        // 3) 待ち → 送受信
+        now = clock::now();
+        int wait = MAX_WAIT_MS;
+        for (Reader* r : mine) {
+            const int w = r->wake_ms(now);
+            if (w >= 0) wait = std::min(wait, w);
+        }
+        poller.wait(events, wait);
+        for (const auto& ev : events) {
+            auto* r = static_cast<Reader*>(ev.key);
+            if (ev.writable) r->cli.on_writable();
+            if (ev.readable) r->cli.on_readable();
+        }
+    }
+
+    for (Reader* r : mine) {
+        r->st = Reader::State::DISCONNECTED;   // 停止時の失敗コールバックで状態通知しない
+        r->cli.close();
+    }
+}
+
+} // namespace tr3
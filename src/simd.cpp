@@ -0,0 +1,201 @@
+// =============================================
+// src/simd.cpp
+// TR3シリーズ - バイト列の走査カーネル実装
+//
+//  - find_byte : 16 / 32（AVX2 は 128）バイトずつ比較（cmpeq）→ movemask → 最下位ビット位置
+//  - sum_bytes : psadbw（0 との差の絶対値和 = 8 バイトごとの総和）で 64bit レーンへ集計
+//  - AVX2 版は target 属性（GCC / Clang）で個別にコンパイルし、
+//    初回呼び出し時の CPU 判定で関数ポインタを選ぶ（ビルドフラグは変更不要）
+//  - 16 バイト未満の端数はスカラーで処理
+// =============================================
+
+#include "tr3/simd.hpp"
+
+#if !defined(TR3_NO_SIMD) && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+#  define TR3_SIMD_X86 1
+#  include <immintrin.h>
+#  ifdef _MSC_VER
+#    include <intrin.h>
+#  endif
+#endif
+
+namespace tr3::simd {
+
+namespace {
+
+// ---------------------------------------------
+// スカラー実装（フォールバック／端数処理）
+// ---------------------------------------------
+const uint8_t* find_scalar(const uint8_t* p, size_t n, uint8_t v) {
+    for (size_t i = 0; i < n; ++i) {
+        if (p[i] == v) return p + i;
+    }
+    return nullptr;
+}
+
+uint32_t sum_scalar(const uint8_t* p, size_t n) {
+    uint32_t s = 0;
+    for (size_t i = 0; i < n; ++i) s += p[i];
+    return s;
+}
+
+#ifdef TR3_SIMD_X86
+
+inline unsigned lowest_bit(uint32_t mask) {
+#  ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return static_cast<unsigned>(idx);
+#  else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#  endif
+}
+
+#  if defined(__GNUC__) || defined(__clang__)
+#    define TR3_TARGET_AVX2 __attribute__((target("avx2")))
+#  else
+#    define TR3_TARGET_AVX2
+#  endif
+
+// ---------------------------------------------
+// SSE2 実装
+// ---------------------------------------------
+const uint8_t* find_sse2(const uint8_t* p, size_t n, uint8_t v) {
+    const __m128i needle = _mm_set1_epi8(static_cast<char>(v));
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        const uint32_t m = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, needle)));
+        if (m) return p + i + lowest_bit(m);
+    }
+    return find_scalar(p + i, n - i, v);
+}
+
+uint32_t sum_sse2(const uint8_t* p, size_t n) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(x, zero));
+    }
+    const uint32_t lo = static_cast<uint32_t>(_mm_cvtsi128_si32(acc));
+    const uint32_t hi = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(acc, 8)));
+    return lo + hi + sum_scalar(p + i, n - i);
+}
+
+// ---------------------------------------------
+// AVX2 実装
+// ---------------------------------------------
+TR3_TARGET_AVX2 const uint8_t* find_avx2(const uint8_t* p, size_t n, uint8_t v) {
+    const __m256i needle = _mm256_set1_epi8(static_cast<char>(v));
+    size_t i = 0;
+    // 128 バイトずつ：4 本の比較結果を OR して分岐を1つにする（長いゴミ列の再同期向け）
+    for (; i + 128 <= n; i += 128) {
+        const __m256i* q = reinterpret_cast<const __m256i*>(p + i);
+        const __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256(q + 0), needle);
+        const __m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256(q + 1), needle);
+        const __m256i c = _mm256_cmpeq_epi8(_mm256_loadu_si256(q + 2), needle);
+        const __m256i d = _mm256_cmpeq_epi8(_mm256_loadu_si256(q + 3), needle);
+        const __m256i any = _mm256_or_si256(_mm256_or_si256(a, b), _mm256_or_si256(c, d));
+        if (_mm256_movemask_epi8(any) == 0) continue;
+        const __m256i parts[4] = { a, b, c, d };
+        for (int k = 0; k < 4; ++k) {
+            const uint32_t m = static_cast<uint32_t>(_mm256_movemask_epi8(parts[k]));
+            if (m) return p + i + 32 * static_cast<size_t>(k) + lowest_bit(m);
+        }
+    }
+    for (; i + 32 <= n; i += 32) {
+        const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        const uint32_t m = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, needle)));
+        if (m) return p + i + lowest_bit(m);
+    }
+    // 端数は同じ関数内（VEX 符号化）で処理する。
+    // ここから非 VEX の find_sse2 を呼ぶと AVX→SSE 遷移ペナルティで大きく遅くなる
+    if (i + 16 <= n) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        const uint32_t m = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm256_castsi256_si128(needle))));
+        if (m) return p + i + lowest_bit(m);
+        i += 16;
+    }
+    return find_scalar(p + i, n - i, v);
+}
+
+TR3_TARGET_AVX2 uint32_t sum_avx2(const uint8_t* p, size_t n) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(x, zero));
+    }
+    __m128i s = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    if (i + 16 <= n) {   // 端数も VEX のまま（find_avx2 と同じ理由）
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        s = _mm_add_epi64(s, _mm_sad_epu8(x, _mm_setzero_si128()));
+        i += 16;
+    }
+    const uint32_t lo = static_cast<uint32_t>(_mm_cvtsi128_si32(s));
+    const uint32_t hi = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(s, 8)));
+    return lo + hi + sum_scalar(p + i, n - i);
+}
+
+bool cpu_has_avx2() {
+#  ifdef _MSC_VER
+    int r[4];
+    __cpuid(r, 0);
+    if (r[0] < 7) return false;
+    __cpuid(r, 1);
+    const bool osxsave = (r[2] & (1 << 27)) != 0;
+    const bool avx     = (r[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) return false;
+    __cpuidex(r, 7, 0);
+    return (r[1] & (1 << 5)) != 0;
+#  else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#  endif
+}
+
+#endif // TR3_SIMD_X86
+
+// ---------------------------------------------
+// 実装の選択（初回のみ）
+// ---------------------------------------------
+struct Kernels {
+    const uint8_t* (*find)(const uint8_t*, size_t, uint8_t);
+    uint32_t       (*sum)(const uint8_t*, size_t);
+    const char*    name;
+};
+
+Kernels select() {
+#ifdef TR3_SIMD_X86
+    if (cpu_has_avx2()) return { find_avx2, sum_avx2, "avx2" };
+    return { find_sse2, sum_sse2, "sse2" };
+#else
+    return { find_scalar, sum_scalar, "scalar" };
+#endif
+}
+
+const Kernels& kernels() {
+    static const Kernels k = select();
+    return k;
+}
+
+} // namespace
+
+const uint8_t* find_byte(const uint8_t* p, size_t n, uint8_t v) {
+    if (n < 16) return find_scalar(p, n, v);
+    return kernels().find(p, n, v);
+}
+
+uint32_t sum_bytes(const uint8_t* p, size_t n) {
+    if (n < 16) return sum_scalar(p, n);
+    return kernels().sum(p, n);
+}
+
+const char* kernel_name() {
+    return kernels().name;
+}
+
+} // namespace tr3::simd
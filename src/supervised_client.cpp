@@ -0,0 +1,200 @@
+// =============================================
+// src/supervised_client.cpp
+// TR3シリーズ - 自動再接続つきクライアント実装
+//
+//  - 再接続の待ち時間：reconnect_min_ms × backoff^(失敗回数-1)、上限 reconnect_max_ms。
+//    複数台が同時に切れたとき一斉に接続し直さないよう ±20% ずらす
+//  - 最初の接続は待たずに試す。切断後は reconnect_min_ms 待ってから
+//  - probe は ROM確認（応答が短く、リーダの状態を変えない）
+// =============================================
+
+#include "tr3/supervised_client.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace tr3 {
+
+SupervisedClient::SupervisedClient(SessionConfig cfg) : cfg_(std::move(cfg)) {
+    if (cfg_.setup.empty()) {
+        const ByteView rom  = cmd::frames::ROM_VERSION;
+        const ByteView mode = cmd::frames::COMMAND_MODE;
+        cfg_.setup.emplace_back(rom.begin(), rom.end());
+        cfg_.setup.emplace_back(mode.begin(), mode.end());
+    }
+}
+
+// ------------------------------------------------------------
+// 関数名 : try_connect
+// 概要   : 接続 → keepalive 設定 → setup コマンド再送 を1回だけ試す
+// 戻り値 : true = 使える状態になった
+// ------------------------------------------------------------
+bool SupervisedClient::try_connect() {
+    try {
+        cli_.connect(cfg_.ip, cfg_.port, cfg_.timeout_ms);
+        if (cfg_.keepalive_s > 0) {
+            net::set_keepalive(cli_.handle(), cfg_.keepalive_s, 1, 3);
+        }
+        std::vector<Reply> replies;
+        replies.reserve(cfg_.setup.size());
+        for (const auto& f : cfg_.setup) {
+            replies.push_back(cli_.transact(ByteView(f)));
+        }
+        setup_replies_.swap(replies);
+    } catch (const NetError& e) {
+        cli_.close();
+        status(std::string("connect failed: ") + e.what());
+        return false;
+    }
+    note_ok();
+    ++generation_;
+    if (ever_connected_) {
+        ++reconnects_;
+        status("reconnected");
+    } else {
+        status("connected");
+    }
+    ever_connected_ = true;
+    return true;
+}
+
+// ------------------------------------------------------------
+// 関数名 : ensure_connected
+// 備考   : 待つのは next_try_ まで。connect_wait_ms で打ち切っても next_try_ は残るので、
+//          呼び出し側が短い間隔で呼び直しても再接続の間隔は縮まない
+// ------------------------------------------------------------
+void SupervisedClient::ensure_connected() {
+    const auto give_up = cfg_.connect_wait_ms >= 0
+                       ? clock::now() + std::chrono::milliseconds(cfg_.connect_wait_ms)
+                       : clock::time_point::max();
+    while (!cli_.connected()) {
+        if (stop_) throw NetError("stopped");
+        const auto now = clock::now();
+        if (now < next_try_) {
+            if (now >= give_up) throw NetError("not connected (reconnect pending)");
+            const auto wait = std::chrono::ceil<std::chrono::milliseconds>(std::min(next_try_, give_up) - now);
+            if (!sleep_for(wait)) throw NetError("stopped");
+            continue;
+        }
+        if (try_connect()) {
+            failures_ = 0;
+        } else {
+            ++failures_;
+            schedule_retry();
+        }
+    }
+}
+
+// ------------------------------------------------------------
+// 関数名 : schedule_retry
+// 概要   : reconnect_min_ms × backoff^(failures_-1)（上限 reconnect_max_ms、±20%）後を next_try_ にする
+// ------------------------------------------------------------
+void SupervisedClient::schedule_retry() {
+    const double base   = cfg_.reconnect_min_ms * std::pow(cfg_.reconnect_backoff, failures_ - 1);
+    const double capped = std::min(base, static_cast<double>(cfg_.reconnect_max_ms));
+    rng_ = rng_ * 1664525u + 1013904223u;                       // LCG（揺らぎ用）
+    const double jitter = 0.8 + 0.4 * static_cast<double>(rng_ >> 8) / static_cast<double>(1u << 24);
+    next_try_ = clock::now() + std::chrono::milliseconds(static_cast<int64_t>(capped * jitter));
+}
+
+// ------------------------------------------------------------
+// 関数名 : sleep_for
+// 概要   : stop() で起こされるまで最大 d 待つ
+// ------------------------------------------------------------
+bool SupervisedClient::sleep_for(std::chrono::milliseconds d) {
+    std::unique_lock<std::mutex> lk(mu_);
+    return !cv_.wait_for(lk, d, [this] { return stop_.load(); });
+}
+
+void SupervisedClient::stop() {
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+}
+
+// ------------------------------------------------------------
+// 関数名 : drop / note_error
+// 概要   : 接続を捨てる。TimeoutError は連続 max_timeouts 回まで様子を見る
+// ------------------------------------------------------------
+void SupervisedClient::drop(const std::string& reason) {
+    if (!cli_.connected()) return;
+    cli_.close();
+    timeouts_ = 0;
+    failures_ = 1;   // 再接続は reconnect_min_ms 待ってから
+    schedule_retry();
+    status("disconnected: " + reason);
+}
+
+void SupervisedClient::note_error(const NetError& e) {
+    if (dynamic_cast<const TimeoutError*>(&e) && ++timeouts_ < std::max(1, cfg_.max_timeouts)) {
+        return;
+    }
+    drop(e.what());
+}
+
+// ------------------------------------------------------------
+// 関数名 : probe_if_idle
+// ------------------------------------------------------------
+bool SupervisedClient::probe_if_idle() {
+    if (!cli_.connected() || cfg_.idle_probe_ms <= 0) return cli_.connected();
+    if (clock::now() - last_io_ < std::chrono::milliseconds(cfg_.idle_probe_ms)) return true;
+    try {
+        cli_.transact(cmd::frames::ROM_VERSION, 0);
+        note_ok();
+        return true;
+    } catch (const NetError& e) {
+        drop(std::string("probe failed: ") + e.what());
+        return false;
+    }
+}
+
+// ------------------------------------------------------------
+// 関数名 : transact / transact_batch / receive_only
+// ------------------------------------------------------------
+SupervisedClient::Reply SupervisedClient::transact(ByteView frame, int retries, int timeout_ms) {
+    ensure_connected();
+    if (!probe_if_idle()) ensure_connected();
+    try {
+        Reply r = cli_.transact(frame, retries, timeout_ms);
+        note_ok();
+        return r;
+    } catch (const NetError& e) {
+        note_error(e);
+        throw;
+    }
+}
+
+std::vector<SupervisedClient::BatchReply> SupervisedClient::transact_batch(const CommandBatch& batch, int timeout_ms) {
+    std::vector<BatchReply> out;
+    transact_batch(batch, out, timeout_ms);
+    return out;
+}
+
+void SupervisedClient::transact_batch(const CommandBatch& batch, std::vector<BatchReply>& out, int timeout_ms) {
+    ensure_connected();
+    if (!probe_if_idle()) ensure_connected();
+    try {
+        cli_.transact_batch(batch, out, timeout_ms);
+        note_ok();
+    } catch (const NetError& e) {
+        note_error(e);
+        throw;
+    }
+}
+
+SupervisedClient::Reply SupervisedClient::receive_only(int timeout_ms) {
+    // 続きのフレームを待つだけなので probe はしない（切断済みなら再接続しても続きは来ない）
+    if (!cli_.connected()) throw NetError("not connected");
+    try {
+        Reply r = cli_.receive_only(timeout_ms);
+        note_ok();
+        return r;
+    } catch (const NetError& e) {
+        note_error(e);
+        throw;
+    }
+}
+
+} // namespace tr3
@@ -0,0 +1,141 @@
+// =============================================
+// src/tag_cache.cpp
+// TR3シリーズ - タグ重複排除キャッシュ実装
+//
+// ハッシュ表：
+//  - slots_[i].reads == 0 を空きスロットとみなす
+//  - 探索は slot_of(uid) から空きスロットに当たるまで線形に進む
+//  - 削除時は後続の要素を「本来の位置を越えない範囲で」前に詰める（後方シフト）
+// =============================================
+
+#include "tr3/tag_cache.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace tr3 {
+
+namespace {
+
+size_t round_pow2(size_t n) {
+    size_t p = 16;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+} // namespace
+
+TagCache::TagCache(Config cfg, Callback cb, size_t initial_capacity)
+    : cfg_(cfg), cb_(std::move(cb)), slots_(round_pow2(initial_capacity)) {}
+
+// ------------------------------------------------------------
+// 関数名 : observe
+// ------------------------------------------------------------
+void TagCache::observe(uint64_t uid, uint8_t dsfid, uint8_t antenna, clock::time_point now) {
+    if ((size_ + 1) * 2 > slots_.size()) grow();
+
+    const size_t mask = slots_.size() - 1;
+    size_t i = slot_of(uid);
+    while (slots_[i].reads != 0 && slots_[i].uid != uid) i = (i + 1) & mask;
+
+    Entry& e = slots_[i];
+    const size_t ant = std::min<size_t>(antenna, MAX_ANTENNAS - 1);
+
+    if (e.reads == 0) {
+        // 新規タグ
+        e = Entry{};
+        e.uid      = uid;
+        e.dsfid    = dsfid;
+        e.antenna  = antenna;
+        e.reads    = 1;
+        e.first    = now;
+        e.last     = now;
+        e.reported = now;
+        e.ant_reads[ant] = 1;
+        ++size_;
+        if (cb_) cb_(Event{ EventType::FIRST_SEEN, e });
+        return;
+    }
+
+    // 既知タグ：カウンタ更新のみ（refresh_ms 経過時だけ通知）
+    e.dsfid   = dsfid;
+    e.antenna = antenna;
+    e.last    = now;
+    ++e.reads;
+    ++e.ant_reads[ant];
+    if (cfg_.refresh_ms > 0 && now - e.reported >= std::chrono::milliseconds(cfg_.refresh_ms)) {
+        e.reported = now;
+        if (cb_) cb_(Event{ EventType::LAST_SEEN, e });
+    }
+}
+
+// ------------------------------------------------------------
+// 関数名 : expire
+// 備考   : 後方シフトで後続要素が手前に来るため、削除した位置は再検査する。
+//          通知は削除の後（コールバック内で observe() しても走査位置が壊れない）
+// ------------------------------------------------------------
+void TagCache::expire(clock::time_point now) {
+    const auto limit = std::chrono::milliseconds(cfg_.lost_after_ms);
+    for (size_t i = 0; i < slots_.size();) {
+        Entry& e = slots_[i];
+        if (e.reads != 0 && now - e.last >= limit) {
+            const Event ev{ EventType::LOST, e };
+            erase_at(i);                         // 先に削除（コールバックが表を変えてもよいように）
+            if (cb_) cb_(ev);
+            continue;
+        }
+        ++i;
+    }
+}
+
+const TagCache::Entry* TagCache::find(uint64_t uid) const {
+    const size_t mask = slots_.size() - 1;
+    for (size_t i = slot_of(uid); slots_[i].reads != 0; i = (i + 1) & mask) {
+        if (slots_[i].uid == uid) return &slots_[i];
+    }
+    return nullptr;
+}
+
+void TagCache::clear() {
+    std::fill(slots_.begin(), slots_.end(), Entry{});
+    size_ = 0;
+}
+
+// ------------------------------------------------------------
+// 関数名 : grow
+// 概要   : 容量を倍にして全要素を再配置
+// ------------------------------------------------------------
+void TagCache::grow() {
+    std::vector<Entry> old(slots_.size() * 2);
+    old.swap(slots_);
+    const size_t mask = slots_.size() - 1;
+    for (auto& e : old) {
+        if (e.reads == 0) continue;
+        size_t i = slot_of(e.uid);
+        while (slots_[i].reads != 0) i = (i + 1) & mask;
+        slots_[i] = e;
+    }
+}
+
+// ------------------------------------------------------------
+// 関数名 : erase_at
+// 概要   : スロット i を削除し、後続のクラスタを後方シフトで詰める
+// ------------------------------------------------------------
+void TagCache::erase_at(size_t i) {
+    const size_t mask = slots_.size() - 1;
+    size_t hole = i;
+    for (size_t j = (i + 1) & mask; slots_[j].reads != 0; j = (j + 1) & mask) {
+        // j の要素の本来の位置 home が (hole, j] の範囲外なら hole へ移せる
+        const size_t home = slot_of(slots_[j].uid);
+        const bool between = (hole <= j) ? (hole < home && home <= j)
+                                         : (hole < home || home <= j);
+        if (!between) {
+            slots_[hole] = slots_[j];
+            hole = j;
+        }
+    }
+    slots_[hole] = Entry{};
+    --size_;
+}
+
+} // namespace tr3
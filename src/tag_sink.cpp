@@ -0,0 +1,449 @@
+// =============================================
+// src/tag_sink.cpp
+// TR3シリーズ - タグレコードの送出実装
+//
+//  - 組み立て済みのまとまり（Batch）のバッファは書き終えたら spare_ へ戻して使い回す
+//    （定常状態では送出スレッドもヒープ確保しない）
+//  - 送り先の失敗は例外にせず false で返し、送出スレッドが時間をおいて再試行する
+// =============================================
+
+#include "tr3/tag_sink.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+
+namespace tr3 {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr size_t POP_BATCH        = 256;   // 送出スレッドが1回にキューから取り出す件数
+constexpr size_t SPARE_MAX        = 8;     // 使い回し用に残す空のまとまりの数
+constexpr int    FILE_RETRY_MS    = 1000;  // ファイルを開けない／書けないときの再試行間隔
+constexpr int    UDP_RETRY_MS     = 1000;
+constexpr int    FIRST_BACKOFF_MS = 100;   // 再接続の最初の待ち時間
+constexpr std::chrono::milliseconds IDLE_MIN{1};   // 送出スレッドが空のときの最初の待ち時間
+
+SinkTransport::clock::time_point after_ms(SinkTransport::clock::time_point t, int ms) {
+    return t + std::chrono::milliseconds(ms);
+}
+
+// "HOST:PORT" を分ける（最後の ':' で区切る）
+void split_host_port(const std::string& uri, const std::string& rest, std::string& host, uint16_t& port) {
+    const auto colon = rest.rfind(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 == rest.size())
+        throw std::invalid_argument("sink needs HOST:PORT: " + uri);
+    long v = 0;
+    for (size_t i = colon + 1; i < rest.size(); ++i) {
+        const char c = rest[i];
+        if (c < '0' || c > '9' || v > 65535) throw std::invalid_argument("bad port in sink: " + uri);
+        v = v * 10 + (c - '0');
+    }
+    if (v < 1 || v > 65535) throw std::invalid_argument("bad port in sink: " + uri);
+    host = rest.substr(0, colon);
+    port = static_cast<uint16_t>(v);
+}
+
+} // namespace
+
+// ============================================================
+// RotatingFileSink
+// ============================================================
+
+// ------------------------------------------------------------
+// 関数名 : ready
+// 概要   : ファイルが開いていなければ追記で開く。rotate_bytes に達していれば世代を回す
+// 備考   : 回すのは書いた後（次の ready）なので、1ファイルは最大でまとまり1つ分 rotate_bytes を超える。
+//          まとまりの途中で切らないので、各ファイルは先頭のヘッダから読める
+// ------------------------------------------------------------
+bool RotatingFileSink::ready(clock::time_point now) {
+    if (fp_ && rotate_bytes_ && size_ >= rotate_bytes_) rotate();
+    if (fp_) return true;
+    if (now < retry_at_) return false;
+
+    fp_ = std::fopen(path_.c_str(), "ab");
+    if (!fp_) {
+        retry_at_ = after_ms(now, FILE_RETRY_MS);
+        return false;
+    }
+    std::fseek(fp_, 0, SEEK_END);
+    const long pos = std::ftell(fp_);
+    size_ = pos > 0 ? static_cast<uint64_t>(pos) : 0;
+    return true;
+}
+
+// ------------------------------------------------------------
+// 関数名 : write
+// 備考   : 書けなかったとき（ディスク満杯など）は、途中まで書けた分を切り詰めて
+//          size_（最後に書けたまとまりの終わり）へ戻す。再試行ではまとまりを丸ごと書き直すので、
+//          レコードが途中で切れたり重複したりしない（バイナリの 24 バイト境界も崩れない）。
+//          切り詰められなければ、そのファイルは世代を回して脇へよけ、新しいファイルから書く
+// ------------------------------------------------------------
+bool RotatingFileSink::write(const char* p, size_t n) {
+    if (!fp_) return false;
+    if (std::fwrite(p, 1, n, fp_) != n || std::fflush(fp_) != 0) {
+        close();   // fclose が残りを書き出すこともあるので、切り詰めは閉じた後
+        std::error_code ec;
+        fs::resize_file(path_, size_, ec);
+        if (ec) rotate();
+        retry_at_ = after_ms(clock::now(), FILE_RETRY_MS);
+        return false;
+    }
+    size_ += n;
+    return true;
+}
+
+void RotatingFileSink::close() {
+    if (fp_) {
+        std::fclose(fp_);
+        fp_ = nullptr;
+    }
+}
+
+// ------------------------------------------------------------
+// 関数名 : rotate
+// 概要   : PATH.keep を消し、PATH.k → PATH.k+1、PATH → PATH.1 と名前を変える
+// 備考   : 名前を変えられなくても（keep = 0 など）PATH は空にして続ける
+// ------------------------------------------------------------
+void RotatingFileSink::rotate() {
+    close();
+    std::error_code ec;
+    if (keep_ > 0) {
+        fs::remove(path_ + "." + std::to_string(keep_), ec);
+        for (int k = keep_ - 1; k >= 1; --k)
+            fs::rename(path_ + "." + std::to_string(k), path_ + "." + std::to_string(k + 1), ec);
+        fs::rename(path_, path_ + ".1", ec);
+    } else {
+        fs::remove(path_, ec);
+    }
+    size_ = 0;
+}
+
+// ============================================================
+// StreamSocketSink
+// ============================================================
+
+std::unique_ptr<StreamSocketSink> StreamSocketSink::tcp(std::string host, uint16_t port) {
+    std::unique_ptr<StreamSocketSink> s(new StreamSocketSink());
+    s->host_ = std::move(host);
+    s->port_ = port;
+    return s;
+}
+
+std::unique_ptr<StreamSocketSink> StreamSocketSink::unix_socket(std::string path) {
+    std::unique_ptr<StreamSocketSink> s(new StreamSocketSink());
+    s->unix_path_ = std::move(path);
+    return s;
+}
+
+std::string StreamSocketSink::describe() const {
+    if (!unix_path_.empty()) return "unix:" + unix_path_;
+    return "tcp:" + host_ + ":" + std::to_string(port_);
+}
+
+// ------------------------------------------------------------
+// 関数名 : ready
+// 概要   : 未接続なら接続する。失敗したら待ち時間を倍々に伸ばす（max_backoff_ms まで）
+// ------------------------------------------------------------
+bool StreamSocketSink::ready(clock::time_point now) {
+    if (sock_ != net::INVALID_SOCK) return true;
+    if (now < retry_at_) return false;
+    try {
+        sock_ = unix_path_.empty() ? net::connect_tcp(host_, port_, connect_timeout_ms)
+                                   : net::connect_unix(unix_path_, connect_timeout_ms);
+        fresh_      = true;
+        backoff_ms_ = 0;
+        return true;
+    } catch (const NetError&) {
+        backoff_ms_ = backoff_ms_ ? std::min(backoff_ms_ * 2, max_backoff_ms) : FIRST_BACKOFF_MS;
+        retry_at_   = after_ms(clock::now(), backoff_ms_);
+        return false;
+    }
+}
+
+bool StreamSocketSink::write(const char* p, size_t n) {
+    if (sock_ == net::INVALID_SOCK) return false;
+    try {
+        net::send_all(sock_, reinterpret_cast<const uint8_t*>(p), n, send_timeout_ms);
+        fresh_ = false;
+        return true;
+    } catch (const NetError&) {
+        // 途中まで送れた分は相手に届いている。次の接続はヘッダから送り直す
+        close();
+        backoff_ms_ = FIRST_BACKOFF_MS;
+        retry_at_   = after_ms(clock::now(), backoff_ms_);
+        return false;
+    }
+}
+
+// ============================================================
+// UdpSink
+// ============================================================
+
+bool UdpSink::ready(clock::time_point now) {
+    if (sock_ != net::INVALID_SOCK) return true;
+    if (now < retry_at_) return false;
+    try {
+        sock_ = net::connect_udp(host_, port_);
+        return true;
+    } catch (const NetError&) {
+        retry_at_ = after_ms(now, UDP_RETRY_MS);
+        return false;
+    }
+}
+
+// ------------------------------------------------------------
+// 関数名 : write
+// 備考   : 送信バッファ満杯なら false（次の周回で同じデータグラムを送り直す）。
+//          ICMP の到達不能（ECONNREFUSED）などはソケットを作り直す
+// ------------------------------------------------------------
+bool UdpSink::write(const char* p, size_t n) {
+    if (sock_ == net::INVALID_SOCK) return false;
+    try {
+        return net::send_some(sock_, reinterpret_cast<const uint8_t*>(p), n) == static_cast<long>(n);
+    } catch (const NetError&) {
+        close();
+        retry_at_ = after_ms(clock::now(), UDP_RETRY_MS);
+        return false;
+    }
+}
+
+// ============================================================
+// make_sink / parse_sink_policy
+// ============================================================
+
+std::unique_ptr<SinkTransport> make_sink(const std::string& uri, uint64_t rotate_bytes, int keep) {
+    const auto colon = uri.find(':');
+    if (colon == std::string::npos) throw std::invalid_argument("sink must be SCHEME:TARGET: " + uri);
+    const std::string scheme = uri.substr(0, colon);
+    const std::string rest   = uri.substr(colon + 1);
+    if (rest.empty()) throw std::invalid_argument("empty sink target: " + uri);
+
+    if (scheme == "file") return std::make_unique<RotatingFileSink>(rest, rotate_bytes, keep);
+    if (scheme == "unix") return StreamSocketSink::unix_socket(rest);
+
+    std::string host;
+    uint16_t    port = 0;
+    if (scheme == "tcp") {
+        split_host_port(uri, rest, host, port);
+        return StreamSocketSink::tcp(host, port);
+    }
+    if (scheme == "udp") {
+        split_host_port(uri, rest, host, port);
+        return std::make_unique<UdpSink>(host, port);
+    }
+    throw std::invalid_argument("unknown sink scheme: " + uri);
+}
+
+bool parse_sink_policy(const std::string& name, SinkPolicy& out) {
+    if (name == "drop-newest") { out = SinkPolicy::DROP_NEWEST; return true; }
+    if (name == "drop-oldest") { out = SinkPolicy::DROP_OLDEST; return true; }
+    if (name == "block")       { out = SinkPolicy::BLOCK;       return true; }
+    return false;
+}
+
+// ============================================================
+// TagExporter
+// ============================================================
+
+TagExporter::TagExporter(std::unique_ptr<SinkTransport> sink, ExportConfig cfg)
+    : sink_(std::move(sink)), cfg_(cfg), q_(std::make_unique<TagQueue>()), enc_(cfg.format) {
+    if (!sink_) throw std::invalid_argument("TagExporter: sink is null");
+    if (cfg_.batch_bytes == 0) cfg_.batch_bytes = 1;
+    enc_.header(header_);
+    cur_.bytes.reserve(cfg_.batch_bytes);
+    th_ = std::thread([this] { run(); });
+}
+
+TagExporter::~TagExporter() { stop(); }
+
+void TagExporter::stop() {
+    if (!th_.joinable()) return;
+    stop_.store(true, std::memory_order_release);
+    th_.join();
+}
+
+// ------------------------------------------------------------
+// 関数名 : publish
+// 備考   : BLOCK でも待つのはキューが満杯のときだけ。試す push は最後の1回なので、
+//          queue().dropped() は本当に捨てた件数だけを数える
+// ------------------------------------------------------------
+bool TagExporter::publish(const TagRecord& r) {
+    if (cfg_.policy == SinkPolicy::BLOCK && q_->size_approx() >= TagQueue::capacity()) wait_for_space();
+    return q_->try_push(r);
+}
+
+// ------------------------------------------------------------
+// 関数名 : wait_for_space
+// 概要   : キューに空きができるまで、最大 block_ms（この1秒の残り予算まで）待つ
+// 備考   : 予算は1秒ごとの窓で数える。複数スレッドから呼ばれたときの窓の切り替えは
+//          厳密でなくてよい（待ち時間の上限の目安）
+// ------------------------------------------------------------
+void TagExporter::wait_for_space() {
+    using std::chrono::microseconds;
+    const auto    start  = clock::now();
+    const int64_t now_us = std::chrono::duration_cast<microseconds>(start.time_since_epoch()).count();
+    if (now_us - block_window_us_.load(std::memory_order_relaxed) >= 1'000'000) {
+        block_window_us_.store(now_us, std::memory_order_relaxed);
+        blocked_us_.store(0, std::memory_order_relaxed);
+    }
+    const int64_t left_us = std::min<int64_t>(int64_t{cfg_.block_ms} * 1000,
+                                              int64_t{cfg_.block_budget_ms} * 1000 - blocked_us_.load(std::memory_order_relaxed));
+    if (left_us <= 0) return;
+
+    const auto until = start + microseconds(left_us);
+    while (q_->size_approx() >= TagQueue::capacity() && clock::now() < until)
+        std::this_thread::sleep_for(microseconds(200));
+    blocked_us_.fetch_add(std::chrono::duration_cast<microseconds>(clock::now() - start).count(),
+                          std::memory_order_relaxed);
+}
+
+// ------------------------------------------------------------
+// 関数名 : run
+// 概要   : 送出スレッド本体。取り出す → 組み立てる → まとめて書く を繰り返す
+// 備考   : DROP_NEWEST / BLOCK では、書けずに max_pending_bytes まで溜まったら取り出すのをやめる
+//          （キューが満杯になり、publish() 側で新しいタグを捨てる／待つ）。
+//          取り出せない間は待ち時間を 1 ms から倍々に伸ばし（flush_ms まで）、取り出せたら戻す。
+//          組み立て中のまとまりの期限・送り先の再試行時刻より長くは待たない
+// ------------------------------------------------------------
+void TagExporter::run() {
+    using std::chrono::milliseconds;
+    TagRecord buf[POP_BATCH];
+    const auto flush_after = milliseconds(cfg_.flush_ms);
+    const auto idle_max    = std::max(milliseconds(cfg_.flush_ms), IDLE_MIN);
+    auto       idle        = IDLE_MIN;
+
+    while (!stop_.load(std::memory_order_acquire)) {
+        const auto now = clock::now();
+        size_t n = 0;
+        if (cfg_.policy == SinkPolicy::DROP_OLDEST ||
+            pending_bytes_.load(std::memory_order_relaxed) < cfg_.max_pending_bytes) {
+            n = q_->pop_batch(buf, POP_BATCH);
+            for (size_t i = 0; i < n; ++i) encode(buf[i], now);
+            stats_.records_in += n;
+        }
+        if (!cur_.bytes.empty() && now - cur_first_ >= flush_after) seal_current();
+        if (!pending_.empty()) write_pending(now);
+        if (n > 0) {
+            idle = IDLE_MIN;
+            continue;
+        }
+        clock::duration wait = idle;
+        if (!cur_.bytes.empty()) wait = std::min(wait, cur_first_ + flush_after - now);
+        if (!pending_.empty())   wait = std::min(wait, sink_->retry_at() - now);
+        std::this_thread::sleep_for(std::max<clock::duration>(wait, IDLE_MIN));
+        idle = std::min(idle * 2, idle_max);
+    }
+
+    // 停止：残りを組み立てて1回だけ書き出す（溜める上限は見ない。キューの容量までで収まる）
+    const auto now = clock::now();
+    for (size_t n; (n = q_->pop_batch(buf, POP_BATCH)) > 0;) {
+        for (size_t i = 0; i < n; ++i) encode(buf[i], now);
+        stats_.records_in += n;
+    }
+    seal_current();
+    write_pending(now);
+    for (const auto& b : pending_) stats_.dropped_on_stop += b.records;   // 書けなかった分も捨てた件数に数える
+    sink_->close();
+}
+
+// ------------------------------------------------------------
+// 関数名 : encode
+// 概要   : 1件を組み立て中のまとまりへ追加する。batch_bytes に達したら閉じる
+// 備考   : 1回の write に上限がある送り先（UDP）は、上限を超える手前でまとまりを閉じる
+//          （データグラムがレコードの途中で切れない）
+// ------------------------------------------------------------
+void TagExporter::encode(const TagRecord& r, clock::time_point now) {
+    if (cur_.bytes.empty()) cur_first_ = now;
+    const size_t limit = sink_->max_write();
+    if (limit) {
+        scratch_.clear();
+        enc_.append(r, scratch_);
+        if (!cur_.bytes.empty() && cur_.bytes.size() + scratch_.size() > limit) {
+            seal_current();
+            cur_first_ = now;
+        }
+        cur_.bytes.insert(cur_.bytes.end(), scratch_.begin(), scratch_.end());
+    } else {
+        enc_.append(r, cur_.bytes);
+    }
+    ++cur_.records;
+    if (cur_.bytes.size() >= cfg_.batch_bytes) seal_current();
+}
+
+// ------------------------------------------------------------
+// 関数名 : seal_current
+// 概要   : 組み立て中のまとまりを書き出し待ちへ移す。DROP_OLDEST なら溜めすぎた分を古い順に捨てる
+// 備考   : 捨てるのはまとまり単位（最新の1つは残す）
+// ------------------------------------------------------------
+void TagExporter::seal_current() {
+    if (cur_.bytes.empty()) return;
+    pending_bytes_.fetch_add(cur_.bytes.size(), std::memory_order_relaxed);
+    pending_.push_back(std::move(cur_));
+    if (!spare_.empty()) {
+        cur_ = std::move(spare_.back());
+        spare_.pop_back();
+    } else {
+        cur_ = Batch{};
+        cur_.bytes.reserve(cfg_.batch_bytes);
+    }
+
+    if (cfg_.policy != SinkPolicy::DROP_OLDEST) return;
+    while (pending_.size() > 1 && pending_bytes_.load(std::memory_order_relaxed) > cfg_.max_pending_bytes) {
+        stats_.dropped_backlog += pending_.front().records;
+        pending_bytes_.fetch_sub(pending_.front().bytes.size(), std::memory_order_relaxed);
+        recycle(std::move(pending_.front()));
+        pending_.pop_front();
+    }
+}
+
+// ------------------------------------------------------------
+// 関数名 : write_pending
+// 概要   : 書き出し待ちを古い順に書く。新しいファイル／接続の先頭ならヘッダを先に書く
+// 備考   : 失敗したまとまりは先頭に残し、送り先の再試行間隔が過ぎてから書き直す
+// ------------------------------------------------------------
+void TagExporter::write_pending(clock::time_point now) {
+    while (!pending_.empty()) {
+        if (!sink_->ready(now)) return;
+        if (sink_->at_start() && !header_.empty() && !sink_->write(header_.data(), header_.size())) {
+            ++stats_.write_failures;
+            return;
+        }
+        Batch& b = pending_.front();
+        if (!sink_->write(b.bytes.data(), b.bytes.size())) {
+            ++stats_.write_failures;
+            return;
+        }
+        stats_.records_written += b.records;
+        stats_.bytes_written   += b.bytes.size();
+        ++stats_.batches_written;
+        pending_bytes_.fetch_sub(b.bytes.size(), std::memory_order_relaxed);
+        recycle(std::move(b));
+        pending_.pop_front();
+    }
+}
+
+void TagExporter::recycle(Batch&& b) {
+    if (spare_.size() >= SPARE_MAX) return;
+    b.bytes.clear();
+    b.records = 0;
+    spare_.push_back(std::move(b));
+}
+
+// ------------------------------------------------------------
+// 関数名 : collect_metrics
+// ------------------------------------------------------------
+void TagExporter::collect_metrics(MetricsSnapshot& out, const std::string& labels) const {
+    const std::string sink = "sink=\"" + sink_->describe() + "\"";
+    const std::string l    = labels.empty() ? sink : labels + "," + sink;
+    out.counter("tr3_export_records_total",        "Tag records written to the export sink.",          l, stats_.records_written);
+    out.counter("tr3_export_bytes_total",          "Bytes written to the export sink.",                l, stats_.bytes_written);
+    out.counter("tr3_export_batches_total",        "Batches written to the export sink.",              l, stats_.batches_written);
+    out.counter("tr3_export_dropped_total",        "Tag records dropped (backpressure or unsent at stop).", l, dropped());
+    out.counter("tr3_export_write_failures_total", "Failed writes to the export sink (retried).",      l, stats_.write_failures);
+}
+
+} // namespace tr3
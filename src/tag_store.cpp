@@ -0,0 +1,545 @@
+// =============================================
+// src/tag_store.cpp
+// TR3シリーズ - タグ読取の組み込みストア実装
+//
+//  - 書き込み中のセグメントの列は INITIAL_ROWS 件から始めて、足りなくなったら伸ばす
+//    （segment_rows 件ぶんを最初から確保しない）。伸びると列が移動するので、
+//    push() のたびに列の先頭アドレス（Segment::time など）を付け直す。
+//    メモリのみのときは、閉じたセグメントの余った容量を shrink_to_fit で返す
+//  - 閉じたセグメントを dir へ書いたら、ファイルをマップして列のアドレスをそちらへ付け替え、
+//    ヒープ上の列を解放する（読み出しはどちらでも同じコード）
+//  - 索引の削除はしない（保持期間を過ぎた UID も LastSeen は残す）ので墓標・後方シフトは不要
+// =============================================
+
+#include "tr3/tag_store.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+#include "tr3/log.hpp"
+#include "tr3/metrics.hpp"   // write_file_atomic
+
+#ifdef _WIN32
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  ifndef NOMINMAX
+#    define NOMINMAX 1
+#  endif
+#  include <windows.h>
+#else
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+namespace tr3 {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char     MAGIC[8]    = { 'T', 'R', '3', 'S', 'E', 'G', 0, 0 };
+constexpr uint16_t VERSION     = 1;
+constexpr size_t   HEADER      = 64;
+constexpr uint32_t ORDER_MARK  = 0x01020304;
+constexpr char     EXTENSION[] = ".tr3seg";
+constexpr size_t   INITIAL_ROWS = 1024;   // 新しいセグメントの最初の容量（以降は倍々に伸ばす）
+
+// セグメントファイル内の各列の位置
+struct Layout {
+    size_t time, uid, reader, antenna, dsfid, total;
+};
+
+size_t align8(size_t v) { return (v + 7) & ~size_t{7}; }
+
+Layout layout_of(size_t rows) {
+    Layout l;
+    l.time    = HEADER;
+    l.uid     = l.time + 8 * rows;
+    l.reader  = l.uid + 8 * rows;
+    l.antenna = align8(l.reader + 4 * rows);
+    l.dsfid   = align8(l.antenna + rows);
+    l.total   = align8(l.dsfid + rows);
+    return l;
+}
+
+uint64_t mix(uint64_t x) {
+    // splitmix64 の最終段（TagCache と同じ）
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// ---------------------------------------------
+// 読み取り専用のメモリマップ（capture.cpp の CaptureReader と同じ手順）
+// ---------------------------------------------
+struct Mapping {
+    const uint8_t* base = nullptr;
+    size_t         size = 0;
+#ifdef _WIN32
+    void*          file = nullptr;   // HANDLE
+    void*          map  = nullptr;   // HANDLE
+#endif
+
+    Mapping() = default;
+    Mapping(const Mapping&) = delete;
+    Mapping& operator=(const Mapping&) = delete;
+    ~Mapping() { close(); }
+
+    void open(const std::string& path) {
+        close();
+#ifdef _WIN32
+        HANDLE f = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                               OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (f == INVALID_HANDLE_VALUE) throw TagStoreError("tag store: cannot open " + path);
+        LARGE_INTEGER sz{};
+        GetFileSizeEx(f, &sz);
+        size = static_cast<size_t>(sz.QuadPart);
+        file = f;
+        if (size > 0) {
+            HANDLE m = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!m) { close(); throw TagStoreError("tag store: cannot map " + path); }
+            map  = m;
+            base = static_cast<const uint8_t*>(MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0));
+            if (!base) { close(); throw TagStoreError("tag store: cannot map " + path); }
+        }
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw TagStoreError("tag store: cannot open " + path);
+        struct stat st{};
+        ::fstat(fd, &st);
+        size = static_cast<size_t>(st.st_size);
+        if (size > 0) {
+            void* p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) { ::close(fd); size = 0; throw TagStoreError("tag store: cannot map " + path); }
+            base = static_cast<const uint8_t*>(p);
+        }
+        ::close(fd);   // マップは fd を閉じても有効
+#endif
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (base) UnmapViewOfFile(base);
+        if (map)  CloseHandle(static_cast<HANDLE>(map));
+        if (file) CloseHandle(static_cast<HANDLE>(file));
+        map = file = nullptr;
+#else
+        if (base) ::munmap(const_cast<uint8_t*>(base), size);
+#endif
+        base = nullptr;
+        size = 0;
+    }
+};
+
+} // namespace
+
+// ---------------------------------------------
+// セグメント（列の先頭アドレスはヒープ上の列かマップのどちらかを指す）
+// ---------------------------------------------
+struct TagStore::Segment {
+    int64_t start_us = 0;                                   // 時間区切りの開始
+    int64_t min_us   = std::numeric_limits<int64_t>::max();
+    int64_t max_us   = std::numeric_limits<int64_t>::min();
+    size_t  rows     = 0;
+    bool    sorted   = true;                                // time 列が昇順
+
+    const int64_t*  time    = nullptr;
+    const uint64_t* uid     = nullptr;
+    const uint32_t* reader  = nullptr;
+    const uint8_t*  antenna = nullptr;
+    const uint8_t*  dsfid   = nullptr;
+
+    // 書き込み中・未保存の列
+    std::vector<int64_t>  c_time;
+    std::vector<uint64_t> c_uid;
+    std::vector<uint32_t> c_reader;
+    std::vector<uint8_t>  c_antenna;
+    std::vector<uint8_t>  c_dsfid;
+
+    Mapping     map;
+    std::string path;   // 保存済みならそのファイル
+
+    bool persisted() const { return map.base != nullptr; }
+
+    void reserve(size_t n) {
+        c_time.reserve(n);
+        c_uid.reserve(n);
+        c_reader.reserve(n);
+        c_antenna.reserve(n);
+        c_dsfid.reserve(n);
+        bind_heap();
+    }
+
+    // 列の先頭アドレスをヒープ上の列へ合わせる（列が伸びて移動したら呼び直す）
+    void bind_heap() {
+        time    = c_time.data();
+        uid     = c_uid.data();
+        reader  = c_reader.data();
+        antenna = c_antenna.data();
+        dsfid   = c_dsfid.data();
+    }
+
+    void push(const TagRecord& r, uint64_t u) {
+        if (rows > 0 && r.time_us < max_us) sorted = false;
+        c_time.push_back(r.time_us);
+        c_uid.push_back(u);
+        c_reader.push_back(r.reader);
+        c_antenna.push_back(r.antenna);
+        c_dsfid.push_back(r.dsfid);
+        bind_heap();                             // 伸びて移動したかもしれない
+        min_us = std::min(min_us, r.time_us);
+        max_us = std::max(max_us, r.time_us);
+        ++rows;
+    }
+
+    // 閉じたセグメント（メモリのみ）の余った容量を返す
+    void shrink() {
+        c_time.shrink_to_fit();
+        c_uid.shrink_to_fit();
+        c_reader.shrink_to_fit();
+        c_antenna.shrink_to_fit();
+        c_dsfid.shrink_to_fit();
+        bind_heap();
+    }
+
+    // マップしたファイルの列へ付け替える（ヒープ上の列は解放）
+    void bind_mapped() {
+        const Layout l = layout_of(rows);
+        time    = reinterpret_cast<const int64_t*>(map.base + l.time);
+        uid     = reinterpret_cast<const uint64_t*>(map.base + l.uid);
+        reader  = reinterpret_cast<const uint32_t*>(map.base + l.reader);
+        antenna = map.base + l.antenna;
+        dsfid   = map.base + l.dsfid;
+        std::vector<int64_t>().swap(c_time);
+        std::vector<uint64_t>().swap(c_uid);
+        std::vector<uint32_t>().swap(c_reader);
+        std::vector<uint8_t>().swap(c_antenna);
+        std::vector<uint8_t>().swap(c_dsfid);
+    }
+
+    // q の期間にかかる行の範囲 [i, end)。true = 範囲内の行はすべて期間内（時刻の確認が不要）
+    bool range(const Query& q, size_t& i, size_t& end) const {
+        i   = 0;
+        end = rows;
+        if (sorted) {
+            i   = static_cast<size_t>(std::lower_bound(time, time + rows, q.from_us) - time);
+            end = static_cast<size_t>(std::lower_bound(time + i, time + rows, q.to_us) - time);
+            return true;
+        }
+        return min_us >= q.from_us && max_us < q.to_us;
+    }
+};
+
+// ------------------------------------------------------------
+// 関数名 : TagStore
+// ------------------------------------------------------------
+TagStore::TagStore(Config cfg) : cfg_(std::move(cfg)), index_(256) {
+    if (cfg_.segment_span_us <= 0) cfg_.segment_span_us = 60'000'000;
+    if (cfg_.segment_rows == 0)    cfg_.segment_rows = 65536;
+    if (!cfg_.dir.empty()) load_dir();
+}
+
+TagStore::~TagStore() {
+    try { seal(); } catch (...) {}
+}
+
+// ------------------------------------------------------------
+// 関数名 : append
+// 概要   : 時間区切りを越えた（または満杯の）ときは新しいセグメントへ切り替える。
+//          過去の時刻の行は書き込み中のセグメントへそのまま入れる（sorted が外れる）
+// ------------------------------------------------------------
+void TagStore::append(const TagRecord& r) {
+    const int64_t span = cfg_.segment_span_us;
+    const bool    roll_needed = !active_ || r.time_us >= active_->start_us + span ||
+                                active_->rows >= cfg_.segment_rows;
+    if (roll_needed) {
+        const int64_t q = r.time_us / span - (r.time_us % span < 0 ? 1 : 0);   // 負の時刻も切り捨て
+        roll(q * span);
+    }
+    const uint64_t u = r.uid64();
+    active_->push(r, u);
+    index_update(u, r.time_us, r.reader, r.antenna, r.dsfid);
+
+    // 閉じたセグメントの保存は行を入れ終わってから（失敗しても今の行は失わない）。
+    // 古いセグメントを捨てるのは保存の後（まだ書いていないセグメントを捨てない）
+    if (roll_needed) {
+        if (!cfg_.dir.empty()) {
+            for (auto& s : segs_) {
+                if (s.get() != active_ && !s->persisted() && s->rows > 0) persist(*s);
+            }
+        }
+        enforce_retention();
+    }
+}
+
+// ------------------------------------------------------------
+// 関数名 : roll
+// 備考   : 列は必要に応じて伸ばす（segment_rows 件ぶんを最初から確保しない）。
+//          メモリのみのときは閉じたセグメントの余った容量を返す
+// ------------------------------------------------------------
+void TagStore::roll(int64_t start_us) {
+    if (active_ && cfg_.dir.empty()) active_->shrink();
+    auto s = std::make_unique<Segment>();
+    s->start_us = start_us;
+    s->reserve(std::min<size_t>(cfg_.segment_rows, INITIAL_ROWS));
+    active_ = s.get();
+    segs_.push_back(std::move(s));
+}
+
+// ------------------------------------------------------------
+// 関数名 : seal
+// ------------------------------------------------------------
+void TagStore::seal() {
+    if (active_ && active_->rows == 0) {
+        segs_.erase(std::find_if(segs_.begin(), segs_.end(), [&](const auto& s) { return s.get() == active_; }));
+    } else if (active_ && cfg_.dir.empty()) {
+        active_->shrink();
+    }
+    active_ = nullptr;
+    if (cfg_.dir.empty()) return;
+    for (auto& s : segs_) {
+        if (!s->persisted() && s->rows > 0) persist(*s);
+    }
+}
+
+// ------------------------------------------------------------
+// 関数名 : persist
+// 概要   : セグメントをファイルへ書き（一時ファイル → rename）、マップし直す
+// ------------------------------------------------------------
+void TagStore::persist(Segment& s) {
+    const Layout l = layout_of(s.rows);
+    std::string buf(l.total, '\0');
+    char* p = buf.data();
+    const uint32_t rows  = static_cast<uint32_t>(s.rows);
+    std::memcpy(p, MAGIC, sizeof(MAGIC));
+    std::memcpy(p + 8,  &VERSION, 2);
+    std::memcpy(p + 12, &rows, 4);
+    std::memcpy(p + 16, &s.min_us, 8);
+    std::memcpy(p + 24, &s.max_us, 8);
+    std::memcpy(p + 32, &ORDER_MARK, 4);
+    p[36] = s.sorted ? 1 : 0;
+    std::memcpy(p + l.time,    s.time,    8 * s.rows);
+    std::memcpy(p + l.uid,     s.uid,     8 * s.rows);
+    std::memcpy(p + l.reader,  s.reader,  4 * s.rows);
+    std::memcpy(p + l.antenna, s.antenna, s.rows);
+    std::memcpy(p + l.dsfid,   s.dsfid,   s.rows);
+
+    // seg-<最初の時刻（20桁）>.tr3seg。同じ名前があれば -1, -2, … を付ける
+    char name[64];
+    std::snprintf(name, sizeof(name), "seg-%020lld", static_cast<long long>(s.min_us));
+    std::string path = (fs::path(cfg_.dir) / (std::string(name) + EXTENSION)).string();
+    std::error_code ec;
+    for (int n = 1; fs::exists(path, ec); ++n) {
+        path = (fs::path(cfg_.dir) / (std::string(name) + "-" + std::to_string(n) + EXTENSION)).string();
+    }
+    if (!write_file_atomic(path, buf)) throw TagStoreError("tag store: cannot write " + path);
+
+    s.map.open(path);
+    s.path = path;
+    s.bind_mapped();
+}
+
+// ------------------------------------------------------------
+// 関数名 : load_dir
+// 概要   : dir の *.tr3seg をマップして読み込み、時刻順に並べて索引を作り直す
+// 備考   : 読めない・形式が違うファイルは <名前>.bad へ退避して読み飛ばす
+//          （壊れたファイル1つで起動できなくならないように）
+// ------------------------------------------------------------
+void TagStore::load_dir() {
+    std::error_code ec;
+    fs::create_directories(cfg_.dir, ec);
+    if (ec) throw TagStoreError("tag store: cannot create " + cfg_.dir + ": " + ec.message());
+
+    for (const auto& ent : fs::directory_iterator(cfg_.dir, ec)) {
+        if (!ent.is_regular_file() || ent.path().extension() != EXTENSION) continue;
+        const std::string path = ent.path().string();
+
+        auto s = std::make_unique<Segment>();
+        const uint8_t* b = nullptr;
+        uint16_t version = 0;
+        uint32_t rows = 0, order = 0;
+        std::string bad;
+        try {
+            s->map.open(path);
+            b = s->map.base;
+            if (s->map.size >= HEADER) {
+                std::memcpy(&version, b + 8, 2);
+                std::memcpy(&rows, b + 12, 4);
+                std::memcpy(&order, b + 32, 4);
+            }
+            if (s->map.size < HEADER || std::memcmp(b, MAGIC, sizeof(MAGIC)) != 0 || version != VERSION ||
+                order != ORDER_MARK || rows == 0 || s->map.size < layout_of(rows).total) {
+                bad = "not a TR3 segment file";
+            }
+        } catch (const TagStoreError& e) {
+            bad = e.what();
+        }
+        if (!bad.empty()) {
+            s.reset();                                // マップを閉じてから退避（Windows）
+            std::error_code rec;
+            fs::rename(path, path + ".bad", rec);
+            log::write(log::Level::WARN, "tag store: skipped " + path + " (" + bad + ")" +
+                                         (rec ? "" : ", moved to .bad"));
+            continue;
+        }
+        s->rows   = rows;
+        s->sorted = b[36] != 0;
+        std::memcpy(&s->min_us, b + 16, 8);
+        std::memcpy(&s->max_us, b + 24, 8);
+        const int64_t span = cfg_.segment_span_us;
+        s->start_us = (s->min_us / span - (s->min_us % span < 0 ? 1 : 0)) * span;
+        s->path     = path;
+        s->bind_mapped();
+        segs_.push_back(std::move(s));
+    }
+    if (ec) throw TagStoreError("tag store: cannot read " + cfg_.dir + ": " + ec.message());
+
+    std::stable_sort(segs_.begin(), segs_.end(), [](const auto& a, const auto& b) { return a->min_us < b->min_us; });
+    enforce_retention();
+    for (const auto& s : segs_) {
+        for (size_t i = 0; i < s->rows; ++i) index_update(s->uid[i], s->time[i], s->reader[i], s->antenna[i], s->dsfid[i]);
+    }
+}
+
+// ------------------------------------------------------------
+// 関数名 : enforce_retention
+// 概要   : 閉じたセグメントが max_segments を超えた分を古い順に捨てる（書き込み中のものは数えない）
+// ------------------------------------------------------------
+void TagStore::enforce_retention() {
+    if (cfg_.max_segments == 0) return;
+    while (segs_.size() - (active_ ? 1 : 0) > cfg_.max_segments && segs_.front().get() != active_) {
+        const std::string path = segs_.front()->path;
+        segs_.erase(segs_.begin());   // マップを閉じてから消す（Windows はマップ中のファイルを消せない）
+        if (!path.empty()) {
+            std::error_code ec;
+            fs::remove(path, ec);
+        }
+    }
+}
+
+// ------------------------------------------------------------
+// 索引（UID → LastSeen）
+// ------------------------------------------------------------
+void TagStore::index_update(uint64_t uid, int64_t t, uint32_t reader, uint8_t antenna, uint8_t dsfid) {
+    if ((index_size_ + 1) * 2 > index_.size()) index_grow();
+    const size_t mask = index_.size() - 1;
+    size_t i = static_cast<size_t>(mix(uid)) & mask;
+    while (index_[i].reads != 0 && index_[i].uid != uid) i = (i + 1) & mask;
+
+    LastSeen& e = index_[i];
+    if (e.reads == 0) {
+        e.uid      = uid;
+        e.first_us = t;
+        e.last_us  = t;
+        ++index_size_;
+    }
+    ++e.reads;
+    if (t < e.first_us) e.first_us = t;
+    if (t >= e.last_us) {
+        e.last_us = t;
+        e.reader  = reader;
+        e.antenna = antenna;
+        e.dsfid   = dsfid;
+    }
+}
+
+void TagStore::index_grow() {
+    std::vector<LastSeen> old(index_.size() * 2);
+    old.swap(index_);
+    const size_t mask = index_.size() - 1;
+    for (const auto& e : old) {
+        if (e.reads == 0) continue;
+        size_t i = static_cast<size_t>(mix(e.uid)) & mask;
+        while (index_[i].reads != 0) i = (i + 1) & mask;
+        index_[i] = e;
+    }
+}
+
+const TagStore::LastSeen* TagStore::last_seen(uint64_t uid) const {
+    const size_t mask = index_.size() - 1;
+    size_t i = static_cast<size_t>(mix(uid)) & mask;
+    while (index_[i].reads != 0) {
+        if (index_[i].uid == uid) return &index_[i];
+        i = (i + 1) & mask;
+    }
+    return nullptr;
+}
+
+std::vector<TagStore::LastSeen> TagStore::seen_between(int64_t from_us, int64_t to_us) const {
+    std::vector<LastSeen> out;
+    for (const auto& e : index_) {
+        if (e.reads != 0 && e.last_us >= from_us && e.last_us < to_us) out.push_back(e);
+    }
+    return out;
+}
+
+// ------------------------------------------------------------
+// 関数名 : scan
+// 概要   : 条件に合う行ごとに fn(segment, row) を呼ぶ（fn が false で打ち切り）
+// ------------------------------------------------------------
+template <typename Fn>
+void TagStore::scan(const Query& q, Fn&& fn) const {
+    if (q.from_us >= q.to_us) return;
+    for (const auto& sp : segs_) {
+        const Segment& s = *sp;
+        if (s.rows == 0 || s.max_us < q.from_us || s.min_us >= q.to_us) continue;
+        size_t i, end;
+        const bool in_time = s.range(q, i, end);
+        for (; i < end; ++i) {
+            if (!in_time && (s.time[i] < q.from_us || s.time[i] >= q.to_us)) continue;
+            if (q.uid && s.uid[i] != *q.uid) continue;
+            if (q.antenna >= 0 && s.antenna[i] != q.antenna) continue;
+            if (q.reader >= 0 && s.reader[i] != static_cast<uint64_t>(q.reader)) continue;
+            if (!fn(s, i)) return;
+        }
+    }
+}
+
+size_t TagStore::count(const Query& q) const {
+    size_t n = 0;
+    if (!q.uid && q.antenna < 0 && q.reader < 0) {
+        // 期間だけなら、範囲がそのまま件数になるセグメントは行を読まない
+        if (q.from_us >= q.to_us) return 0;
+        for (const auto& sp : segs_) {
+            const Segment& s = *sp;
+            if (s.rows == 0 || s.max_us < q.from_us || s.min_us >= q.to_us) continue;
+            size_t i, end;
+            if (s.range(q, i, end)) { n += end - i; continue; }
+            for (; i < end; ++i) n += (s.time[i] >= q.from_us && s.time[i] < q.to_us) ? 1 : 0;
+        }
+        return n;
+    }
+    scan(q, [&](const Segment&, size_t) { ++n; return true; });
+    return n;
+}
+
+size_t TagStore::select(const Query& q, std::vector<TagRecord>& out, size_t limit) const {
+    size_t n = 0;
+    if (limit == 0) return 0;
+    scan(q, [&](const Segment& s, size_t i) {
+        TagRecord r;
+        r.time_us = s.time[i];
+        r.reader  = s.reader[i];
+        r.antenna = s.antenna[i];
+        r.dsfid   = s.dsfid[i];
+        for (int k = 0; k < 8; ++k) r.uid[k] = static_cast<uint8_t>(s.uid[i] >> (8 * k));
+        out.push_back(r);
+        return ++n < limit;
+    });
+    return n;
+}
+
+size_t TagStore::rows() const {
+    size_t n = 0;
+    for (const auto& s : segs_) n += s->rows;
+    return n;
+}
+
+} // namespace tr3
@@ -0,0 +1,215 @@
+// =============================================
+// src/tag_writer.cpp
+// TR3シリーズ - タグ読取結果のストリーム出力実装
+//
+//  - テキストは snprintf を使わず、内部バッファへ直接数字・16進を書き込む
+//  - 時刻の「年〜秒」は秒が変わったときだけ gmtime で作り直す（log.cpp と同じ考え方）
+//  - バイナリはバイト単位で組み立てる（ホストのエンディアンに依存しない。capture.cpp と同じ）
+// =============================================
+
+#include "tr3/tag_writer.hpp"
+
+#include <cstring>
+#include <ctime>
+
+#ifdef _WIN32
+#  include <fcntl.h>
+#  include <io.h>
+#endif
+
+namespace tr3 {
+
+namespace {
+
+constexpr char MAGIC[8] = { 'T', 'R', '3', 'T', 'A', 'G', 0, 0 };
+const char     HEX[]    = "0123456789ABCDEF";
+
+void put_le(std::vector<char>& out, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) out.push_back(static_cast<char>(static_cast<uint8_t>(v >> (8 * i))));
+}
+
+void put_uint(std::vector<char>& out, uint64_t v) {
+    char tmp[20];
+    int  n = 0;
+    do { tmp[n++] = static_cast<char>('0' + v % 10); v /= 10; } while (v);
+    while (n) out.push_back(tmp[--n]);
+}
+
+void put_str(std::vector<char>& out, const char* s) {
+    out.insert(out.end(), s, s + std::strlen(s));
+}
+
+} // namespace
+
+std::optional<TagFormat> parse_tag_format(std::string_view name) {
+    if (name == "ndjson" || name == "json")  return TagFormat::NDJSON;
+    if (name == "csv")                       return TagFormat::CSV;
+    if (name == "binary" || name == "bin")   return TagFormat::BINARY;
+    return std::nullopt;
+}
+
+TagWriter::~TagWriter() {
+    try { close(); } catch (...) {}
+}
+
+// ------------------------------------------------------------
+// 関数名 : open
+// ------------------------------------------------------------
+void TagWriter::open(const std::string& path, TagFormat fmt, size_t flush_bytes, int flush_ms) {
+    close();
+    enc_         = TagEncoder(fmt);
+    flush_bytes_ = flush_bytes ? flush_bytes : 1;
+    flush_ms_    = flush_ms;
+    records_     = 0;
+    buf_.clear();
+    buf_.reserve(flush_bytes_ + 256);
+
+    long len = 0;
+    if (path == "-") {
+        fp_      = stdout;
+        owns_fp_ = false;
+#ifdef _WIN32
+        if (fmt == TagFormat::BINARY) _setmode(_fileno(stdout), _O_BINARY);   // 0x0A → 0x0D 0x0A 変換を止める
+#endif
+    } else {
+        fp_ = std::fopen(path.c_str(), fmt == TagFormat::BINARY ? "ab+" : "ab");
+        if (!fp_) throw TagWriterError("tag writer: cannot open " + path);
+        owns_fp_ = true;
+        std::fseek(fp_, 0, SEEK_END);
+        len = std::ftell(fp_);
+    }
+
+    if (fmt == TagFormat::BINARY) {
+        if (len > 0) {
+            // 既存ファイルは形式を確認してから追記
+            char head[TAGFILE_HEADER] = {};
+            std::fseek(fp_, 0, SEEK_SET);
+            const bool ok = std::fread(head, 1, sizeof(head), fp_) == sizeof(head) &&
+                            std::memcmp(head, MAGIC, sizeof(MAGIC)) == 0;
+            std::fseek(fp_, 0, SEEK_END);
+            if (!ok) {
+                std::fclose(fp_);
+                fp_ = nullptr;
+                throw TagWriterError("tag writer: not a TR3 tag file: " + path);
+            }
+        } else {
+            enc_.header(buf_);
+        }
+    } else if (len == 0) {
+        enc_.header(buf_);
+    }
+    if (!buf_.empty()) flush();
+}
+
+void TagWriter::close() {
+    if (!fp_) return;
+    flush();
+    if (owns_fp_) std::fclose(fp_);
+    fp_ = nullptr;
+}
+
+// ------------------------------------------------------------
+// 関数名 : write
+// ------------------------------------------------------------
+void TagWriter::write(const TagRecord& r) {
+    if (!fp_) return;
+    if (buf_.empty()) first_pending_ = clock::now();
+    enc_.append(r, buf_);
+    ++records_;
+    if (buf_.size() >= flush_bytes_) flush();
+}
+
+void TagWriter::poll(clock::time_point now) {
+    if (!fp_ || buf_.empty()) return;
+    if (now - first_pending_ >= std::chrono::milliseconds(flush_ms_)) flush();
+}
+
+void TagWriter::flush() {
+    if (!fp_) return;
+    if (!buf_.empty()) {
+        const size_t want = buf_.size();
+        const size_t n    = std::fwrite(buf_.data(), 1, want, fp_);
+        buf_.clear();
+        if (n == want && std::fflush(fp_) == 0) return;
+        throw TagWriterError("tag writer: write failed");
+    }
+    std::fflush(fp_);
+}
+
+// ====================================================================
+// TagEncoder
+// ====================================================================
+void TagEncoder::header(std::vector<char>& out) const {
+    if (fmt_ == TagFormat::BINARY) {
+        out.insert(out.end(), MAGIC, MAGIC + sizeof(MAGIC));
+        put_le(out, TAGFILE_VERSION, 2);
+        put_le(out, TAGFILE_RECORD, 2);
+        put_le(out, 0, 4);
+    } else if (fmt_ == TagFormat::CSV) {
+        put_str(out, "ts,reader,antenna,dsfid,uid\n");
+    }
+}
+
+void TagEncoder::append(const TagRecord& r, std::vector<char>& out) {
+    if (fmt_ == TagFormat::BINARY) append_binary(r, out);
+    else                           append_text(r, out);
+}
+
+// ------------------------------------------------------------
+// 関数名 : append_time
+// ------------------------------------------------------------
+void TagEncoder::append_time(int64_t time_us, std::vector<char>& out) {
+    int64_t sec = time_us / 1000000;
+    int64_t us  = time_us % 1000000;
+    if (us < 0) { us += 1000000; --sec; }
+    if (sec != last_sec_) {
+        const std::time_t t = static_cast<std::time_t>(sec);
+        std::tm tm{};
+#if defined(_WIN32)
+        gmtime_s(&tm, &t);
+#else
+        gmtime_r(&t, &tm);
+#endif
+        std::strftime(sec_text_, sizeof(sec_text_), "%Y-%m-%dT%H:%M:%S", &tm);
+        last_sec_ = sec;
+    }
+    put_str(out, sec_text_);
+    char frac[8] = { '.', 0, 0, 0, 0, 0, 0, 'Z' };
+    for (int i = 6; i >= 1; --i) { frac[i] = static_cast<char>('0' + us % 10); us /= 10; }
+    out.insert(out.end(), frac, frac + sizeof(frac));
+}
+
+// ------------------------------------------------------------
+// 関数名 : append_text（NDJSON / CSV）
+// ------------------------------------------------------------
+void TagEncoder::append_text(const TagRecord& r, std::vector<char>& out) {
+    const bool json = fmt_ == TagFormat::NDJSON;
+    put_str(out, json ? "{\"ts\":\"" : "");
+    append_time(r.time_us, out);
+    put_str(out, json ? "\",\"reader\":" : ",");
+    put_uint(out, r.reader);
+    put_str(out, json ? ",\"antenna\":" : ",");
+    put_uint(out, r.antenna);
+    put_str(out, json ? ",\"dsfid\":" : ",");
+    put_uint(out, r.dsfid);
+    put_str(out, json ? ",\"uid\":\"" : ",");
+    for (int i = 7; i >= 0; --i) {   // 表示順（MSB → LSB）
+        out.push_back(HEX[r.uid[i] >> 4]);
+        out.push_back(HEX[r.uid[i] & 0x0F]);
+    }
+    put_str(out, json ? "\"}\n" : "\n");
+}
+
+// ------------------------------------------------------------
+// 関数名 : append_binary
+// ------------------------------------------------------------
+void TagEncoder::append_binary(const TagRecord& r, std::vector<char>& out) const {
+    put_le(out, static_cast<uint64_t>(r.time_us), 8);
+    put_le(out, r.reader, 4);
+    out.push_back(static_cast<char>(r.antenna));
+    out.push_back(static_cast<char>(r.dsfid));
+    put_le(out, 0, 2);
+    out.insert(out.end(), r.uid.begin(), r.uid.end());
+}
+
+} // namespace tr3
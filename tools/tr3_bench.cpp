@@ -0,0 +1,640 @@
+// =============================================
+// tools/tr3_bench.cpp
+// TR3シリーズ リーダライタ：ベンチマーク
+// =============================================
+// プロトコル層とクライアントの性能を測り、数値で比較できるようにする。
+//
+//   1) Parser::push / Parser::feed … 正常ストリーム／ノイズ混入ストリームの解析速度
+//   2) Frame::encode / calc_sum    … 送信フレーム生成と SUM 計算のコスト
+//                                    （STX 探索カーネル simd::find_byte と memchr の比較を含む）
+//   3) SpscQueue / MpscQueue       … タグレコードのスレッド間受け渡し速度
+//   4) TagStore                    … 読取の追加・UID 索引の参照・期間の件数
+//   5) TagExporter                 … 送り先が遅い／止まっているときの SinkPolicy ごとの
+//                                    publish() の最長待ちと件数の帳尻（書けた + 捨てた = 積んだ）
+//   6) Client::transact            … ループバック上の往復遅延（p50 / p99）
+//   7) Inventory（transact + receive_only × N）… 1サイクルの所要時間
+//   8) 切替 + Inventory + ブザー   … transact を順に呼ぶ場合と transact_batch（send 1回）の比較
+//   9) InventoryStream             … 連続 Inventory のサイクル速度
+//
+// 5) 以外の各項目で「1フレームあたりのヒープ確保回数」も表示する
+// （この翻訳単位で operator new を置き換えて数える）。
+// 5) で帳尻が合わなければ終了コード 1 を返す。
+//
+// 使い方：
+//   tr3_bench [--iterations 200000] [--rtt-iterations 2000] [--tags 10]
+//             [--host 127.0.0.1 --port 9004]   ← 外部の tr3_sim を使う場合
+//
+// --port 未指定時はプロセス内に簡易応答スレッド（ループバック）を立てる。
+// フレームダンプ（log.hpp の Level::FRAME）は既定どおり無効のまま測る。
+// =============================================
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <atomic>
+#include <algorithm>
+#include <initializer_list>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+
+#include "tr3/client.hpp"
+#include "tr3/command_batch.hpp"
+#include "tr3/async_client.hpp"
+#include "tr3/inventory_stream.hpp"
+#include "tr3/net.hpp"
+#include "tr3/protocol.hpp"
+#include "tr3/simd.hpp"
+#include "tr3/tag_sink.hpp"
+#include "tr3/tag_store.hpp"
+#include "tr3/tag_queue.hpp"
+
+// ---------------------------------------------
+// ヒープ確保回数の計数
+// ---------------------------------------------
+static std::atomic<uint64_t> g_allocs{0};
+
+// GCC は malloc/free で置き換えた operator new/delete の組をインライン展開後に誤検知する
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t n) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+using namespace tr3;
+using bclock = std::chrono::steady_clock;
+
+struct BenchConfig {
+    uint64_t    iterations     = 200000;
+    int         rtt_iterations = 2000;
+    int         tags           = 10;
+    std::string host           = "127.0.0.1";
+    uint16_t    port           = 0;          // 0 = プロセス内応答スレッド
+};
+
+// 計算結果を使ったことにして、最適化でループごと消されないようにする
+// （フレーム長のような定数だけを sink に足すと、生成処理そのものが畳み込まれる）
+template <class T>
+inline void do_not_optimize(const T& v) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r"(&v) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &v;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+double seconds_since(bclock::time_point t0) {
+    return std::chrono::duration<double>(bclock::now() - t0).count();
+}
+
+void print_row(const std::string& name, double per_sec, const std::string& unit, double allocs_per_op) {
+    std::cout << "  " << std::left << std::setw(34) << name
+              << std::right << std::setw(14) << std::fixed << std::setprecision(0) << per_sec << " " << std::setw(10) << std::left << unit
+              << std::right << "  allocs/op " << std::setprecision(2) << allocs_per_op << "\n";
+}
+
+void print_latency(const std::string& name, std::vector<double>& us, double allocs_per_op) {
+    if (us.empty()) return;
+    std::sort(us.begin(), us.end());
+    auto pct = [&](double p) { return us[std::min(us.size() - 1, static_cast<size_t>(p * static_cast<double>(us.size())))]; };
+    std::cout << "  " << std::left << std::setw(34) << name << std::right << std::fixed << std::setprecision(1)
+              << "p50 " << std::setw(8) << pct(0.50) << " us  p99 " << std::setw(8) << pct(0.99)
+              << " us  max " << std::setw(8) << us.back() << " us  allocs/op " << std::setprecision(2) << allocs_per_op << "\n";
+}
+
+// ---------------------------------------------
+// テスト用ストリーム生成
+//  noisy = true でフレーム間に 0〜7 バイトのゴミ（STX を含まない）を挟む
+// ---------------------------------------------
+std::vector<uint8_t> make_stream(size_t frames, bool noisy, size_t& out_frames) {
+    std::mt19937 rng(7);
+    std::vector<uint8_t> s;
+    out_frames = 0;
+    for (size_t i = 0; i < frames; ++i) {
+        Frame f; f.cmd = RES_TAG;
+        f.data = { 0x00, uint8_t(i), uint8_t(i >> 8), uint8_t(i >> 16), 0, 0, 0x01, 0x04, 0xE0 };
+        const auto b = f.encode();
+        s.insert(s.end(), b.begin(), b.end());
+        ++out_frames;
+        if (noisy) {
+            const int g = static_cast<int>(rng() % 8);
+            for (int k = 0; k < g; ++k) {
+                uint8_t c = static_cast<uint8_t>(rng());
+                if (c == STX) c = 0xFF;
+                s.push_back(c);
+            }
+        }
+    }
+    return s;
+}
+
+// ---------------------------------------------
+// 1) Parser
+// ---------------------------------------------
+void bench_parser(const BenchConfig& cfg) {
+    std::cout << "[Parser]\n";
+    for (bool noisy : { false, true }) {
+        size_t nframes = 0;
+        const auto s = make_stream(static_cast<size_t>(std::min<uint64_t>(cfg.iterations, 1000000)), noisy, nframes);
+        const std::string tag = noisy ? " (noisy)" : " (clean)";
+
+        {   // push（1バイトずつ）+ take_raw
+            Parser p;
+            size_t got = 0;
+            const uint64_t a0 = g_allocs;
+            const auto t0 = bclock::now();
+            for (uint8_t b : s) {
+                if (!p.push(b)) continue;
+                do { auto raw = p.take_raw(); got += raw.empty() ? 0 : 1; } while (p.resume());
+            }
+            const double sec = seconds_since(t0);
+            print_row("push+take_raw" + tag, static_cast<double>(got) / sec, "frames/s",
+                      static_cast<double>(g_allocs - a0) / static_cast<double>(got ? got : 1));
+        }
+        {   // feed（バッファ一括・ビュー）
+            Parser p;
+            size_t got = 0;
+            const uint64_t a0 = g_allocs;
+            const auto t0 = bclock::now();
+            ByteView in(s.data(), s.size());
+            for (;;) {
+                FrameView fv;
+                const auto r = p.feed(in, fv);
+                if (r.frame) ++got;
+                in = ByteView(in.data() + r.consumed, in.size() - r.consumed);
+                if (!r.frame && in.empty()) break;
+            }
+            const double sec = seconds_since(t0);
+            print_row("feed" + tag, static_cast<double>(got) / sec, "frames/s",
+                      static_cast<double>(g_allocs - a0) / static_cast<double>(got ? got : 1));
+            std::cout << "  " << std::left << std::setw(34) << ("feed" + tag) << std::right << std::setw(14)
+                      << std::setprecision(1) << static_cast<double>(s.size()) / sec / 1e6 << " MB/s\n";
+        }
+    }
+}
+
+// ---------------------------------------------
+// 2) Frame::encode / calc_sum
+// ---------------------------------------------
+void bench_encode(const BenchConfig& cfg) {
+    std::cout << "[Frame] simd=" << simd::kernel_name() << "\n";
+    volatile size_t sink = 0;
+    {
+        const uint64_t a0 = g_allocs;
+        const auto t0 = bclock::now();
+        for (uint64_t i = 0; i < cfg.iterations; ++i) sink = sink + cmd::inventory2().size();
+        const double sec = seconds_since(t0);
+        print_row("cmd::inventory2 (encode)", static_cast<double>(cfg.iterations) / sec, "ops/s",
+                  static_cast<double>(g_allocs - a0) / static_cast<double>(cfg.iterations));
+    }
+    {
+        FrameBuffer fb;
+        volatile uint8_t first_ant = 0;         // 実行時の値（コンパイル時に分からない）
+        const uint8_t base = first_ant;
+        const uint64_t a0 = g_allocs;
+        const auto t0 = bclock::now();
+        for (uint64_t i = 0; i < cfg.iterations; ++i) {
+            cmd::switch_antenna(fb, static_cast<uint8_t>((base + i) & 3));
+            do_not_optimize(fb);
+        }
+        const double sec = seconds_since(t0);
+        print_row("cmd::switch_antenna (FrameBuffer)", static_cast<double>(cfg.iterations) / sec, "ops/s",
+                  static_cast<double>(g_allocs - a0) / static_cast<double>(cfg.iterations));
+    }
+    for (size_t len : { size_t(8), size_t(262) }) {
+        std::vector<uint8_t> buf(len, 0x5A);
+        const uint64_t a0 = g_allocs;
+        const auto t0 = bclock::now();
+        for (uint64_t i = 0; i < cfg.iterations; ++i) {
+            buf[0] = static_cast<uint8_t>(i);
+            sink = sink + Frame::calc_sum(ByteView(buf));
+        }
+        const double sec = seconds_since(t0);
+        print_row("calc_sum (" + std::to_string(len) + " B)", static_cast<double>(cfg.iterations) / sec, "ops/s",
+                  static_cast<double>(g_allocs - a0) / static_cast<double>(cfg.iterations));
+    }
+    {
+        // STX を含まないゴミ 4 KiB の末尾に STX（再同期で最も長く走査する形）
+        std::vector<uint8_t> garbage(4096);
+        std::mt19937 rng(7);
+        for (auto& b : garbage) {
+            b = static_cast<uint8_t>(rng());
+            if (b == STX) b = 0x00;
+        }
+        garbage.back() = STX;
+        const uint64_t n = std::max<uint64_t>(1, cfg.iterations / 16);
+
+        auto t0 = bclock::now();
+        for (uint64_t i = 0; i < n; ++i) {
+            sink = sink + static_cast<size_t>(simd::find_byte(garbage.data(), garbage.size(), STX) - garbage.data());
+        }
+        double sec = seconds_since(t0);
+        print_row("find_byte STX (4 KiB)", static_cast<double>(n) * 4096.0 / sec / 1e6, "MB/s", 0.0);
+
+        t0 = bclock::now();
+        for (uint64_t i = 0; i < n; ++i) {
+            sink = sink + static_cast<size_t>(static_cast<const uint8_t*>(std::memchr(garbage.data(), STX, garbage.size())) - garbage.data());
+        }
+        sec = seconds_since(t0);
+        print_row("memchr STX (4 KiB, reference)", static_cast<double>(n) * 4096.0 / sec / 1e6, "MB/s", 0.0);
+    }
+    (void)sink;
+}
+
+// ---------------------------------------------
+// 3) タグキュー（書き込みスレッド → 読み出し1スレッド、pop_batch で 256 件ずつ）
+// ---------------------------------------------
+template <typename Q>
+double queue_rate(Q& q, int producers, uint64_t per_producer) {
+    std::vector<std::thread> th;
+    const auto t0 = bclock::now();
+    for (int p = 0; p < producers; ++p) {
+        th.emplace_back([&, p] {
+            TagRecord r;
+            r.reader = static_cast<uint32_t>(p);
+            for (uint64_t i = 0; i < per_producer; ) {
+                r.time_us = static_cast<int64_t>(i);
+                if (q.try_push(r)) ++i;
+                else std::this_thread::yield();
+            }
+        });
+    }
+    const uint64_t total = per_producer * static_cast<uint64_t>(producers);
+    std::vector<TagRecord> buf(256);
+    uint64_t got = 0;
+    volatile uint64_t sum = 0;
+    while (got < total) {
+        const size_t n = q.pop_batch(buf.data(), buf.size());
+        for (size_t i = 0; i < n; ++i) sum = sum + static_cast<uint64_t>(buf[i].time_us);
+        got += n;
+    }
+    for (auto& t : th) t.join();
+    return static_cast<double>(total) / seconds_since(t0);
+}
+
+void bench_queue(const BenchConfig& cfg) {
+    std::cout << "[TagQueue]\n";
+    const uint64_t n = std::max<uint64_t>(cfg.iterations, 100000) * 10;
+    {
+        auto q = std::make_unique<SpscQueue<TagRecord, 4096>>();
+        const uint64_t a0 = g_allocs;
+        const double rate = queue_rate(*q, 1, n);
+        print_row("SpscQueue (1 -> 1)", rate, "records/s", static_cast<double>(g_allocs - a0) / static_cast<double>(n));
+    }
+    {
+        auto q = std::make_unique<TagQueue>();
+        const uint64_t a0 = g_allocs;
+        const double rate = queue_rate(*q, 4, n / 4);
+        print_row("MpscQueue (4 -> 1)", rate, "records/s", static_cast<double>(g_allocs - a0) / static_cast<double>(n));
+    }
+}
+
+// ---------------------------------------------
+// 4) タグストア（1ms ごとに 1000 種類の UID を順に読む想定。メモリのみ）
+// ---------------------------------------------
+void bench_store(const BenchConfig& cfg) {
+    std::cout << "[TagStore]\n";
+    const uint64_t n = std::max<uint64_t>(cfg.iterations, 100000) * 5;
+    TagStore store;
+    TagRecord r;
+    {
+        const uint64_t a0 = g_allocs;
+        const auto t0 = bclock::now();
+        for (uint64_t i = 0; i < n; ++i) {
+            r.time_us = static_cast<int64_t>(i) * 1000;
+            r.antenna = static_cast<uint8_t>(i & 3);
+            r.uid[0]  = static_cast<uint8_t>(i % 1000);
+            r.uid[1]  = static_cast<uint8_t>((i % 1000) >> 8);
+            r.uid[7]  = 0xE0;
+            store.append(r);
+        }
+        print_row("TagStore::append", static_cast<double>(n) / seconds_since(t0), "records/s",
+                  static_cast<double>(g_allocs - a0) / static_cast<double>(n));
+    }
+    {
+        volatile uint64_t sum = 0;
+        const uint64_t a0 = g_allocs;
+        const auto t0 = bclock::now();
+        for (uint64_t i = 0; i < n; ++i) {
+            if (const auto* e = store.last_seen(0xE000000000000000ULL | (i % 1000))) sum = sum + e->reads;
+        }
+        print_row("TagStore::last_seen", static_cast<double>(n) / seconds_since(t0), "lookups/s",
+                  static_cast<double>(g_allocs - a0) / static_cast<double>(n));
+    }
+    {
+        // 直近 5 秒（5000 件）の ANT#1 の件数
+        const int q_n = 2000;
+        volatile size_t sum = 0;
+        TagStore::Query q;
+        q.antenna = 1;
+        const uint64_t a0 = g_allocs;
+        const auto t0 = bclock::now();
+        for (int i = 0; i < q_n; ++i) {
+            q.to_us   = static_cast<int64_t>(n - static_cast<uint64_t>(i)) * 1000;
+            q.from_us = q.to_us - 5'000'000;
+            sum = sum + store.count(q);
+        }
+        print_row("TagStore::count (5 s window)", static_cast<double>(q_n) / seconds_since(t0), "queries/s",
+                  static_cast<double>(g_allocs - a0) / static_cast<double>(q_n));
+    }
+}
+
+// ---------------------------------------------
+// プロセス内の簡易応答スレッド（ループバック）
+//  ACK を返し、Inventory2 には ACK [F0 NN] + タグ × NN を返す
+// ---------------------------------------------
+class Responder {
+public:
+    explicit Responder(int tags) : tags_(tags) {
+        ls_   = net::listen_tcp("127.0.0.1", 0);
+        port_ = net::local_port(ls_);
+        th_   = std::thread([this] { run(); });
+    }
+    ~Responder() {
+        stop_ = true;
+        th_.join();
+        net::close_socket(ls_);
+    }
+    uint16_t port() const { return port_; }
+
+private:
+    void run() {
+        std::vector<net::socket_t> conns;
+        std::vector<Parser> parsers;
+        std::vector<uint8_t> rx(8192);
+        std::vector<uint8_t> out;   // 応答（使い回す。疑似リーダ側の確保を allocs/op に混ぜない）
+        out.reserve(8192);
+        while (!stop_) {
+            net::socket_t c = net::accept_tcp(ls_, 0);
+            if (c != net::INVALID_SOCK) { conns.push_back(c); parsers.emplace_back(); }
+            bool idle = true;
+            for (size_t i = 0; i < conns.size(); ++i) {
+                if (conns[i] == net::INVALID_SOCK) continue;
+                const long n = net::recv_some(conns[i], rx.data(), rx.size());
+                if (n == 0) { net::close_socket(conns[i]); continue; }
+                if (n < 0) continue;
+                idle = false;
+                out.clear();
+                ByteView in(rx.data(), static_cast<size_t>(n));
+                for (;;) {
+                    FrameView fv;
+                    const auto r = parsers[i].feed(in, fv);
+                    if (r.frame) answer(fv.cmd, out);
+                    in = ByteView(in.data() + r.consumed, in.size() - r.consumed);
+                    if (!r.frame && in.empty()) break;
+                }
+                if (!out.empty()) net::send_all(conns[i], out.data(), out.size(), 1000);
+            }
+            if (idle) {
+                // 受信待ち（接続が無い/静かなときだけ短く眠る）
+                std::this_thread::sleep_for(std::chrono::microseconds(conns.empty() ? 1000 : 20));
+            }
+        }
+        for (auto& c : conns) net::close_socket(c);
+    }
+
+    void answer(uint8_t cmd, std::vector<uint8_t>& out) {
+        FrameBuffer fb;
+        auto put = [&](uint8_t c, std::initializer_list<uint8_t> d) {
+            fb.assign(0x00, c, ByteView(d.begin(), d.size()));
+            out.insert(out.end(), fb.data(), fb.data() + fb.size());
+        };
+        if (cmd != CMD_INVENTORY2) { put(RES_ACK, { 0x00 }); return; }
+        put(RES_ACK, { 0xF0, static_cast<uint8_t>(tags_) });
+        for (int k = 0; k < tags_; ++k) put(RES_TAG, { 0x00, uint8_t(k), 0, 0, 0, 0, 0x01, 0x04, 0xE0 });
+    }
+
+    int                tags_;
+    net::socket_t      ls_ = net::INVALID_SOCK;
+    uint16_t           port_ = 0;
+    std::atomic<bool>  stop_{false};
+    std::thread        th_;
+};
+
+// ---------------------------------------------
+// 5) タグ送出（送り先が遅い／止まっているときの SinkPolicy ごとの振る舞い）
+//    読取側は 0.5 秒間、約 1ms ごとに 200 件を publish() する（20 万件/秒 ≒ NDJSON で 20 MB/s）。
+//    遅い送り先は 10 MB/s でしか書けず、止まっている送り先は書き込みが常に失敗する
+// ---------------------------------------------
+class BenchSink : public SinkTransport {
+public:
+    explicit BenchSink(bool dead) : dead_(dead) {}
+
+    bool ready(clock::time_point) override { return true; }
+    bool at_start() const override { return !started_; }
+    bool write(const char*, size_t n) override {
+        if (dead_) return false;
+        std::this_thread::sleep_for(std::chrono::microseconds(n / 10));   // 10 MB/s
+        started_ = true;
+        return true;
+    }
+    void close() override {}
+    std::string describe() const override { return dead_ ? "bench:dead" : "bench:slow"; }
+
+private:
+    bool dead_;
+    bool started_ = false;
+};
+
+// 1つの組み合わせを流し、stop() の後に「積んだ件数 = 書けた件数 + dropped()」か確かめる
+bool bench_export_one(bool dead, SinkPolicy policy, const char* policy_name) {
+    ExportConfig ec;
+    ec.batch_bytes       = 16 * 1024;
+    ec.flush_ms          = 20;
+    ec.max_pending_bytes = 256 * 1024;
+    ec.policy            = policy;
+    TagExporter ex(std::make_unique<BenchSink>(dead), ec);
+
+    TagRecord r;
+    r.uid[7] = 0xE0;
+    uint64_t published = 0;
+    double   worst_us  = 0.0;
+    const auto t0 = bclock::now();
+    while (seconds_since(t0) < 0.5) {
+        for (int i = 0; i < 200; ++i) {
+            r.time_us = static_cast<int64_t>(published);
+            const auto p0 = bclock::now();
+            ex.publish(r);
+            worst_us = std::max(worst_us, seconds_since(p0) * 1e6);
+            ++published;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const auto s0 = bclock::now();
+    ex.stop();
+    const double stop_ms = seconds_since(s0) * 1e3;
+
+    const uint64_t written = ex.stats().records_written;
+    const uint64_t dropped = ex.dropped();
+    const bool     ok      = written + dropped == published;
+    std::cout << "  " << std::left << std::setw(34) << (std::string(dead ? "dead" : "slow") + " sink, " + policy_name)
+              << std::right << "pub " << std::setw(7) << published << "  written " << std::setw(7) << written
+              << "  dropped " << std::setw(7) << dropped << std::fixed << std::setprecision(1)
+              << "  max publish " << std::setw(7) << worst_us << " us  stop " << std::setw(6) << stop_ms << " ms  "
+              << (ok ? "ok" : "MISMATCH") << "\n";
+    return ok;
+}
+
+bool bench_export() {
+    std::cout << "[TagExporter]\n";
+    const struct { SinkPolicy policy; const char* name; } policies[] = {
+        { SinkPolicy::DROP_NEWEST, "drop-newest" },
+        { SinkPolicy::DROP_OLDEST, "drop-oldest" },
+        { SinkPolicy::BLOCK,       "block" },
+    };
+    bool ok = true;
+    for (bool dead : { false, true }) {
+        for (const auto& p : policies) {
+            if (!bench_export_one(dead, p.policy, p.name)) ok = false;
+        }
+    }
+    return ok;
+}
+
+// ---------------------------------------------
+// 6)〜9) クライアント往復
+// ---------------------------------------------
+void bench_client(const BenchConfig& cfg, uint16_t port) {
+    std::cout << "[Client] " << cfg.host << ":" << port << "\n";
+
+    std::vector<double> rtt, inv, seq, bat;
+    uint64_t a_rtt = 0, a_inv = 0, inv_frames = 0, a_seq = 0, a_bat = 0;
+    // 計測値の格納で確保が数えられないよう先に確保しておく
+    for (auto* v : { &rtt, &inv, &seq, &bat }) v->reserve(static_cast<size_t>(cfg.rtt_iterations));
+    {
+        Client cli;
+        cli.connect(cfg.host, port, 2000);
+        const auto& frame = cmd::frames::BUZZER_OFF;
+        for (int i = 0; i < cfg.rtt_iterations; ++i) {
+            const uint64_t a0 = g_allocs;
+            const auto t0 = bclock::now();
+            cli.transact(frame);
+            rtt.push_back(seconds_since(t0) * 1e6);
+            a_rtt += g_allocs - a0;
+        }
+        const auto& inv_frame = cmd::frames::INVENTORY2;
+        for (int i = 0; i < cfg.rtt_iterations; ++i) {
+            const uint64_t a0 = g_allocs;
+            const auto t0 = bclock::now();
+            auto rep = cli.transact(inv_frame);
+            ++inv_frames;
+            if (rep.data.size() == 2 && rep.data[0] == 0xF0) {
+                for (int k = 0; k < rep.data[1]; ++k) { cli.receive_only(); ++inv_frames; }
+            }
+            inv.push_back(seconds_since(t0) * 1e6);
+            a_inv += g_allocs - a0;
+        }
+
+        // アンテナ切替 → Inventory2 → ブザー（main.cpp の1回ぶん）
+        FrameBuffer fb;
+        for (int i = 0; i < cfg.rtt_iterations; ++i) {
+            const uint64_t a0 = g_allocs;
+            const auto t0 = bclock::now();
+            cli.transact(cmd::switch_antenna(fb, static_cast<uint8_t>(i & 1)));
+            auto rep = cli.transact(inv_frame);
+            if (rep.data.size() == 2 && rep.data[0] == 0xF0) {
+                for (int k = 0; k < rep.data[1]; ++k) cli.receive_only();
+            }
+            cli.transact(cmd::frames::BUZZER_ON);
+            seq.push_back(seconds_since(t0) * 1e6);
+            a_seq += g_allocs - a0;
+        }
+        CommandBatch batch;
+        std::vector<Client::BatchReply> reps;   // main.cpp と同じく使い回す
+        for (int i = 0; i < cfg.rtt_iterations; ++i) {
+            const uint64_t a0 = g_allocs;
+            const auto t0 = bclock::now();
+            batch.clear();
+            batch.add(cmd::switch_antenna(fb, static_cast<uint8_t>(i & 1)));
+            batch.add(inv_frame);
+            batch.add(cmd::frames::BUZZER_ON);
+            cli.transact_batch(batch, reps);
+            bat.push_back(seconds_since(t0) * 1e6);
+            a_bat += g_allocs - a0;
+        }
+    }
+
+    double stream_rate = 0.0, stream_allocs = 0.0;
+    {
+        AsyncClient ac;
+        ac.connect(cfg.host, port, 2000);
+        InventoryStream st(ac);
+        st.run(16);   // 暖機（プールのチャンク・要求キュー・タグ応答の vector を定常状態の大きさにする）
+        const uint64_t a0 = g_allocs;
+        const auto t0 = bclock::now();
+        st.run(static_cast<uint64_t>(cfg.rtt_iterations));
+        const double sec = seconds_since(t0);
+        stream_rate   = static_cast<double>(st.cycles()) / sec;
+        stream_allocs = static_cast<double>(g_allocs - a0) / static_cast<double>(st.cycles() + st.tags());
+    }
+
+    print_latency("transact (buzzer)", rtt, static_cast<double>(a_rtt) / static_cast<double>(cfg.rtt_iterations));
+    print_latency("inventory cycle (transact+recv)", inv, static_cast<double>(a_inv) / static_cast<double>(inv_frames));
+    print_latency("switch+inv+buzzer (transact x3)", seq, static_cast<double>(a_seq) / static_cast<double>(inv_frames + 2u * seq.size()));
+    print_latency("switch+inv+buzzer (batch)", bat, static_cast<double>(a_bat) / static_cast<double>(inv_frames + 2u * bat.size()));
+    print_row("InventoryStream", stream_rate, "cycles/s", stream_allocs);
+}
+
+bool parse_args(int argc, char** argv, BenchConfig& c) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string k = argv[i];
+        auto val = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::runtime_error("missing value for " + k);
+            return argv[++i];
+        };
+        if      (k == "--iterations")     c.iterations = std::stoull(val());
+        else if (k == "--rtt-iterations") c.rtt_iterations = std::max(1, std::stoi(val()));
+        else if (k == "--tags")           c.tags = std::max(0, std::min(255, std::stoi(val())));
+        else if (k == "--host")           c.host = val();
+        else if (k == "--port")           c.port = static_cast<uint16_t>(std::stoi(val()));
+        else return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchConfig cfg;
+    try {
+        if (!parse_args(argc, argv, cfg)) {
+            std::cerr << "usage: tr3_bench [--iterations N] [--rtt-iterations N] [--tags N] [--host IP --port N]\n";
+            return 2;
+        }
+        net::startup();
+        bench_parser(cfg);
+        bench_encode(cfg);
+        bench_queue(cfg);
+        bench_store(cfg);
+        const bool export_ok = bench_export();
+        if (cfg.port) {
+            bench_client(cfg, cfg.port);
+        } else {
+            Responder r(cfg.tags);
+            bench_client(cfg, r.port());
+        }
+        net::cleanup();
+        if (!export_ok) {
+            std::cerr << "[ERROR] TagExporter: written + dropped != published\n";
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,230 @@
+// =============================================
+// tools/tr3_replay.cpp
+// TR3シリーズ リーダライタ：キャプチャ再生ツール
+// =============================================
+// capture.hpp 形式のファイル（CaptureWriter で記録）を読み、現場の通信を再現する。
+//
+//   --dump        : レコードを1行ずつ表示（時刻 / リーダ / 方向 / 16進）
+//   --parse       : 受信フレームを Parser::feed() へ流し、解析速度を測る（既定）
+//   --serve PORT  : 疑似リーダとして待ち受け、接続してきたクライアントへ受信フレームを送る
+//
+// 共通オプション：
+//   --speed original|max|<倍率>  : 記録時の間隔どおり／待ちなし／倍速（既定 max）
+//   --reader N                   : 指定リーダのレコードだけを使う（既定：全リーダ）
+//   --loop N                     : N 回繰り返す（--parse のベンチマーク用）
+//   --push                       : --parse で feed() の代わりに1バイトずつ push() する
+//
+// 使い方：
+//   tr3_replay field.tr3cap --dump
+//   tr3_replay field.tr3cap --parse --loop 100
+//   tr3_replay field.tr3cap --serve 9004 --reader 3 --speed original
+// =============================================
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+
+#include "tr3/capture.hpp"
+#include "tr3/net.hpp"
+#include "tr3/protocol.hpp"
+#include "tr3/utils.hpp"
+
+namespace {
+
+using namespace tr3;
+using bclock = std::chrono::steady_clock;
+
+enum class Mode { DUMP, PARSE, SERVE };
+
+struct ReplayConfig {
+    std::string path;
+    Mode        mode   = Mode::PARSE;
+    uint16_t    port   = 0;
+    double      speed  = 0.0;     // 0 = 待ちなし、1 = 記録どおり、2 = 2倍速 …
+    int         reader = -1;      // -1 = 全リーダ
+    int         loops  = 1;
+    bool        push   = false;
+};
+
+bool selected(const ReplayConfig& cfg, const CaptureRecord& r) {
+    return cfg.reader < 0 || r.reader == static_cast<uint16_t>(cfg.reader);
+}
+
+// ---------------------------------------------
+// 記録時刻に合わせて待つ（speed == 0 なら待たない）
+// ---------------------------------------------
+class Pacer {
+public:
+    explicit Pacer(double speed) : speed_(speed) {}
+    void wait(int64_t ts_us) {
+        if (speed_ <= 0.0) return;
+        if (first_ < 0) { first_ = ts_us; start_ = bclock::now(); return; }
+        const auto off = std::chrono::microseconds(static_cast<int64_t>(static_cast<double>(ts_us - first_) / speed_));
+        std::this_thread::sleep_until(start_ + off);
+    }
+private:
+    double             speed_;
+    int64_t            first_ = -1;
+    bclock::time_point start_{};
+};
+
+// ---------------------------------------------
+// --dump
+// ---------------------------------------------
+void run_dump(const ReplayConfig& cfg, CaptureReader& in) {
+    CaptureRecord r;
+    while (in.next(r)) {
+        if (!selected(cfg, r)) continue;
+        const auto ms = (r.ts_us / 1000) % 1000;
+        const std::time_t tt = static_cast<std::time_t>(r.ts_us / 1000000);
+        std::tm lt{};
+#if defined(_WIN32)
+        localtime_s(&lt, &tt);
+#else
+        localtime_r(&tt, &lt);
+#endif
+        char ts[32];
+        std::snprintf(ts, sizeof(ts), "%02d/%02d %02d:%02d:%02d.%03d",
+                      lt.tm_mon + 1, lt.tm_mday, lt.tm_hour, lt.tm_min, lt.tm_sec, static_cast<int>(ms));
+        std::cout << ts << "  #" << std::setw(3) << std::left << r.reader << std::right
+                  << (r.dir == CaptureDir::SEND ? "  [send]  " : "  [recv]  ")
+                  << hex_spaced(r.frame.data(), r.frame.size()) << "\n";
+    }
+}
+
+// ---------------------------------------------
+// --parse
+// ---------------------------------------------
+void run_parse(const ReplayConfig& cfg, CaptureReader& in) {
+    uint64_t records = 0, bytes = 0, frames = 0;
+    Parser::Stats st;
+    Pacer pacer(cfg.speed);
+    const auto t0 = bclock::now();
+
+    for (int loop = 0; loop < cfg.loops; ++loop) {
+        in.rewind();
+        Parser parser;
+        CaptureRecord r;
+        while (in.next(r)) {
+            if (r.dir != CaptureDir::RECV || !selected(cfg, r)) continue;
+            if (loop == 0) pacer.wait(r.ts_us);
+            ++records;
+            bytes += r.frame.size();
+
+            if (cfg.push) {
+                for (uint8_t b : r.frame) {
+                    if (!parser.push(b)) continue;
+                    do { parser.take_raw(); ++frames; } while (parser.resume());
+                }
+                continue;
+            }
+            ByteView rest = r.frame;
+            for (;;) {
+                FrameView fv;
+                const auto res = parser.feed(rest, fv);
+                if (res.frame) ++frames;
+                rest = ByteView(rest.data() + res.consumed, rest.size() - res.consumed);
+                if (!res.frame && rest.empty()) break;
+            }
+        }
+        st.dropped_bytes   += parser.stats().dropped_bytes;
+        st.checksum_errors += parser.stats().checksum_errors;
+        st.format_errors   += parser.stats().format_errors;
+    }
+
+    const double sec = std::chrono::duration<double>(bclock::now() - t0).count();
+    std::cout << "records " << records << "  frames " << frames << "  bytes " << bytes
+              << "  (" << (records - frames) << " rejected)\n"
+              << std::fixed << std::setprecision(1)
+              << "time " << sec * 1000.0 << " ms  "
+              << static_cast<double>(frames) / sec << " frames/s  "
+              << static_cast<double>(bytes) / sec / 1e6 << " MB/s\n"
+              << "dropped bytes " << st.dropped_bytes << "  checksum errors " << st.checksum_errors
+              << "  format errors " << st.format_errors << "\n";
+}
+
+// ---------------------------------------------
+// --serve：1接続ずつ受信フレームを送り返す（クライアントからの送信は読み捨て）
+// ---------------------------------------------
+void run_serve(const ReplayConfig& cfg, CaptureReader& in) {
+    net::socket_t ls = net::listen_tcp("0.0.0.0", cfg.port);
+    std::cout << "[replay] listening on port " << net::local_port(ls) << "\n";
+    std::vector<uint8_t> sink(4096);
+
+    for (;;) {
+        net::socket_t c = net::accept_tcp(ls, -1);
+        if (c == net::INVALID_SOCK) continue;
+        std::cout << "[replay] client connected\n";
+        try {
+            in.rewind();
+            Pacer pacer(cfg.speed);
+            CaptureRecord r;
+            uint64_t sent = 0;
+            while (in.next(r)) {
+                if (r.dir != CaptureDir::RECV || !selected(cfg, r)) continue;
+                pacer.wait(r.ts_us);
+                while (net::recv_some(c, sink.data(), sink.size()) > 0) {}   // コマンドは読み捨て
+                net::send_all(c, r.frame.data(), r.frame.size(), 5000);
+                ++sent;
+            }
+            std::cout << "[replay] sent " << sent << " frames\n";
+        } catch (const std::exception& e) {
+            std::cout << "[replay] " << e.what() << "\n";
+        }
+        net::close_socket(c);
+    }
+}
+
+bool parse_args(int argc, char** argv, ReplayConfig& c) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string k = argv[i];
+        auto val = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::runtime_error("missing value for " + k);
+            return argv[++i];
+        };
+        if      (k == "--dump")   c.mode = Mode::DUMP;
+        else if (k == "--parse")  c.mode = Mode::PARSE;
+        else if (k == "--serve")  { c.mode = Mode::SERVE; c.port = static_cast<uint16_t>(std::stoi(val())); }
+        else if (k == "--speed")  {
+            const std::string v = val();
+            c.speed = v == "max" ? 0.0 : v == "original" ? 1.0 : std::stod(v);
+        }
+        else if (k == "--reader") c.reader = std::stoi(val());
+        else if (k == "--loop")   c.loops = std::max(1, std::stoi(val()));
+        else if (k == "--push")   c.push = true;
+        else if (!k.empty() && k[0] != '-' && c.path.empty()) c.path = k;
+        else return false;
+    }
+    return !c.path.empty();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    ReplayConfig cfg;
+    try {
+        if (!parse_args(argc, argv, cfg)) {
+            std::cerr << "usage: tr3_replay FILE [--dump | --parse | --serve PORT]\n"
+                         "                  [--speed original|max|<factor>] [--reader N] [--loop N] [--push]\n";
+            return 2;
+        }
+        CaptureReader in(cfg.path);
+        switch (cfg.mode) {
+        case Mode::DUMP:  run_dump(cfg, in);  break;
+        case Mode::PARSE: run_parse(cfg, in); break;
+        case Mode::SERVE:
+            net::startup();
+            run_serve(cfg, in);
+            net::cleanup();
+            break;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,277 @@
+// =============================================
+// tools/tr3_sim.cpp
+// TR3シリーズ リーダライタ：ローカルシミュレータ（負荷・遅延試験用）
+// =============================================
+// 実機（TR3XM）なしでクライアント側の性能を再現性よく測るための疑似リーダ。
+// protocol.hpp の STX…CR フレームを TCP で受け、次のコマンドに応答する。
+//
+//   ROMバージョン確認 (0x4F)  → ACK [90 '1' '0' '2' '3' 'T' 'R' '3' 'X' 'M']
+//   コマンドモード設定 (0x4E 00..) / アンテナ切替 (0x4E 9C nn) → ACK（受信DATAをそのまま返す）
+//   Inventory2 (0x78)        → ACK [F0 NN] + タグ応答(0x49) × NN
+//   ブザー (0x42)            → ACK（受信DATAをそのまま返す）
+//   その他                   → NACK [CMD]
+//
+// 使い方：
+//   tr3_sim [--port 9004] [--readers 1] [--bind 127.0.0.1]
+//           [--tags 10] [--antennas 4] [--read-rate 1.0]
+//           [--latency-ms 0] [--jitter-ms 0] [--tag-gap-us 0]
+//           [--fragment 0] [--fragment-gap-us 100]
+//           [--corrupt 0.0] [--drop 0.0] [--seed 1] [--quiet]
+//
+//   --readers N   : port, port+1, ... の N ポートで N 台ぶんを待ち受ける
+//   --tags N      : アンテナごとのタグ数（UID はリーダ/アンテナ/番号から決まる）
+//   --antennas N  : 接続アンテナ数（範囲外へのアンテナ切替は NACK）
+//   --read-rate P : Inventory ごとに各タグが読める確率
+//   --latency-ms / --jitter-ms : 応答前の待ち時間（基準 + 一様乱数）
+//   --tag-gap-us  : タグ応答どうしの送信間隔
+//   --fragment N  : 応答を N バイトずつに分割して送信（0 = 分割しない）
+//   --corrupt P   : 応答フレームの SUM を壊す確率
+//   --drop P      : 応答を返さない確率（タイムアウト試験用）
+// =============================================
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <atomic>
+#include <cstdlib>
+
+#include "tr3/net.hpp"
+#include "tr3/protocol.hpp"
+#include "tr3/utils.hpp"
+
+namespace {
+
+using namespace tr3;
+
+// ---------------------------------------------
+// シミュレータ設定（コマンドライン引数）
+// ---------------------------------------------
+struct SimConfig {
+    std::string bind        = "127.0.0.1";
+    uint16_t    port        = 9004;
+    int         readers     = 1;
+    int         tags        = 10;
+    int         antennas    = 4;
+    double      read_rate   = 1.0;
+    int         latency_ms  = 0;
+    int         jitter_ms   = 0;
+    int         tag_gap_us  = 0;
+    size_t      fragment    = 0;
+    int         fragment_gap_us = 100;
+    double      corrupt     = 0.0;
+    double      drop        = 0.0;
+    unsigned    seed        = 1;
+    bool        quiet       = false;
+};
+
+std::atomic<int> g_conn_id{0};
+
+// ---------------------------------------------
+// 応答フレームの生成
+// ---------------------------------------------
+std::vector<uint8_t> make_frame(uint8_t cmd, std::vector<uint8_t> data) {
+    Frame f; f.addr = 0x00; f.cmd = cmd; f.data = std::move(data);
+    return f.encode();
+}
+
+// ---------------------------------------------
+// 1接続ぶんの疑似リーダ
+// ---------------------------------------------
+class Session {
+public:
+    Session(const SimConfig& cfg, net::socket_t s, int reader)
+        : cfg_(cfg), sock_(s), reader_(reader), rng_(cfg.seed + static_cast<unsigned>(g_conn_id++)) {}
+    ~Session() { net::close_socket(sock_); }
+
+    void run() {
+        std::vector<uint8_t> rx(4096);
+        Parser parser;
+        for (;;) {
+            if (!net::wait_readable(sock_, -1)) continue;
+            const long n = net::recv_some(sock_, rx.data(), rx.size());
+            if (n == 0) return;              // 切断
+            if (n < 0) continue;
+
+            ByteView in(rx.data(), static_cast<size_t>(n));
+            for (;;) {
+                FrameView fv;
+                const auto r = parser.feed(in, fv);
+                if (r.frame) handle(fv);
+                in = ByteView(in.data() + r.consumed, in.size() - r.consumed);
+                if (!r.frame && in.empty()) break;
+            }
+        }
+    }
+
+private:
+    bool chance(double p) { return p > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(rng_) < p; }
+
+    // 受信コマンド1つに応答
+    void handle(const FrameView& fv) {
+        const std::vector<uint8_t> data(fv.data.begin(), fv.data.end());
+
+        // 応答前の待ち（処理時間の模擬）
+        int wait = cfg_.latency_ms;
+        if (cfg_.jitter_ms > 0) wait += std::uniform_int_distribution<int>(0, cfg_.jitter_ms)(rng_);
+        if (wait > 0) std::this_thread::sleep_for(std::chrono::milliseconds(wait));
+
+        if (chance(cfg_.drop)) return;
+
+        switch (fv.cmd) {
+        case CMD_ROM:
+            reply(make_frame(RES_ACK, { 0x90, '1', '0', '2', '3', 'T', 'R', '3', 'X', 'M' }));
+            break;
+        case CMD_SET:
+            if (data.size() == 2 && data[0] == 0x9C) {
+                // 接続されていないアンテナ番号は NACK
+                if (data[1] >= cfg_.antennas) { reply(make_frame(RES_NACK, { fv.cmd })); break; }
+                antenna_ = data[1];
+            }
+            reply(make_frame(RES_ACK, data));
+            break;
+        case CMD_BUZZER:
+            reply(make_frame(RES_ACK, data));
+            break;
+        case CMD_INVENTORY2:
+            inventory();
+            break;
+        default:
+            reply(make_frame(RES_NACK, { fv.cmd }));
+            break;
+        }
+    }
+
+    // Inventory2：ACK [F0 NN] + タグ応答 × NN
+    void inventory() {
+        std::vector<std::vector<uint8_t>> tags;
+        for (int k = 0; k < cfg_.tags; ++k) {
+            if (cfg_.read_rate < 1.0 && !chance(cfg_.read_rate)) continue;
+            // UID（LSB→MSB）：E0 04 01 を MSB 側に置き、残りをリーダ/アンテナ/番号で決める
+            tags.push_back(make_frame(RES_TAG, {
+                0x00,
+                static_cast<uint8_t>(k), static_cast<uint8_t>(k >> 8),
+                antenna_, static_cast<uint8_t>(reader_), static_cast<uint8_t>(reader_ >> 8),
+                0x01, 0x04, 0xE0 }));
+        }
+
+        std::vector<uint8_t> out = make_frame(RES_ACK, { 0xF0, static_cast<uint8_t>(tags.size()) });
+        if (cfg_.tag_gap_us > 0) {
+            reply(std::move(out));
+            for (auto& t : tags) {
+                std::this_thread::sleep_for(std::chrono::microseconds(cfg_.tag_gap_us));
+                reply(std::move(t));
+            }
+            return;
+        }
+        std::vector<uint8_t> all = std::move(out);
+        for (auto& t : tags) {
+            corrupt(t);
+            all.insert(all.end(), t.begin(), t.end());
+        }
+        write(all);
+    }
+
+    // SUM を壊す（--corrupt）
+    void corrupt(std::vector<uint8_t>& f) {
+        if (f.size() >= 2 && chance(cfg_.corrupt)) f[f.size() - 2] ^= 0x5A;
+    }
+
+    void reply(std::vector<uint8_t> f) {
+        corrupt(f);
+        write(f);
+    }
+
+    // 送信（--fragment 指定時は分割）
+    void write(const std::vector<uint8_t>& b) {
+        if (cfg_.fragment == 0 || b.size() <= cfg_.fragment) {
+            net::send_all(sock_, b.data(), b.size(), 5000);
+            return;
+        }
+        for (size_t off = 0; off < b.size(); off += cfg_.fragment) {
+            const size_t n = std::min(cfg_.fragment, b.size() - off);
+            net::send_all(sock_, b.data() + off, n, 5000);
+            if (cfg_.fragment_gap_us > 0) std::this_thread::sleep_for(std::chrono::microseconds(cfg_.fragment_gap_us));
+        }
+    }
+
+    const SimConfig& cfg_;
+    net::socket_t    sock_;
+    int              reader_;
+    uint8_t          antenna_ = 0;
+    std::mt19937     rng_;
+};
+
+// ---------------------------------------------
+// 1ポート（= 1台）ぶんの待受ループ
+// ---------------------------------------------
+void serve(const SimConfig& cfg, int reader) try {
+    const uint16_t port = static_cast<uint16_t>(cfg.port + reader);
+    net::socket_t ls = net::listen_tcp(cfg.bind, port);
+    if (!cfg.quiet) std::cout << ts_now() << "  [sim]   reader#" << reader << " listening " << cfg.bind << ":" << port << "\n";
+    for (;;) {
+        net::socket_t c = net::accept_tcp(ls, -1);
+        if (c == net::INVALID_SOCK) continue;
+        std::thread([&cfg, c, reader] {
+            try {
+                Session(cfg, c, reader).run();
+            } catch (const std::exception& e) {
+                if (!cfg.quiet) std::cerr << "[sim] reader#" << reader << " " << e.what() << "\n";
+            }
+        }).detach();
+    }
+} catch (const std::exception& e) {
+    std::cerr << "[ERROR] reader#" << reader << " " << e.what() << "\n";
+}
+
+bool parse_args(int argc, char** argv, SimConfig& c) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string k = argv[i];
+        auto val = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::runtime_error("missing value for " + k);
+            return argv[++i];
+        };
+        if      (k == "--bind")            c.bind = val();
+        else if (k == "--port")            c.port = static_cast<uint16_t>(std::stoi(val()));
+        else if (k == "--readers")         c.readers = std::max(1, std::stoi(val()));
+        else if (k == "--tags")            c.tags = std::max(0, std::min(255, std::stoi(val())));
+        else if (k == "--antennas")        c.antennas = std::max(1, std::stoi(val()));
+        else if (k == "--read-rate")       c.read_rate = std::stod(val());
+        else if (k == "--latency-ms")      c.latency_ms = std::stoi(val());
+        else if (k == "--jitter-ms")       c.jitter_ms = std::stoi(val());
+        else if (k == "--tag-gap-us")      c.tag_gap_us = std::stoi(val());
+        else if (k == "--fragment")        c.fragment = static_cast<size_t>(std::stoul(val()));
+        else if (k == "--fragment-gap-us") c.fragment_gap_us = std::stoi(val());
+        else if (k == "--corrupt")         c.corrupt = std::stod(val());
+        else if (k == "--drop")            c.drop = std::stod(val());
+        else if (k == "--seed")            c.seed = static_cast<unsigned>(std::stoul(val()));
+        else if (k == "--quiet")           c.quiet = true;
+        else return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    SimConfig cfg;
+    try {
+        if (!parse_args(argc, argv, cfg)) {
+            std::cerr << "usage: tr3_sim [--port 9004] [--readers 1] [--bind 127.0.0.1] [--tags 10]\n"
+                         "               [--antennas 4] [--read-rate 1.0] [--latency-ms 0] [--jitter-ms 0]\n"
+                         "               [--tag-gap-us 0] [--fragment 0] [--fragment-gap-us 100]\n"
+                         "               [--corrupt 0.0] [--drop 0.0] [--seed 1] [--quiet]\n";
+            return 2;
+        }
+        net::startup();
+        std::vector<std::thread> th;
+        for (int r = 0; r < cfg.readers; ++r) th.emplace_back(serve, std::cref(cfg), r);
+        for (auto& t : th) t.join();
+        net::cleanup();
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] " << e.what() << "\n";
+        return 1;
+    }
+}